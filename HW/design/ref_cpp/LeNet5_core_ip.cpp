@@ -15,13 +15,59 @@
 #include "LeNet5_core_ip.h"
 
 int main(int argc, char **argv) {
-	if(argc != 3){
-		printf("Usage : <executable> <srand_val> <srand_val>\n");
+    if ((argc >= 2) && (std::string(argv[1]) == "loadgen")) {
+        return run_loadgen(argc, argv);
+    }
+    if ((argc >= 2) && (std::string(argv[1]) == "shmclient")) {
+        return run_shm_client(argc, argv);
+    }
+    if ((argc >= 2) && (std::string(argv[1]) == "launch")) {
+        return run_launch(argc, argv);
+    }
+    if ((argc >= 2) && (std::string(argv[1]) == "merge")) {
+        return run_merge(argc, argv);
+    }
+    if ((argc >= 2) && (std::string(argv[1]) == "prep")) {
+        return run_prep(argc, argv);
+    }
+    rtl_param rtl;
+    if ((argc >= 2) && (std::string(argv[1]) == "axi")) {
+        return rd_rtl_param(rtl) ? run_axi_model(argc, argv, rtl) : -1;
+    }
+    shard_opt shard;
+    if (parse_shard_opt(argc, argv, shard) != 0) return -1;
+    backend_opt backend;
+    if (parse_backend_opt(argc, argv, backend) != 0) return -1;
+    bool is_sweep = (argc >= 5) && (std::string(argv[1]) == "sweep");
+    bool is_serve = ((argc >= 5) && (std::string(argv[1]) == "serve")) ||
+                    ((argc >= 3) && (std::string(argv[1]) == "shmserve"));
+    bool is_latency = (argc == 4) && (std::string(argv[1]) == "latency");
+	if((!is_sweep && !is_serve && !is_latency && (argc < 3 || argc > 5)) || ((is_sweep || is_serve || is_latency) && shard.is_on)){
+		printf("Usage : <executable> <srand_val> <loop_num> [cache_entries] [pipe_workers] [--shard i/n | --range start:count] [--out path] [--run token]\n");
+		printf("        (every mode that runs the network also takes --backend <name> --verify <N>, serve and shmserve --team <threads>)\n");
+		printf("        <executable> sweep <image_num> <thread_num> <layer>=<o_inv>[,<o_inv>...] ...\n");
+		printf("        <executable> serve <socket_path> <max_batch> <max_wait_us> [queue_depth]\n");
+		printf("        <executable> loadgen <socket_path> <rate_per_s> <request_num> [conn_num]\n");
+		printf("        <executable> shmserve <shm_name> [slot_num]\n");
+		printf("        <executable> shmclient <shm_name> <request_num> [window]\n");
+		printf("        <executable> launch <proc_num> <srand_val> <loop_num> [cache_entries] [pipe_workers]\n");
+		printf("        <executable> merge [path]\n");
+		printf("        <executable> prep [image_num]\n");
+		printf("        <executable> latency <image_num> <thread_num>\n");
+		printf("        <executable> axi [max_burst] [outstanding] [rd_latency_cycles] [base_ofs]\n");
 		return -1;
 	}
 	
-    int RD_SEED  = atoi(argv[1]);
-    int LOOP_NUM = atoi(argv[2]);
+    // RTL parameters from the Verilog sources, no hand-kept copies
+    if (!rd_rtl_param(rtl)) return -1;
+    
+    int RD_SEED  = (is_sweep || is_serve || is_latency) ? 0 : atoi(argv[1]);
+    int LOOP_NUM = (is_serve || is_latency) ? 0 : atoi(argv[2]);
+    int CACHE_NUM = (!is_sweep && !is_serve && !is_latency && (argc >= 4)) ? atoi(argv[3]) : 0; // 0: no result cache
+    int PIPE_WORKER_NUM = (!is_sweep && !is_serve && (argc == 5)) ? std::min(atoi(argv[4]), PIPE_WORKER_MAX) : 0; // 0: serial loop
+    if (shard.is_on && (shard_resolve(shard, LOOP_NUM) != 0)) return -1;
+    int IMG_FIRST = shard.is_on ? shard.start : 0;        // images [IMG_FIRST, IMG_FIRST + IMG_NUM) of LOOP_NUM
+    int IMG_NUM   = shard.is_on ? shard.count : LOOP_NUM;
 	
 	mt19937 rd(RD_SEED);
     // brand::independent_bits_engine<mt19937, 512, INT_t> gen_512(atoi(argv[1]));
@@ -56,6 +102,21 @@ int main(int argc, char **argv) {
     int M_INV_fc3 = fc3_scale.IN_I_INV * fc3_scale.IN_W_INV / fc3_scale.IN_O_INV;
     int B_SCALE_fc3 = fc3_scale.IN_B_INV / (fc3_scale.IN_I_INV * fc3_scale.IN_W_INV);
     
+    // the layer shapes above are the RTL's, the packed model is keyed by them
+    const int layer_shape[NET_LAYER_NUM][4] = {
+        {conv1.OCH, conv1.ICH, conv1.KY, conv1.KX}, {conv2.OCH, conv2.ICH, conv2.KY, conv2.KX},
+        {fc1.OCH, fc1.ICH, 1, 1}, {fc2.OCH, fc2.ICH, 1, 1}, {fc3.OCH, fc3.ICH, 1, 1}
+    };
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        if (!std::equal(layer_shape[k], layer_shape[k] + 4, rtl.LAYER_SHAPE[k])) {
+            std::cerr << "rtl: " << layer_name[k] << " shape " << rtl.LAYER_SHAPE[k][0] << "x" << rtl.LAYER_SHAPE[k][1] << "x"
+                      << rtl.LAYER_SHAPE[k][2] << "x" << rtl.LAYER_SHAPE[k][3] << " in defines_parameter_LeNet5.vh, "
+                      << layer_shape[k][0] << "x" << layer_shape[k][1] << "x" << layer_shape[k][2] << "x" << layer_shape[k][3]
+                      << " here" << std::endl;
+            return -1;
+        }
+    }
+    
     //===========================================================================
     // Read/Write txt File
     //===========================================================================
@@ -102,19 +163,6 @@ int main(int argc, char **argv) {
         std::cerr << "Error opening FP_IN_OTFMAP file" << std::endl; return 1;
     }
     
-	std::ofstream fp_ot_infmap (FP_OT_INFMAP );
-	std::ofstream fp_ot_conv1_weight (FP_OT_CONV1_WEIGHT );
-	std::ofstream fp_ot_conv1_bias   (FP_OT_CONV1_BIAS   );
-	std::ofstream fp_ot_conv2_weight (FP_OT_CONV2_WEIGHT );
-	std::ofstream fp_ot_conv2_bias   (FP_OT_CONV2_BIAS   );
-	std::ofstream fp_ot_fc1_weight (FP_OT_FC1_WEIGHT );
-	std::ofstream fp_ot_fc1_bias   (FP_OT_FC1_BIAS   );
-	std::ofstream fp_ot_fc2_weight (FP_OT_FC2_WEIGHT );
-	std::ofstream fp_ot_fc2_bias   (FP_OT_FC2_BIAS   );
-	std::ofstream fp_ot_fc3_weight (FP_OT_FC3_WEIGHT );
-	std::ofstream fp_ot_fc3_bias   (FP_OT_FC3_BIAS   );
-	std::ofstream fp_ot_otfmap (FP_OT_OTFMAP );
-    
     //========================================================================
     // Initial Setting weight, bias value.
     //======================================================================== 
@@ -164,6 +212,156 @@ int main(int argc, char **argv) {
     vector<int16_t> fc3_bias_qnt (fc3.OCH, 0); 		// 16b
     rd_bias(fp_in_fc3_bias, fc3_bias, fc3_bias_qnt, fc3.OCH);
     
+    // result cache, keyed by the parameters actually loaded
+    uint64_t param_hash = 0;
+    for (int och = 0; och < conv1.OCH; och++) for (int ich = 0; ich < conv1.ICH; ich++) for (int ky = 0; ky < conv1.KY; ky++)
+        param_hash = param_hash_i8(param_hash, conv1_weight_qnt[och][ich][ky]);
+    param_hash = param_hash_i16(param_hash, conv1_bias_qnt);
+    for (int och = 0; och < conv2.OCH; och++) for (int ich = 0; ich < conv2.ICH; ich++) for (int ky = 0; ky < conv2.KY; ky++)
+        param_hash = param_hash_i8(param_hash, conv2_weight_qnt[och][ich][ky]);
+    param_hash = param_hash_i16(param_hash, conv2_bias_qnt);
+    for (int och = 0; och < fc1.OCH; och++) param_hash = param_hash_i8(param_hash, fc1_weight_qnt[och]);
+    param_hash = param_hash_i16(param_hash, fc1_bias_qnt);
+    for (int och = 0; och < fc2.OCH; och++) param_hash = param_hash_i8(param_hash, fc2_weight_qnt[och]);
+    param_hash = param_hash_i16(param_hash, fc2_bias_qnt);
+    for (int och = 0; och < fc3.OCH; och++) param_hash = param_hash_i8(param_hash, fc3_weight_qnt[och]);
+    param_hash = param_hash_i16(param_hash, fc3_bias_qnt);
+    result_cache cache;
+    cache_init(cache, CACHE_NUM, param_hash);
+    
+    // prepacked weights, rebuilt when the parameter files change,
+    // shared read-only with the other processes on this host
+    packed_model_key model_key;
+    model_key.param_hash = param_hash;
+    const int B_SCALE_all[NET_LAYER_NUM] = {B_SCALE_conv1, B_SCALE_conv2, B_SCALE_fc1, B_SCALE_fc2, B_SCALE_fc3};
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        model_key.b_shift[k] = log2(B_SCALE_all[k]);
+        std::copy(rtl.LAYER_SHAPE[k], rtl.LAYER_SHAPE[k] + 4, model_key.shape[k]);
+    }
+    packed_model model;
+    if (!attach_model_segment(model, model_key)) {
+        if (!load_packed_model(FP_PACKED_MODEL, model, model_key)) {
+            model.param_hash = param_hash;
+            pack_conv_weight(model.conv1, conv1_weight_qnt, conv1_bias_qnt, B_SCALE_conv1);
+            pack_conv_weight(model.conv2, conv2_weight_qnt, conv2_bias_qnt, B_SCALE_conv2);
+            pack_fc_weight(model.fc1, fc1_weight_qnt, fc1_bias_qnt, B_SCALE_fc1);
+            pack_fc_weight(model.fc2, fc2_weight_qnt, fc2_bias_qnt, B_SCALE_fc2);
+            pack_fc_weight(model.fc3, fc3_weight_qnt, fc3_bias_qnt, B_SCALE_fc3);
+            save_packed_model(FP_PACKED_MODEL, model);
+            cout << "packed model rebuilt: " << FP_PACKED_MODEL << endl;
+        }
+        if (publish_model_segment(model)) attach_model_segment(model, model_key);
+    }
+    
+    // the scalar oracle runs on the parameters as read, not on the packed arrays
+    typedef vector<vector<vector<vector<int>>>> conv_weight_t;
+    model.conv1.src = {std::make_shared<const conv_weight_t>(std::move(conv1_weight)),
+                       std::make_shared<const vector<int>>(std::move(conv1_bias)), B_SCALE_conv1};
+    model.conv2.src = {std::make_shared<const conv_weight_t>(std::move(conv2_weight)),
+                       std::make_shared<const vector<int>>(std::move(conv2_bias)), B_SCALE_conv2};
+    model.fc1.src = {std::make_shared<const vector<vector<int>>>(std::move(fc1_weight)),
+                     std::make_shared<const vector<int>>(std::move(fc1_bias)), B_SCALE_fc1};
+    model.fc2.src = {std::make_shared<const vector<vector<int>>>(std::move(fc2_weight)),
+                     std::make_shared<const vector<int>>(std::move(fc2_bias)), B_SCALE_fc2};
+    model.fc3.src = {std::make_shared<const vector<vector<int>>>(std::move(fc3_weight)),
+                     std::make_shared<const vector<int>>(std::move(fc3_bias)), B_SCALE_fc3};
+    // the int8 weights are only kept for the trace files
+    if (is_sweep || is_serve || is_latency || shard.is_on) {
+        vector<vector<vector<vector<int8_t>>>>().swap(conv1_weight_qnt);
+        vector<vector<vector<vector<int8_t>>>>().swap(conv2_weight_qnt);
+        vector<vector<int8_t>>().swap(fc1_weight_qnt);
+        vector<vector<int8_t>>().swap(fc2_weight_qnt);
+        vector<vector<int8_t>>().swap(fc3_weight_qnt);
+    }
+    
+    // int16 accumulation where the loaded weights make it overflow-free
+    int conv1_in_lo, conv1_in_hi;
+    conv1_input_range(conv1_in_lo, conv1_in_hi);
+    vector<layer_plan> plans = {
+        plan_conv_layer("conv1", model.conv1, conv1_in_lo, conv1_in_hi, rtl.CONV_O_F_BW[0]),
+        plan_conv_layer("conv2", model.conv2, RELU_IN_LO, RELU_IN_HI, rtl.CONV_O_F_BW[1]),
+        plan_fc_layer("fc1", model.fc1, RELU_IN_LO, RELU_IN_HI),
+        plan_fc_layer("fc2", model.fc2, RELU_IN_LO, RELU_IN_HI),
+        plan_fc_layer("fc3", model.fc3, RELU_IN_LO, RELU_IN_HI)
+    };
+    plan_report(plans);
+    
+    // padded int8 images written by 'prep', NULL: decode the IDX files
+    img_cache icache;
+    const img_cache* ic = (!is_serve && img_cache_open(icache)) ? &icache : NULL;
+    
+    // backend per layer, timed on the first test images
+    layer_scale base_scale[NET_LAYER_NUM] = {conv1_scale, conv2_scale, fc1_scale, fc2_scale, fc3_scale};
+    lenet5_net net;
+    net_init(net, model, base_scale);
+    {
+        vector<int8_t> cal_img((size_t)BACKEND_CAL_IMG * NET_IMG_BYTE);
+        int cal_num = 0;
+        if (ic != NULL) {
+            cal_num = std::min(BACKEND_CAL_IMG, ic->img_num);
+            std::copy(ic->img, ic->img + (size_t)cal_num * NET_IMG_BYTE, cal_img.begin());
+        } else if (backend.name.empty() || (is_serve && (backend.team_num > 0))) {
+            vector<uint8_t> pixel, label;
+            cal_num = rd_idx_set(BACKEND_CAL_IMG, pixel, label);
+            for (int i = 0; i < cal_num; i++) pad_image(&pixel[i * 28 * 28], &cal_img[i * NET_IMG_BYTE]);
+        }
+        net.plan = backend_plan_make(net, backend, cal_img.data(), cal_num);
+        backend_report(*net.plan);
+        if (is_serve && (backend.team_num > 0)) {
+            net.team = team_make(backend.team_num);
+            if (!team_calibrate(*net.team, net, cal_img.data(), cal_num)) net.team.reset();
+        }
+    }
+    
+    if (is_sweep) {
+        return run_sweep(argc, argv, model, base_scale, fp_in_infmap, fp_in_label, ic, net.plan);
+    }
+    if (is_latency) {
+        return run_latency(argc, argv, net, ic);
+    }
+    if (is_serve) {
+        const int rc = (std::string(argv[1]) == "shmserve") ? run_shm_serve(argc, argv, net) : run_serve(argc, argv, net);
+        if (net.team != NULL) team_report(*net.team);
+        return rc;
+    }
+    
+	std::ofstream fp_ot_infmap;
+	std::ofstream fp_ot_conv1_weight, fp_ot_conv1_bias;
+	std::ofstream fp_ot_conv2_weight, fp_ot_conv2_bias;
+	std::ofstream fp_ot_fc1_weight, fp_ot_fc1_bias;
+	std::ofstream fp_ot_fc2_weight, fp_ot_fc2_bias;
+	std::ofstream fp_ot_fc3_weight, fp_ot_fc3_bias;
+	std::ofstream fp_ot_otfmap;
+	std::ofstream fp_ot_mem_param, fp_ot_mem_infmap, fp_ot_mem_result;
+    // a shard writes its records to the shared results file instead of the traces
+    shard_store store;
+    if (shard.is_on) {
+        if (shard_store_open(store, shard.path, LOOP_NUM, param_hash, shard_run_id(shard, RD_SEED, LOOP_NUM)) != 0) return -1;
+        cout << "shard: images " << IMG_FIRST << " .. " << IMG_FIRST + IMG_NUM - 1 << " of " << LOOP_NUM
+             << " -> " << shard.path << endl;
+    } else {
+        fp_ot_infmap.open       (FP_OT_INFMAP      );
+        fp_ot_conv1_weight.open (FP_OT_CONV1_WEIGHT);
+        fp_ot_conv1_bias.open   (FP_OT_CONV1_BIAS  );
+        fp_ot_conv2_weight.open (FP_OT_CONV2_WEIGHT);
+        fp_ot_conv2_bias.open   (FP_OT_CONV2_BIAS  );
+        fp_ot_fc1_weight.open   (FP_OT_FC1_WEIGHT  );
+        fp_ot_fc1_bias.open     (FP_OT_FC1_BIAS    );
+        fp_ot_fc2_weight.open   (FP_OT_FC2_WEIGHT  );
+        fp_ot_fc2_bias.open     (FP_OT_FC2_BIAS    );
+        fp_ot_fc3_weight.open   (FP_OT_FC3_WEIGHT  );
+        fp_ot_fc3_bias.open     (FP_OT_FC3_BIAS    );
+        fp_ot_otfmap.open       (FP_OT_OTFMAP      );
+        fp_ot_mem_param.open    (FP_OT_MEM_PARAM   );
+        fp_ot_mem_infmap.open   (FP_OT_MEM_INFMAP  );
+        fp_ot_mem_result.open   (FP_OT_MEM_RESULT  );
+    }
+    
+    // input density of the layers fed by ReLU outputs
+    vector<layer_density> density = {
+        {"conv2", 0, 0, 0, 0}, {"fc1", 0, 0, 0, 0}, {"fc2", 0, 0, 0, 0}, {"fc3", 0, 0, 0, 0}
+    };
+    
     //========================================================================
     // Read Golden Quantized Value
     //======================================================================== 
@@ -172,11 +370,85 @@ int main(int argc, char **argv) {
     
     rd_fc_otfmap(fp_in_otfmap, golden_otfmap, golden_otfmap_qnt, fc3.OCH);
     
+    // weight / bias traces, written once with the first image
+    bool is_memh_ok = true;   // false: the param layout does not match the RTL, no mem_param.memh
+    auto wr_param_trace = [&](const int loop) {
+        // conv1
+        wr_conv_weight(loop, fp_ot_conv1_weight, conv1_weight_qnt, 
+            conv1.OCH, conv1.ICH, conv1.KY, conv1.KX);
+        wr_bias(loop, fp_ot_conv1_bias, conv1_bias_qnt, conv1.OCH);
+        
+        // conv2
+        wr_conv_weight(loop, fp_ot_conv2_weight, conv2_weight_qnt, 
+            conv2.OCH, conv2.ICH, conv2.KY, conv2.KX);
+        wr_bias(loop, fp_ot_conv2_bias, conv2_bias_qnt, conv2.OCH);
+        
+        // fc1
+        wr_fc_weight(loop, fp_ot_fc1_weight, fc1_weight_qnt, fc1.OCH, fc1.ICH);
+        wr_bias(loop, fp_ot_fc1_bias, fc1_bias_qnt, fc1.OCH);
+        
+        // fc2
+        wr_fc_weight(loop, fp_ot_fc2_weight, fc2_weight_qnt, fc2.OCH, fc2.ICH);
+        wr_bias(loop, fp_ot_fc2_bias, fc2_bias_qnt, fc2.OCH);
+        
+        // fc3
+        wr_fc_weight(loop, fp_ot_fc3_weight, fc3_weight_qnt, fc3.OCH, fc3.ICH);
+        wr_bias(loop, fp_ot_fc3_bias, fc3_bias_qnt, fc3.OCH);
+        
+        // the same parameters as one RDMA param buffer
+        vector<uint64_t> param_beat;
+        rdma_pack_conv(conv1_weight_qnt, conv1_bias_qnt, param_beat);
+        rdma_pack_conv(conv2_weight_qnt, conv2_bias_qnt, param_beat);
+        rdma_pack_fc(fc1_weight_qnt, fc1_bias_qnt, rtl.FC_ICH_B[0], param_beat);
+        rdma_pack_fc(fc2_weight_qnt, fc2_bias_qnt, rtl.FC_ICH_B[1], param_beat);
+        rdma_pack_fc(fc3_weight_qnt, fc3_bias_qnt, rtl.FC_ICH_B[2], param_beat);
+        if (param_beat.size() != (size_t)rtl.NUM_RD_PARAM) {
+            std::cerr << "memh: param layout has " << param_beat.size() << " beats, NUM_RD_PARAM is " << rtl.NUM_RD_PARAM
+                      << ", " << FP_OT_MEM_PARAM << " left empty" << std::endl;
+            is_memh_ok = false;
+            return;
+        }
+        wr_memh(fp_ot_mem_param, param_beat.data(), param_beat.size());
+    };
+    
+    // infmap beats and the expected result beat of one image
+    auto wr_mem_trace = [&](const int loop, const vector<vector<vector<int8_t>>>& infmap_qnt, const vector<int8_t>& otfmap_qnt) {
+        int8_t img[NET_IMG_BYTE];
+        uint64_t beat[RDMA_IMG_BEAT_NUM];
+        for (int i = 0; i < NET_IMG_BYTE; i++) img[i] = infmap_qnt[0][i / conv1.IX][i % conv1.IX];
+        rdma_pack_img(img, beat);
+        wr_memh(fp_ot_mem_infmap, beat, RDMA_IMG_BEAT_NUM);
+        const uint64_t rec = rtl_result_rec(loop, result_class(otfmap_qnt, fc3.OCH));
+        wr_memh(fp_ot_mem_result, &rec, 1);
+    };
+    
+    // pipelined run: ingest / compute / emit overlap, same traces and order
+    int SERIAL_LOOP_NUM = IMG_NUM;
+    if (PIPE_WORKER_NUM > 0) {
+        vector<int8_t> fc3_otfmap_qnt (fc3.OCH, 0); // 8b
+        auto emit = [&](const pipe_slot& sl) {
+            cout << "Loop: " << sl.loop << " label: " << sl.label << endl;
+            int test_fc3 = 0;
+            for(int och = 0; och < fc3.OCH; och ++){
+                fc3_otfmap_qnt[och] = sl.fc3_otfmap[och];
+                if(golden_otfmap[och] != sl.fc3_otfmap[och]) test_fc3++;
+            }
+            if(test_fc3 != 0) cout << "Quantization Diff Num: " << test_fc3 << std::endl;
+            wr_conv_infmap(sl.loop, fp_ot_infmap, sl.infmap_qnt, conv1.ICH, conv1.IY, conv1.IX);
+            if((sl.loop == 0) && !shard.is_on) wr_param_trace(sl.loop);
+            wr_result(sl.loop, fp_ot_otfmap, fc3_otfmap_qnt, fc3.OCH);
+            if (!shard.is_on) wr_mem_trace(sl.loop, sl.infmap_qnt, fc3_otfmap_qnt);
+            if (shard.is_on) shard_store_put(store, sl.loop, sl.label, sl.fc3_otfmap, shard.shard_i);
+        };
+        if (run_pipeline(net, IMG_FIRST, IMG_NUM, PIPE_WORKER_NUM, (CACHE_NUM > 0) ? &cache : NULL, ic, density, emit) != 0) return -1;
+        SERIAL_LOOP_NUM = 0; // already done by the pipeline
+    }
+    
     //===========================================================================
     // loop: LOOP_NUM
     //===========================================================================
 	std::string s;
-	for (int loop = 0; loop < LOOP_NUM; loop++){
+	for (int loop = IMG_FIRST; loop < IMG_FIRST + SERIAL_LOOP_NUM; loop++){
         
         // Initial Setting infmap value.
         //------------------------------------------------------------------------ 
@@ -186,10 +458,18 @@ int main(int argc, char **argv) {
         vector<vector<vector<int8_t>>> infmap_qnt 
             (conv1.ICH, vector<vector<int8_t>>(conv1.IY, vector<int8_t>(conv1.IX, 0))); // 8b
         // rd_conv_infmap(fp_in_infmap, infmap, infmap_qnt, conv1.ICH, conv1.IY, conv1.IX);
-        read_mnist_images(fp_in_infmap, infmap, infmap_qnt, loop+1); 
-        
         int label;
-        read_mnist_labels(fp_in_label, label, loop+1); 
+        if ((ic != NULL) && (loop < ic->img_num)) {
+            const int8_t* img = ic->img + (size_t)loop * 32 * 32;
+            for (int iy = 0; iy < conv1.IY; iy++) {
+                std::copy(img + iy * conv1.IX, img + (iy + 1) * conv1.IX, infmap_qnt[0][iy].begin());
+                std::copy(img + iy * conv1.IX, img + (iy + 1) * conv1.IX, infmap[0][iy].begin());
+            }
+            label = ic->label[loop];
+        } else {
+            read_mnist_images(fp_in_infmap, infmap, infmap_qnt, loop+1); 
+            read_mnist_labels(fp_in_label, label, loop+1); 
+        }
         cout << "Loop: " << loop << " label: " << label << endl; 
         //------------------------------------------------------------------------ 
         
@@ -240,34 +520,45 @@ int main(int argc, char **argv) {
         //========================================================================
         // Calculate LeNet5
         //========================================================================
-        // conv1
-        conv_layer(infmap, conv1_weight, conv1_bias, conv1_otfmap, 
-            conv1.OCH, conv1.OY , conv1.OX , conv1.ICH, conv1.KY , conv1.KX , 
-            M_INV_conv1, B_SCALE_conv1);
-        max_pooling(conv1_otfmap, pool1_otfmap, 
-            pool1.OCH, pool1.OY, pool1.OX, pool1.KY, pool1.KX);
+        cache_key key;
+        bool is_hit = false;
+        if (CACHE_NUM > 0) {
+            key = cache_key_of(cache, infmap_qnt);
+            is_hit = cache_lookup(cache, key, fc3_otfmap);
+        }
+        if (!is_hit) {
+            const layer_backend* const* be = net.plan->layer;
+            
+            // conv1
+            be[0]->conv(infmap, model.conv1, conv1_otfmap, conv1.OY, conv1.OX, M_INV_conv1, NULL);
+            max_pooling(conv1_otfmap, pool1_otfmap, 
+                pool1.OCH, pool1.OY, pool1.OX, pool1.KY, pool1.KX);
         
-        // conv2
-        conv_layer(pool1_otfmap, conv2_weight, conv2_bias, conv2_otfmap, 
-            conv2.OCH, conv2.OY , conv2.OX , conv2.ICH, conv2.KY , conv2.KX , 
-            M_INV_conv2, B_SCALE_conv2);
-        max_pooling(conv2_otfmap, pool2_otfmap, 
-            pool2.OCH, pool2.OY, pool2.OX, pool2.KY, pool2.KX);
+            // conv2
+            be[1]->conv(pool1_otfmap, model.conv2, conv2_otfmap, conv2.OY, conv2.OX, M_INV_conv2, &density[0]);
+            max_pooling(conv2_otfmap, pool2_otfmap, 
+                pool2.OCH, pool2.OY, pool2.OX, pool2.KY, pool2.KX);
         
-        // flatten
-        flatten(pool2_otfmap, fc1_infmap, pool2.OCH, pool2.OY, pool2.OX);
+            // flatten
+            flatten(pool2_otfmap, fc1_infmap, pool2.OCH, pool2.OY, pool2.OX);
         
-        // fc1
-        fc_layer(fc1_infmap, fc1_weight, fc1_bias, fc1_otfmap, 
-                fc1.OCH, fc1.ICH, M_INV_fc1, B_SCALE_fc1, 1);
+            // fc1
+            be[2]->fc(fc1_infmap, model.fc1, fc1_otfmap, M_INV_fc1, 1, &density[1]);
         
-        // fc2
-        fc_layer(fc1_otfmap, fc2_weight, fc2_bias, fc2_otfmap, 
-            fc2.OCH, fc2.ICH, M_INV_fc2, B_SCALE_fc2, 1);
+            // fc2
+            be[3]->fc(fc1_otfmap, model.fc2, fc2_otfmap, M_INV_fc2, 1, &density[2]);
         
-        // fc3
-        fc_layer(fc2_otfmap, fc3_weight, fc3_bias, fc3_otfmap, 
-            fc3.OCH, fc3.ICH, M_INV_fc3, B_SCALE_fc3, 0);
+            // fc3
+            be[4]->fc(fc2_otfmap, model.fc3, fc3_otfmap, M_INV_fc3, 0, &density[3]);
+            if (net.plan->verify_every > 0) {
+                int8_t img[NET_IMG_BYTE];
+                int32_t logit[NET_CLASS_NUM];
+                for (int i = 0; i < NET_IMG_BYTE; i++) img[i] = infmap_qnt[0][i / 32][i % 32];
+                std::copy(fc3_otfmap.begin(), fc3_otfmap.end(), logit);
+                net_verify(net, 0, img, logit);
+            }
+            if (CACHE_NUM > 0) cache_insert(cache, key, fc3_otfmap);
+        }
         
         // Print Test Quantization
         int test_fc3 = 0;
@@ -309,32 +600,12 @@ int main(int argc, char **argv) {
 		wr_conv_infmap(loop, fp_ot_infmap, infmap_qnt, 
             conv1.ICH, conv1.IY, conv1.IX);
         
-        if(loop == 0) {
-            // conv1
-            wr_conv_weight(loop, fp_ot_conv1_weight, conv1_weight_qnt, 
-                conv1.OCH, conv1.ICH, conv1.KY, conv1.KX);
-            wr_bias(loop, fp_ot_conv1_bias, conv1_bias_qnt, conv1.OCH);
-            
-            // conv2
-            wr_conv_weight(loop, fp_ot_conv2_weight, conv2_weight_qnt, 
-                conv2.OCH, conv2.ICH, conv2.KY, conv2.KX);
-            wr_bias(loop, fp_ot_conv2_bias, conv2_bias_qnt, conv2.OCH);
-            
-            // fc1
-            wr_fc_weight(loop, fp_ot_fc1_weight, fc1_weight_qnt, fc1.OCH, fc1.ICH);
-            wr_bias(loop, fp_ot_fc1_bias, fc1_bias_qnt, fc1.OCH);
-            
-            // fc2
-            wr_fc_weight(loop, fp_ot_fc2_weight, fc2_weight_qnt, fc2.OCH, fc2.ICH);
-            wr_bias(loop, fp_ot_fc2_bias, fc2_bias_qnt, fc2.OCH);
-            
-            // fc3
-            wr_fc_weight(loop, fp_ot_fc3_weight, fc3_weight_qnt, fc3.OCH, fc3.ICH);
-            wr_bias(loop, fp_ot_fc3_bias, fc3_bias_qnt, fc3.OCH);
-        }
+        if((loop == 0) && !shard.is_on) wr_param_trace(loop);
         
         // otfmap
         wr_result(loop, fp_ot_otfmap, fc3_otfmap_qnt, fc3.OCH);
+        if (!shard.is_on) wr_mem_trace(loop, infmap_qnt, fc3_otfmap_qnt);
+        if (shard.is_on) shard_store_put(store, loop, label, fc3_otfmap, shard.shard_i);
 	    // for(int och = 0; och < fc3.OCH; och ++){
         //     cout << std::hex << std::setw(2) << std::setfill('0') 
         //         << static_cast<int>(static_cast<uint8_t>(fc3_otfmap_qnt[och])) << std::endl;
@@ -342,6 +613,10 @@ int main(int argc, char **argv) {
         
         
 	}
+    if (shard.is_on) shard_store_close(store);
+    if (CACHE_NUM > 0) cache_report(cache);
+    density_report(density);
+    verify_report(*net.plan);
     
     fp_in_infmap.close();
     fp_in_label.close();
@@ -369,6 +644,9 @@ int main(int argc, char **argv) {
     fp_ot_fc3_weight.close();
     fp_ot_fc3_bias  .close();
     fp_ot_otfmap.close();
+    fp_ot_mem_param.close();
+    fp_ot_mem_infmap.close();
+    fp_ot_mem_result.close();
     
-	return 0;
+	return is_memh_ok ? 0 : -1;
 }
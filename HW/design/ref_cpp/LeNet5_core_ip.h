@@ -26,6 +26,12 @@
 #include <iomanip>
 #include <bitset>
 #include <cstdint>
+#include <cmath>
+#include <list>
+#include <unordered_map>
+#include <atomic>
+#include <functional>
+#include <memory>
 
 using namespace std;
 
@@ -104,6 +110,11 @@ struct layer_scale {
 
 #define FP_OT_OTFMAP "../design/ref_cpp/trace/ot_otfmap.txt"
 
+// $readmemh images of the same run, one 64-bit bus beat per line
+#define FP_OT_MEM_PARAM  "../design/ref_cpp/trace/mem_param.memh"   // NUM_RD_PARAM beats, rd_param_fatfs order
+#define FP_OT_MEM_INFMAP "../design/ref_cpp/trace/mem_infmap.memh"  // RDMA_IMG_BEAT_NUM beats per image
+#define FP_OT_MEM_RESULT "../design/ref_cpp/trace/mem_result.memh"  // expected WDMA beat per image
+
 
 #define INT_LENTH 32
 // #define INBIT_LENTH 68
@@ -124,6 +135,7 @@ void read_mnist_labels(
     int& label, 
     const int image_index
 );
+int quantize_pixel (const unsigned char pixel);  // conv1 input of one MNIST pixel
 void read_mnist_images(
     std::ifstream& fp_in_infmap, 
     vector<vector<vector<int>>>& infmap, 
@@ -224,6 +236,671 @@ void fc_layer (
     const bool relu
 );
 
+// weight prepack, done once at model load
+// output channels in blocks of PACK_OCH_BLK interleaved lanes (zero padded),
+// fc input channels in pairs for widening int16 dot products.
+// bias is stored pre-shifted by B_SHIFT.
+#define NET_LAYER_NUM     5           // conv1, conv2, fc1, fc2, fc3
+#define PACK_OCH_BLK      8
+#define PACK_MAGIC        0x4b50354c  // "L5PK"
+#define PACK_VERSION      2
+#define FP_PACKED_MODEL   "../design/ref_cpp/mnist_dataset/packed_model.bin"
+
+// packed array, owned or a read-only view into the shared model segment
+template <typename T>
+struct pack_array {
+    vector<T> buf;
+    const T*  ext = NULL;
+    size_t    ext_num = 0;
+
+    const T* data () const { return (ext != NULL) ? ext : buf.data(); }
+    size_t   size () const { return (ext != NULL) ? ext_num : buf.size(); }
+    const T* begin () const { return data(); }
+    const T* end () const { return data() + size(); }
+    const T& operator[] (const size_t i) const { return data()[i]; }
+    vector<T>& own () {       // private, writable copy
+        if (ext != NULL) {
+            buf.assign(ext, ext + ext_num);
+            ext = NULL;
+            ext_num = 0;
+        }
+        return buf;
+    }
+    void view (const T* p, const size_t num) {
+        vector<T>().swap(buf);
+        ext = p;
+        ext_num = num;
+    }
+};
+
+// a layer as read from the parameter files. the scalar oracle runs conv_layer /
+// fc_layer on it and never reads the packed arrays, so a packer, model file or
+// model segment fault shows up in the calibration and in --verify
+struct oracle_conv {
+    std::shared_ptr<const vector<vector<vector<vector<int>>>>> weight;  // [och][ich][ky][kx]
+    std::shared_ptr<const vector<int>> bias;                            // unshifted
+    int B_SCALE;
+};
+struct oracle_fc {
+    std::shared_ptr<const vector<vector<int>>> weight;  // [och][ich]
+    std::shared_ptr<const vector<int>> bias;
+    int B_SCALE;
+};
+
+struct packed_conv {
+    int OCH ;
+    int ICH ;
+    int KY  ;
+    int KX  ;
+    int BLK_NUM ;
+    int B_SHIFT ;            // log2(B_SCALE) the bias is shifted by
+    int ACC16_CHUNK ;        // taps per int16 partial sum, 0: int32 only (set by plan_conv_layer)
+    pack_array<int16_t> weight;  // [blk][ich][ky][kx][lane]
+    pack_array<int32_t> bias;    // [BLK_NUM * PACK_OCH_BLK], << B_SHIFT
+    oracle_conv src;             // set by the loader, not in the model file / segment
+};
+struct packed_fc {
+    int OCH ;
+    int ICH ;
+    int ICH_PAIR ;
+    int BLK_NUM ;
+    int B_SHIFT ;
+    int ACC16_CHUNK ;        // ich pairs per int16 partial sum, 0: int32 only (set by plan_fc_layer)
+    pack_array<int16_t> weight;  // [blk][ich / 2][lane][ich % 2]
+    pack_array<int32_t> bias;    // [BLK_NUM * PACK_OCH_BLK], << B_SHIFT
+    oracle_fc src;
+};
+struct packed_model {
+    uint64_t    param_hash;
+    packed_conv conv1;
+    packed_conv conv2;
+    packed_fc   fc1;
+    packed_fc   fc2;
+    packed_fc   fc3;
+    std::shared_ptr<const void> seg;   // model segment the arrays view, NULL: private arrays
+};
+
+void pack_conv_weight (
+    packed_conv& pw,
+    const vector<vector<vector<vector<int8_t>>>>& weight_qnt,
+    const vector<int16_t>& bias_qnt,
+    const int B_SCALE
+);
+void pack_fc_weight (
+    packed_fc& pw,
+    const vector<vector<int8_t>>& weight_qnt,
+    const vector<int16_t>& bias_qnt,
+    const int B_SCALE
+);
+
+// what a packed model file or segment has to match to be used: the int8
+// parameters, the bias shift of every layer and the layer shapes of the RTL
+struct packed_model_key {
+    uint64_t param_hash;
+    int      b_shift[NET_LAYER_NUM];
+    int      shape[NET_LAYER_NUM][4];  // conv: OCH ICH KY KX, fc: OCH ICH 1 1
+};
+bool load_packed_model (const char* path, packed_model& model, const packed_model_key& key);
+bool save_packed_model (const char* path, const packed_model& model);
+bool packed_layer_ok (const packed_model_key& key, const int k, const int* dim, const size_t weight_num,
+                      const size_t bias_num, const int b_shift);   // dim: OCH ICH KY KX BLK_NUM / OCH ICH ICH_PAIR BLK_NUM
+
+// shared read-only model segment
+// the packed model is published once per parameter set as a file on hugetlbfs
+// when mounted, else on tmpfs (transparent hugepages advised), and every
+// process maps it read-only; model copies share the mapping.
+#define MODEL_SEG_MAGIC     0x4d35354c  // "L55M"
+#define MODEL_SEG_VERSION   2
+#define MODEL_SEG_FILE      "lenet5_model.seg"
+#define MODEL_SEG_HUGE_DIR  "/dev/hugepages"
+#define MODEL_SEG_SHM_DIR   "/dev/shm"
+#define MODEL_SEG_ALIGN     64
+
+bool attach_model_segment (packed_model& model, const packed_model_key& key);  // false: none for key
+bool publish_model_segment (const packed_model& model);
+
+// kernels on the packed layout, bit-exact with conv_layer / fc_layer
+// only output channel blocks [BLK0, BLK1) and conv rows [OY0, OY1) are written
+// (the whole layer: 0, BLK_NUM, 0, output rows), the rest of otfmap is left as is
+void conv_layer_packed (
+    const vector<vector<vector<int>>>& infmap,
+    const packed_conv& pw,
+    vector<vector<vector<int>>>& otfmap,
+    const int OX_ ,
+    const int M_INV ,
+    const int BLK0 ,
+    const int BLK1 ,
+    const int OY0 ,
+    const int OY1
+);
+void fc_layer_packed (
+    const vector<int>& infmap,
+    const packed_fc& pw,
+    vector<int>& otfmap,
+    const int M_INV ,
+    const bool relu ,
+    const int BLK0 ,
+    const int BLK1
+);
+
+// sparse-input kernels on the packed layout
+#ifndef SPARSE_DENSITY_TH
+#define SPARSE_DENSITY_TH  0.5  // non-zero input ratio below which the sparse kernel is used (measured crossover)
+#endif
+
+struct layer_density {
+    const char* name;
+    unsigned long nz;          // non-zero inputs
+    unsigned long total;       // inputs
+    unsigned long sparse_num;  // calls per kernel
+    unsigned long dense_num;
+};
+
+void conv_layer_sparse (
+    const vector<vector<vector<int>>>& infmap,
+    const packed_conv& pw,
+    vector<vector<vector<int>>>& otfmap,
+    const int OY_ ,
+    const int OX_ ,
+    const int M_INV
+);
+void fc_layer_sparse (
+    const vector<int>& infmap,
+    const packed_fc& pw,
+    vector<int>& otfmap,
+    const int M_INV ,
+    const bool relu
+);
+void conv_layer_auto (
+    const vector<vector<vector<int>>>& infmap,
+    const packed_conv& pw,
+    vector<vector<vector<int>>>& otfmap,
+    const int OY_ ,
+    const int OX_ ,
+    const int M_INV ,
+    layer_density& stat
+);
+void fc_layer_auto (
+    const vector<int>& infmap,
+    const packed_fc& pw,
+    vector<int>& otfmap,
+    const int M_INV ,
+    const bool relu ,
+    layer_density& stat
+);
+void density_report (const vector<layer_density>& stats);
+
+// accumulator range analysis
+// bounds of every accumulator from the loaded weights and the input range;
+// where a run of ACC16_CHUNK MAC steps provably fits int16, the dense packed
+// kernels accumulate in int16 lanes and widen into int32 after each run.
+#ifndef ACC16_CHUNK_MIN
+#define ACC16_CHUNK_MIN  4  // shorter runs widen too often to pay off
+#endif
+#define RELU_IN_LO    0     // inputs after ReLU (+ max pooling)
+#define RELU_IN_HI    127
+
+struct layer_plan {
+    const char* name;
+    int     in_lo;
+    int     in_hi;
+    int32_t acc_lo;     // over all och, bias included
+    int32_t acc_hi;
+    int     acc_bw;     // signed bits for acc_lo .. acc_hi
+    int     hw_bw;      // HW accumulator width, 0: none declared
+    int     chunk;      // ACC16_CHUNK chosen for the layer
+    int     chunk_max;  // longest int16-safe run, before ACC16_CHUNK_MIN
+};
+
+void conv1_input_range (int& lo, int& hi);
+layer_plan plan_conv_layer (const char* name, packed_conv& pw, const int in_lo, const int in_hi, const int hw_bw);
+layer_plan plan_fc_layer (const char* name, packed_fc& pw, const int in_lo, const int in_hi);
+void plan_report (const vector<layer_plan>& plans);
+
+// whole-network inference on flat int8 layer inputs
+#define NET_IMG_BYTE   (32 * 32)  // padded conv1 input
+#define NET_CLASS_NUM  10
+
+// layer backends
+// a backend runs a conv or fc layer on the packed weights and declares which
+// layers it takes (BACKEND_CAP_*). at startup every backend is timed per layer
+// on BACKEND_CAL_IMG real images and checked against the scalar oracle; the
+// fastest matching one runs the layer. --backend <name> skips the calibration,
+// --verify N re-runs every N-th image on the oracle and counts mismatches.
+#define BACKEND_CAP_CONV    0x1
+#define BACKEND_CAP_FC      0x2
+#define BACKEND_CAP_DATA    0x4   // run time depends on the input values
+#define BACKEND_CAP_ORACLE  0x8   // plain int32 loops, the reference for the others
+#define BACKEND_MAX         8
+#define BACKEND_CAL_IMG     32    // calibration images
+#define BACKEND_CAL_REP     3     // timed passes per backend and layer, the fastest counts
+
+struct layer_backend {
+    const char* name;
+    unsigned    cap;
+    void (*conv) (const vector<vector<vector<int>>>& infmap, const packed_conv& pw, vector<vector<vector<int>>>& otfmap,
+                  const int OY_, const int OX_, const int M_INV, layer_density* stat);   // stat NULL: not counted
+    void (*fc) (const vector<int>& infmap, const packed_fc& pw, vector<int>& otfmap,
+                const int M_INV, const bool relu, layer_density* stat);
+};
+struct backend_opt {
+    std::string name;       // --backend, empty: calibrate
+    int         verify_every;
+    int         team_num;   // --team, threads per image, 0: layers run on the calling thread
+};
+struct backend_plan {
+    const layer_backend* layer[NET_LAYER_NUM];
+    double        cal_us[NET_LAYER_NUM][BACKEND_MAX];  // us per image, < 0: not run or not usable
+    int           cal_img;                             // calibration images, 0: forced
+    int           verify_every;                        // 0: off
+    std::atomic<unsigned long> run_num;
+    std::atomic<unsigned long> verify_num;
+    std::atomic<unsigned long> mismatch_num;
+};
+
+extern const layer_backend* const backend_list[];                  // [0]: scalar oracle
+extern const int backend_num;
+extern const layer_backend* const backend_default[NET_LAYER_NUM];  // without a plan
+extern const layer_backend* const backend_oracle[NET_LAYER_NUM];
+const layer_backend* backend_find (const std::string& name);   // NULL: unknown
+int  parse_backend_opt (int& argc, char** argv, backend_opt& opt);  // removes the options from argv
+void backend_report (const backend_plan& plan);
+void verify_report (const backend_plan& plan);
+
+struct net_team;
+
+struct lenet5_net {
+    layer_scale  scale[NET_LAYER_NUM];
+    int          M_INV[NET_LAYER_NUM];
+    packed_model model;           // bias pre-shifted for scale[]
+    std::shared_ptr<backend_plan> plan;  // NULL: packed conv1, density switch on the others
+    std::shared_ptr<net_team>     team;  // NULL: whole images on the calling thread
+    int          in_lo, in_hi;    // conv1 input range the accumulator plan covers
+};
+
+#define NET_CLS_REJECT  -1   // class answered for an image outside [in_lo, in_hi]
+
+extern const int layer_in_byte[NET_LAYER_NUM];
+extern const char* const layer_name[NET_LAYER_NUM];
+
+void net_init (lenet5_net& net, const packed_model& model, const layer_scale* scale);
+void pad_image (const uint8_t* pixel, int8_t* img);  // 28x28 MNIST pixels -> 32x32 conv1 input
+bool net_img_ok (const lenet5_net& net, const int8_t* img);  // false: a pixel outside [in_lo, in_hi]
+// layers [first, NET_LAYER_NUM) from the input of layer first; returns the class.
+// optional: ckpt[k] receives the inputs of the later layers, logit the fc3 output,
+// density[NET_LAYER_NUM - 1] the conv2 .. fc3 input density
+int net_run_from (const lenet5_net& net, const int first, const int8_t* act, int8_t* const* ckpt, int32_t* logit, layer_density* density);
+int net_run_image (const lenet5_net& net, const int8_t* img, int32_t* logit);
+int net_run_with (const lenet5_net& net, const layer_backend* const* be, const int first, const int8_t* act,
+                  int8_t* const* ckpt, int32_t* logit, layer_density* density);   // be[NET_LAYER_NUM] instead of the plan
+// scalar oracle on every layer, and the --verify check of one result against it
+int  net_run_oracle (const lenet5_net& net, const int first, const int8_t* act, int32_t* logit);
+bool net_verify (const lenet5_net& net, const int first, const int8_t* act, const int32_t* logit);  // false: mismatch
+// backend per layer: calibrated on img_num padded images, or opt.name on every layer it takes
+std::shared_ptr<backend_plan> backend_plan_make (const lenet5_net& net, const backend_opt& opt, const int8_t* img, const int img_num);
+
+// preprocessed dataset, written once from the IDX files
+// LeNet5_core_ip prep [image_num]
+// FP_IMG_CACHE: int8 [N][32][32] conv1 inputs + N labels, mmap'd by the reference
+// while the IDX image file keeps its size and mtime. FP_IMG_RDMA: the same images
+// in the RDMA infmap bus layout (RDMA_IMG_COL_NUM pixels per 64-bit beat) with a
+// per-image hash table; copied to the SD card, the firmware streams it into its
+// DMA buffers without any per-pixel work.
+#define IMG_CACHE_MAGIC     0x3849354c  // "L5I8"
+#define IMG_CACHE_VERSION   1
+#define IMG_CACHE_HDR_BYTE  4096        // images start page aligned
+#define FP_IMG_CACHE        "../design/ref_cpp/mnist_dataset/img_pad32.bin"
+#define IMG_RDMA_MAGIC      0x4c35494d  // "L5IM", firmware byte order
+#define IMG_RDMA_VERSION    1
+#define IMG_RDMA_HDR_BYTE   64          // followed by the hash table, images sector aligned
+#define IMG_RDMA_ALIGN      512
+#define RDMA_IMG_COL_NUM    4           // B_COL_NUM of the firmware
+#define RDMA_IMG_BEAT_NUM   (32 * 32 / RDMA_IMG_COL_NUM)  // NUM_RD_INFMAP
+#define FP_IMG_RDMA         "../design/ref_cpp/mnist_dataset/img_rdma.bin"  // SD: 0:/LeNet5/img_rdma.bin
+
+struct img_cache_hdr {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t img_num;
+    uint32_t label_ofs;   // bytes from the file start, images at IMG_CACHE_HDR_BYTE
+    uint64_t src_byte;    // IDX image file size / mtime
+    int64_t  src_mtime;
+    uint64_t data_hash;   // images + labels
+};
+struct img_rdma_hdr {     // dma_LeNet5_main.cpp: image_header
+    uint32_t magic;
+    uint32_t version;
+    uint32_t img_num;
+    uint32_t beat_num;    // per image
+    uint32_t beat_byte;
+    uint32_t col_num;     // pixels per beat
+    uint32_t data_ofs;    // first image
+    uint32_t reserved;
+    uint64_t src_hash;    // IDX pixels
+    uint64_t table_hash;  // img_num x u64 image hashes after the header
+};
+struct img_cache {
+    int            img_num;
+    const int8_t*  img;     // [img_num][32 * 32]
+    const uint8_t* label;
+    std::shared_ptr<const void> map;
+};
+
+uint64_t fnv1a_64w (uint64_t hash, const uint64_t* word, const size_t num);  // FNV-1a over 64-bit words
+bool img_cache_open (img_cache& ic);  // false: no valid cache for the IDX files, use them directly
+int  run_prep (int argc, char** argv);
+
+// intra-image latency team
+// LeNet5_core_ip latency <image_num> <thread_num>, or --team <thread_num> on serve / shmserve
+// one image is split over a persistent team of threads: conv1 and conv2 by
+// groups of PACK_OCH_BLK output channel blocks x even row bands (a task pools
+// its own rows), fc1 .. fc3 by groups of blocks. every task is a sub-range call
+// of conv_layer_packed / fc_layer_packed. tasks are taken from a counter per
+// layer, and the layers are separated by barriers that spin TEAM_SPIN_NUM
+// polls before parking on a futex. whole-image calls only (no checkpoints or
+// density counts); a second caller while the team is busy runs serially.
+// serve / shmserve keep the team only when team_calibrate finds it faster than
+// the serial backend plan on the calibration images.
+#define TEAM_MAX        16
+#define TEAM_SPIN_NUM   4000
+#define TEAM_TASK_MIN   2     // tasks per thread and layer, at least
+
+std::shared_ptr<net_team> team_make (const int thread_num);   // thread_num counts the caller
+bool team_run_image (net_team& team, const lenet5_net& net, const int8_t* img, int32_t* logit, int& cls);  // false: busy
+bool team_calibrate (net_team& team, const lenet5_net& net, const int8_t* img, const int img_num);  // false: serial is faster
+void team_report (const net_team& team);
+int  run_latency (int argc, char** argv, const lenet5_net& net, const img_cache* ic);
+
+// RTL parameters, read at start-up from the Verilog sources (paths from HW/sim)
+// only integer literal assignments are taken. the WDMA result record is the
+// firmware's (dma_LeNet5_result.h), checked against DATA_IDX_BW.
+#define FP_RTL_DEFINES  "../design/rtl_v/defines_parameter_LeNet5.vh"
+#define FP_RTL_DMA_TOP  "../design/rtl_v/dma/dma_LeNet5_top.v"
+
+struct rtl_param {
+    int CONV_O_F_BW[2];   // accumulator width of the HW conv cores
+    int FC_ICH_B[3];      // fc weight beats per output channel
+    int AXI_DATA_BYTE;    // C_M00_AXI_DATA_WIDTH / 8 of dma_LeNet5_top.v
+    int NUM_RD_PARAM;     // RDMA param beats of dma_LeNet5_top.v
+    int DATA_IDX_BW;      // WDMA result beat: data index bits
+    int LAYER_SHAPE[NET_LAYER_NUM][4];  // conv: OCH ICH KY KX, fc: OCH ICH 1 1
+};
+
+bool     rd_rtl_param (rtl_param& rtl);   // false: a file or parameter is missing, or the copies disagree
+uint64_t rtl_result_rec (const int idx, const int cls);   // RESULT_REC of the firmware
+int      rtl_result_bit ();                               // bits a result record uses
+
+// AXI DMA transfer model of rdma.v / wdma.v
+// LeNet5_core_ip axi [max_burst] [outstanding] [rd_latency_cycles] [base_ofs]
+// every transfer is cut into INCR bursts of at most max_burst beats that never
+// cross a 4 KB page. an AR takes AXI_AR_CYC cycles of its FSM, at most
+// outstanding bursts are in flight (the burst length FIFO), and R beats arrive
+// one per cycle rd_latency cycles after their AR. the param and infmap layouts
+// are the ones rd_param_fatfs / the RDMA image file produce; WDMA writes one
+// result beat per image. the latencies are assumptions for the PS HP port.
+#define AXI_MAX_BURST       16      // NUM_MAX_BURST
+#define AXI_MAX_BURST_LIM   256     // AR_LEN is 8 bits
+#define AXI_MOR_REQ         4       // NUM_AXI_AR_MOR_REQ, depth of the burst length sync_fifo
+#define AXI_PAGE_BYTE       4096
+#define AXI_AR_CYC          3       // AR FSM IDLE -> PRE -> RUN, AR_READY assumed high
+#define AXI_RD_LAT_CYC      40
+#define AXI_WR_LAT_CYC      20      // last W beat to B response
+#define AXI_OUT_FIFO_REG    2       // core -> WDMA sync_fifo: skid buffers on both sides (FIFO_S_REG, FIFO_M_REG)
+#define AXI_CLK_MHZ         100
+
+int run_axi_model (int argc, char** argv, const rtl_param& rtl);
+
+// quantization-scale sweep
+// LeNet5_core_ip sweep <image_num> <thread_num> <layer>=<o_inv>[,<o_inv>...] ...
+#define SWEEP_BLK_IMG    250   // images per work item
+#define CKPT_MAGIC       0x4b43354c  // "L5CK"
+#define CKPT_VERSION     2
+#define FP_SWEEP_CKPT    "../design/ref_cpp/mnist_dataset/sweep_ckpt.bin"
+
+int run_sweep (
+    int argc,
+    char** argv,
+    const packed_model& model,
+    const layer_scale* base,   // [NET_LAYER_NUM]
+    std::ifstream& fp_in_infmap,
+    std::ifstream& fp_in_label,
+    const img_cache* ic,       // NULL: images from the IDX files
+    const std::shared_ptr<backend_plan>& plan
+);
+
+// inference daemon over a UNIX domain socket
+// LeNet5_core_ip serve <socket_path> <max_batch> <max_wait_us> [queue_depth]
+// LeNet5_core_ip loadgen <socket_path> <rate_per_s> <request_num> [conn_num]
+#define SERVE_MAGIC        0x5135354c  // "L55Q"
+#define SERVE_FMT_RAW28    28          // 28x28 MNIST pixels, preprocessed by the daemon
+#define SERVE_FMT_PAD32    32          // 32x32 int8 conv1 input
+#define SERVE_QUEUE_DEPTH  256         // queued requests before clients stop being read
+#define SERVE_CONN_MAX     64
+#define SERVE_OUT_MAX      65536       // unsent response bytes before a client stops being read
+#define LOADGEN_CONN_NUM   4
+
+struct serve_req_hdr {   // followed by 784 or 1024 bytes
+    uint32_t magic;
+    uint32_t id;         // echoed in the response
+    uint32_t format;     // SERVE_FMT_*
+    uint32_t reserved;
+};
+struct serve_rsp {
+    uint32_t magic;
+    uint32_t id;
+    int32_t  cls;
+    uint32_t batch;      // size of the micro-batch the request ran in
+    int32_t  logit[NET_CLASS_NUM];
+};
+
+int run_serve (int argc, char** argv, const lenet5_net& net);
+int run_loadgen (int argc, char** argv);
+int rd_idx_set (const int num, vector<uint8_t>& pixel, vector<uint8_t>& label);
+
+// shared-memory request ring (POSIX shm), one client process per ring
+// LeNet5_core_ip shmserve <shm_name> [slot_num]
+// LeNet5_core_ip shmclient <shm_name> <request_num> [window]
+// the client writes the padded image into a FREE slot and marks it READY, the
+// engine runs it in place and writes the result into the same slot (DONE),
+// the client reads it and frees the slot. slots are used strictly in order.
+// slot states are futex words; a side only sleeps after spinning SHM_SPIN_NUM
+// polls and the other side only calls FUTEX_WAKE when the sleeper flagged it.
+#define SHM_MAGIC       0x5235354c  // "L55R"
+#define SHM_VERSION     2
+#define SHM_SLOT_NUM    64          // power of two
+#define SHM_SPIN_NUM    2000
+#define SHM_POLL_US     100000      // futex timeout, engine checks SIGINT at this rate
+#define SHM_SLOT_FREE   0
+#define SHM_SLOT_READY  1
+#define SHM_SLOT_DONE   2
+
+struct shm_ring_hdr {
+    uint32_t magic;                              // set last by the engine
+    uint32_t version;
+    uint32_t slot_num;
+    uint32_t slot_byte;
+    uint64_t param_hash;                         // model served by the engine
+    uint32_t engine_pid;                         // a second engine refuses a live one
+    alignas(64) std::atomic<uint32_t> engine_wait;   // engine sleeps on a slot state
+    alignas(64) std::atomic<uint32_t> client_wait;   // client sleeps on a slot state
+    alignas(64) std::atomic<uint32_t> client_pid;    // 0: no client attached
+    uint32_t submit_pos;                         // client cursors, kept here so the
+    uint32_t reap_pos;                           // next client resumes in step
+};
+struct alignas(64) shm_slot {
+    std::atomic<uint32_t> state;                 // SHM_SLOT_*
+    uint32_t id;                                 // chosen by the client
+    int32_t  cls;
+    int32_t  logit[NET_CLASS_NUM];
+    int8_t   img[NET_IMG_BYTE];                  // padded 32x32 conv1 input
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free && (sizeof(std::atomic<uint32_t>) == 4),
+              "slot states are used as futex words");
+
+struct shm_result {
+    uint32_t id;
+    int32_t  cls;
+    int32_t  logit[NET_CLASS_NUM];
+};
+
+// client library
+struct shm_client {
+    int           fd;
+    size_t        map_byte;
+    shm_ring_hdr* hdr;
+    shm_slot*     slot;
+    uint32_t      mask;
+    unsigned long sleep_num;                     // futex waits for results
+};
+int     shm_client_open (shm_client& c, const char* name);    // 0: attached
+int8_t* shm_client_slot (shm_client& c);                      // image buffer of the next slot, NULL: ring full
+void    shm_client_submit (shm_client& c, const uint32_t id); // publish the slot filled through shm_client_slot
+bool    shm_client_reap (shm_client& c, shm_result& r, const int timeout_us);  // oldest result
+int     shm_client_pending (const shm_client& c);
+void    shm_client_close (shm_client& c);
+
+int run_shm_serve (int argc, char** argv, const lenet5_net& net);
+int run_shm_client (int argc, char** argv);
+
+// requantization of an accumulator that already holds the shifted bias
+inline int requant_acc (const int32_t acc, const int M_INV, const bool relu) {
+    int32_t SHIFT  = log2(M_INV);
+    int32_t scaled = (acc + (M_INV / 2)) >> SHIFT;  // Rounding
+    if ((scaled < 0) && (relu)) scaled = 0;         // ReLU
+    if (scaled > 127) scaled = 127;
+    return static_cast<int>(scaled);
+}
+
+// result cache
+// key: 128-bit hash of the quantized 32x32 infmap seeded with the parameter
+// fingerprint, value: fc3 logits. least recently used entry is evicted.
+#define FNV_OFFSET  0xcbf29ce484222325ULL
+#define FNV_PRIME   0x100000001b3ULL
+struct cache_key {
+    uint64_t h0;
+    uint64_t h1;
+    bool operator== (const cache_key& k) const { return (h0 == k.h0) && (h1 == k.h1); }
+};
+struct cache_key_hash {
+    size_t operator() (const cache_key& k) const { return (size_t)k.h0; }
+};
+struct result_cache {
+    size_t capacity;  // 0: disabled
+    uint64_t param_hash;
+    list<pair<cache_key, vector<int>>> lru;  // front = most recent
+    unordered_map<cache_key, list<pair<cache_key, vector<int>>>::iterator, cache_key_hash> index;
+    unsigned long hit;
+    unsigned long miss;
+};
+
+uint64_t param_hash_i8 (uint64_t hash, const vector<int8_t>& v);
+uint64_t param_hash_i16 (uint64_t hash, const vector<int16_t>& v);
+void cache_init (result_cache& cache, const size_t capacity, const uint64_t param_hash);
+cache_key cache_key_of (
+    const result_cache& cache,
+    const vector<vector<vector<int8_t>>>& infmap_qnt
+);
+bool cache_lookup (result_cache& cache, const cache_key& key, vector<int>& fc3_otfmap);
+void cache_insert (result_cache& cache, const cache_key& key, const vector<int>& fc3_otfmap);
+void cache_report (const result_cache& cache);
+
+// three-stage pipeline of the simulation loop
+// ingest (IDX read + preprocessing) -> compute workers -> emit (traces, in order),
+// connected by single-producer / single-consumer rings of slot indices.
+// slots are pre-allocated and recycled through a free ring from emit to ingest.
+#define PIPE_SLOT_NUM    16
+#define PIPE_WORKER_MAX  8
+
+struct pipe_slot {
+    int     loop;
+    int     label;
+    int8_t  img[NET_IMG_BYTE];
+    vector<vector<vector<int8_t>>> infmap_qnt;  // 1x32x32, trace and cache key
+    vector<int> fc3_otfmap;
+    bool    is_hit;
+};
+
+// ring of slot indices; head is written by the consumer only, tail by the producer only
+struct spsc_ring {
+    vector<int> buf;
+    size_t      mask;
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+    // occupancy seen by the producer at each push, and stalls on either side
+    unsigned long push_num;
+    unsigned long occ_sum;
+    unsigned long occ_max;
+    unsigned long full_num;
+    unsigned long empty_num;
+};
+
+int run_pipeline (
+    const lenet5_net& net,
+    const int first,                               // image index of the first loop
+    const int loop_num,
+    const int worker_num,
+    result_cache* cache,                           // NULL: no result cache
+    const img_cache* ic,                           // NULL: images from the IDX files
+    vector<layer_density>& density,
+    const std::function<void (const pipe_slot&)>& emit
+);
+
+// multi-process evaluation
+// LeNet5_core_ip <srand_val> <loop_num> ... --shard i/n | --range start:count [--out path] [--run token]
+// LeNet5_core_ip launch <proc_num> <srand_val> <loop_num> [cache_entries] [pipe_workers]
+// LeNet5_core_ip merge [path]
+// a shard runs images [start, start + count) of loop_num and stores one record
+// per image in its own part of a results file shared by every shard, instead of
+// the trace files. merge writes ot_otfmap.txt and the accuracy from it.
+// the file belongs to one run (srand_val, loop_num and the --run token), a
+// shard of another run does not reuse its records.
+#define SHARD_MAGIC       0x5335354c  // "L55S"
+#define SHARD_VERSION     2
+#define SHARD_HDR_BYTE    4096        // records start page aligned
+#define SHARD_ALIGN_IMG   256         // --shard chunks: whole 4 KB pages of records
+#define FP_SHARD_RESULT   "../design/ref_cpp/trace/shard_result.bin"
+#define FP_SHARD_LOG      "../design/ref_cpp/trace/shard_"
+
+struct shard_opt {
+    bool        is_on;
+    int         shard_i, shard_n;   // --shard, shard_n = 0: --range
+    int         start, count;
+    std::string path;
+    std::string run;                // --run token, "": srand_val + loop_num only
+};
+struct shard_hdr {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t img_num;
+    uint32_t rec_byte;
+    uint64_t param_hash;
+    uint64_t run_id;        // shard_run_id
+};
+struct shard_rec {          // 16 B
+    uint8_t  state;         // 1: written, set last
+    uint8_t  label;
+    uint8_t  cls;
+    uint8_t  shard;
+    int8_t   logit[NET_CLASS_NUM];
+    uint8_t  reserved[2];
+};
+struct shard_store {
+    int        fd;
+    size_t     map_byte;
+    shard_hdr* hdr;
+    shard_rec* rec;
+};
+
+int  parse_shard_opt (int& argc, char** argv, shard_opt& opt);  // removes the options from argv
+int  shard_resolve (shard_opt& opt, const int loop_num);       // --shard i/n into start / count
+uint64_t shard_run_id (const shard_opt& opt, const int seed, const int loop_num);
+int  shard_store_open (shard_store& st, const std::string& path, const int img_num, const uint64_t param_hash, const uint64_t run_id);
+void shard_store_put (shard_store& st, const int idx, const int label, const vector<int>& fc3_otfmap, const int shard);
+void shard_store_close (shard_store& st);
+int  run_launch (int argc, char** argv);
+int  run_merge (int argc, char** argv);
+
+
 // file write
 void wr_conv_infmap (
     const int loop,
@@ -281,4 +958,20 @@ void wr_result (
     const vector<int8_t>& otfmap_qnt,
     const int OCH_ 
 );
+
+// bus beat packer shared by the traces, 'prep' and the memory images
+void rdma_pack_img (const int8_t* img, uint64_t* beat);  // 32x32 -> RDMA_IMG_BEAT_NUM beats
+void rdma_pack_conv (
+    const vector<vector<vector<vector<int8_t>>>>& weight_qnt,
+    const vector<int16_t>& bias_qnt,
+    vector<uint64_t>& beat     // appended
+);
+void rdma_pack_fc (
+    const vector<vector<int8_t>>& weight_qnt,
+    const vector<int16_t>& bias_qnt,
+    const int ICH_B,           // weight beats per output channel
+    vector<uint64_t>& beat     // appended
+);
+int  result_class (const vector<int8_t>& otfmap_qnt, const int OCH_);
+void wr_memh (std::ofstream& fp, const uint64_t* beat, const size_t num);
 #endif 
\ No newline at end of file
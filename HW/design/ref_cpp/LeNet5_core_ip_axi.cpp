@@ -0,0 +1,203 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.27
+// Associated Filename: LeNet5_core_ip_axi.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Burst and bandwidth model of the RDMA / WDMA transfers
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     The firmware only prints the time of a whole parameter load. This model
+//     splits the transfers the way rdma.v and wdma.v issue them and prices
+//     them in AXI clock cycles, per parameter segment, so a layout change can
+//     be judged before the RTL is touched. Each segment is also priced as if
+//     its useful bytes filled every beat.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <deque>
+#include "LeNet5_core_ip.h"
+
+struct axi_cfg {
+    int max_burst;
+    int mor;         // outstanding bursts
+    int rd_lat;
+    int base_ofs;    // byte offset of the buffer in its 4 KB page
+    int data_byte;   // bytes per beat
+};
+struct axi_seg {
+    std::string name;
+    long beat_num;
+    int  useful_byte;   // per beat
+};
+
+// one RDMA job: cycle of the last R beat of every beat, returns the job cycles
+static long rdma_job (const axi_cfg& c, const long beat_num, vector<long>* beat_end, long& burst_num) {
+    std::deque<long> inflight;           // last beat cycle of each outstanding burst
+    long t_ar = 2;                       // main FSM IDLE -> PRE -> RUN
+    long r_free = 0;
+    long addr = c.base_ofs, issued = 0;
+    burst_num = 0;
+    if (beat_end) beat_end->assign(beat_num, 0);
+    while (issued < beat_num) {
+        long len = std::min<long>(c.max_burst, beat_num - issued);
+        len = std::min<long>(len, (AXI_PAGE_BYTE - addr % AXI_PAGE_BYTE) / c.data_byte);
+        long t = t_ar;
+        if ((int)inflight.size() == c.mor) {
+            t = std::max(t, inflight.front() + 1);   // FIFO pop on R_LAST, seen by the AR FSM a cycle later
+            inflight.pop_front();
+        }
+        const long hs = t + AXI_AR_CYC - 1;
+        const long first = std::max(hs + c.rd_lat, r_free);
+        if (beat_end) for (long b = 0; b < len; b++) (*beat_end)[issued + b] = first + b;
+        r_free = first + len;
+        inflight.push_back(first + len - 1);
+        t_ar = hs + 1;
+        issued += len;
+        addr += len * c.data_byte;
+        burst_num++;
+    }
+    return r_free + 1;   // DONE
+}
+
+// one result beat: AW FSM, W FSM, one W beat, B response, DONE
+static long wdma_job () {
+    return AXI_OUT_FIFO_REG + 2 + AXI_AR_CYC + 1 + 1 + AXI_WR_LAT_CYC + 1;
+}
+
+static vector<axi_seg> param_segs (const rtl_param& rtl) {
+    const conv_param conv[2] = {{6, 28, 28, 1, 32, 32, 5, 5}, {16, 10, 10, 6, 14, 14, 5, 5}};
+    const fc_param fc[3] = {{120, 400}, {84, 120}, {10, 84}};
+    vector<axi_seg> seg;
+    for (int k = 0; k < 2; k++) {
+        // one beat per (och, ich, ky) row of KX weights, then one beat per 16-bit bias
+        seg.push_back({layer_name[k] + std::string(" w"), (long)conv[k].OCH * conv[k].ICH * conv[k].KY, conv[k].KX});
+        seg.push_back({layer_name[k] + std::string(" b"), conv[k].OCH, 2});
+    }
+    for (int k = 0; k < 3; k++) {
+        // one beat per (och, ich block) of ICH / ICH_B weights
+        seg.push_back({layer_name[k + 2] + std::string(" w"), (long)fc[k].OCH * rtl.FC_ICH_B[k], fc[k].ICH / rtl.FC_ICH_B[k]});
+        seg.push_back({layer_name[k + 2] + std::string(" b"), fc[k].OCH, 2});
+    }
+    return seg;
+}
+
+// cycles of each segment inside one job: last beat of the segment minus the previous one
+static vector<long> seg_cycles (const axi_cfg& c, const vector<long>& seg_beat, long& total, long& burst_num) {
+    long beat_num = 0;
+    for (size_t i = 0; i < seg_beat.size(); i++) beat_num += seg_beat[i];
+    vector<long> end;
+    total = rdma_job(c, beat_num, &end, burst_num);
+    vector<long> cyc(seg_beat.size(), 0);
+    long b = 0, prev = 0;
+    for (size_t i = 0; i < seg_beat.size(); i++) {
+        if (seg_beat[i] == 0) continue;
+        b += seg_beat[i];
+        cyc[i] = end[b - 1] - prev;
+        prev = end[b - 1];
+    }
+    if (!cyc.empty()) cyc.back() += total - prev;   // DONE on the last segment
+    return cyc;
+}
+
+static double cyc_us (const long cyc) {
+    return 1.0 * cyc / AXI_CLK_MHZ;
+}
+
+int run_axi_model (int argc, char** argv, const rtl_param& rtl) {
+    if (argc > 6) {
+        printf("Usage : <executable> axi [max_burst] [outstanding] [rd_latency_cycles] [base_ofs]\n");
+        return -1;
+    }
+    axi_cfg c = {AXI_MAX_BURST, AXI_MOR_REQ, AXI_RD_LAT_CYC, 0, rtl.AXI_DATA_BYTE};
+    if (argc > 2) c.max_burst = atoi(argv[2]);
+    if (argc > 3) c.mor       = atoi(argv[3]);
+    if (argc > 4) c.rd_lat    = atoi(argv[4]);
+    if (argc > 5) c.base_ofs  = atoi(argv[5]);
+    if ((c.max_burst < 1) || (c.max_burst > AXI_MAX_BURST_LIM) || (c.mor < 1) || (c.rd_lat < 1) ||
+        (c.base_ofs < 0) || (c.base_ofs % rtl.AXI_DATA_BYTE != 0)) {
+        std::cerr << "axi: max_burst 1 .. " << AXI_MAX_BURST_LIM << ", outstanding and rd_latency >= 1, "
+                  << "base_ofs a multiple of " << rtl.AXI_DATA_BYTE << std::endl;
+        return -1;
+    }
+
+    const vector<axi_seg> seg = param_segs(rtl);
+    vector<long> beat(seg.size()), dense(seg.size());
+    long beat_sum = 0, useful_sum = 0, dense_sum = 0;
+    for (size_t i = 0; i < seg.size(); i++) {
+        beat[i]  = seg[i].beat_num;
+        dense[i] = (seg[i].beat_num * seg[i].useful_byte + rtl.AXI_DATA_BYTE - 1) / rtl.AXI_DATA_BYTE;
+        beat_sum   += beat[i];
+        dense_sum  += dense[i];
+        useful_sum += seg[i].beat_num * seg[i].useful_byte;
+    }
+    if (beat_sum != rtl.NUM_RD_PARAM) {
+        std::cerr << "axi: param layout has " << beat_sum << " beats, NUM_RD_PARAM is " << rtl.NUM_RD_PARAM << std::endl;
+        return -1;
+    }
+    long total, dense_total, burst_num, dense_burst;
+    const vector<long> cyc = seg_cycles(c, beat, total, burst_num);
+    const vector<long> dense_cyc = seg_cycles(c, dense, dense_total, dense_burst);
+
+    std::ios state(NULL);
+    state.copyfmt(cout);
+    cout << "axi: " << rtl.AXI_DATA_BYTE * 8 << "-bit bus at " << AXI_CLK_MHZ << " MHz, bursts of <= " << c.max_burst
+         << " beats, " << c.mor << " outstanding, read latency " << c.rd_lat << " cycles, base +" << c.base_ofs << " B" << endl;
+    cout << "param load (RDMA, one job)" << endl;
+    cout << "  segment    beats  B/beat   eff %     cycles        us   dense beats  dense us" << endl;
+    cout << std::fixed;
+    for (size_t i = 0; i < seg.size(); i++) {
+        cout << "  " << std::left << std::setw(8) << seg[i].name << std::right << std::setw(8) << beat[i]
+             << std::setw(8) << seg[i].useful_byte << std::setprecision(1) << std::setw(8)
+             << 100.0 * seg[i].useful_byte / rtl.AXI_DATA_BYTE << std::setw(11) << cyc[i] << std::setprecision(2)
+             << std::setw(10) << cyc_us(cyc[i]) << std::setw(14) << dense[i] << std::setw(10) << cyc_us(dense_cyc[i]) << endl;
+    }
+    cout << "  " << std::left << std::setw(8) << "total" << std::right << std::setw(8) << beat_sum << std::setprecision(2)
+         << std::setw(8) << 1.0 * useful_sum / beat_sum << std::setprecision(1) << std::setw(8)
+         << 100.0 * useful_sum / beat_sum / rtl.AXI_DATA_BYTE << std::setw(11) << total << std::setprecision(2)
+         << std::setw(10) << cyc_us(total) << std::setw(14) << dense_sum << std::setw(10) << cyc_us(dense_total) << endl;
+    cout << "  " << burst_num << " bursts (" << dense_burst << " dense), " << useful_sum << " useful bytes, "
+         << std::setprecision(1) << 1.0 * useful_sum / cyc_us(total) << " MB/s useful of "
+         << 1.0 * rtl.AXI_DATA_BYTE * AXI_CLK_MHZ << " MB/s peak" << endl;
+
+    // per image: 32x32 int8 infmap in, one result beat out
+    const long img_beat = RDMA_IMG_BEAT_NUM;
+    const long img_dense = (32 * 32 + rtl.AXI_DATA_BYTE - 1) / rtl.AXI_DATA_BYTE;
+    long img_burst, img_dense_burst;
+    const long img_cyc = rdma_job(c, img_beat, NULL, img_burst);
+    const long img_dense_cyc = rdma_job(c, img_dense, NULL, img_dense_burst);
+    const long res_cyc = wdma_job();
+    cout << "per image" << endl;
+    cout << "  infmap (RDMA): " << img_beat << " beats x " << RDMA_IMG_COL_NUM << " B (" << std::setprecision(1)
+         << 100.0 * RDMA_IMG_COL_NUM / rtl.AXI_DATA_BYTE << " %), " << img_burst << " bursts, " << img_cyc << " cycles = "
+         << std::setprecision(2) << cyc_us(img_cyc) << " us; dense " << img_dense << " beats, " << img_dense_cyc
+         << " cycles = " << cyc_us(img_dense_cyc) << " us" << endl;
+    cout << "  result (WDMA): 1 beat x " << rtl_result_bit() << " bits (" << std::setprecision(1)
+         << 100.0 * rtl_result_bit() / (rtl.AXI_DATA_BYTE * 8) << " %), " << res_cyc << " cycles = " << std::setprecision(2)
+         << cyc_us(res_cyc) << " us" << endl;
+    cout << "  DMA bound without overlap: " << std::setprecision(0) << 1e6 / cyc_us(img_cyc + res_cyc)
+         << " images/s (" << 1e6 / cyc_us(img_dense_cyc + res_cyc) << " dense)" << endl;
+
+    // the same param load under other burst / outstanding limits
+    cout << "param load us by burst length (rows) and outstanding bursts (columns)" << endl;
+    const int burst_try[] = {16, 32, 64, 128, 256};
+    const int mor_try[] = {1, 2, 4, 8};
+    cout << "  burst";
+    for (int m : mor_try) cout << std::setw(10) << m;
+    cout << endl;
+    for (int b : burst_try) {
+        cout << "  " << std::setw(5) << b;
+        for (int m : mor_try) {
+            axi_cfg t = c;
+            t.max_burst = b;
+            t.mor = m;
+            long n;
+            cout << std::setprecision(2) << std::setw(10) << cyc_us(rdma_job(t, beat_sum, NULL, n));
+        }
+        cout << endl;
+    }
+    cout.copyfmt(state);
+    return 0;
+}
@@ -0,0 +1,293 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.25
+// Associated Filename: LeNet5_core_ip_backend.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Layer backends, startup calibration and the scalar oracle
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     The fastest kernel for a layer depends on the host and on the input
+//     density of the layer. Instead of fixing it at build time, every backend
+//     is timed on each layer it takes with a few real images when the run
+//     starts, and its outputs are compared with the scalar oracle on the same
+//     images; a backend that differs is never picked.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include "LeNet5_core_ip.h"
+
+typedef std::chrono::steady_clock cal_clock;
+
+//===========================================================================
+// backends
+//===========================================================================
+static void count_conv_input (const vector<vector<vector<int>>>& infmap, layer_density* stat, const bool is_sparse) {
+    if (stat == NULL) return;
+    for (size_t ich = 0; ich < infmap.size(); ich++) {
+        for (size_t iy = 0; iy < infmap[ich].size(); iy++) {
+            for (size_t ix = 0; ix < infmap[ich][iy].size(); ix++) stat->nz += (infmap[ich][iy][ix] != 0);
+            stat->total += infmap[ich][iy].size();
+    } }
+    (is_sparse ? stat->sparse_num : stat->dense_num)++;
+}
+
+static void count_fc_input (const vector<int>& infmap, layer_density* stat, const bool is_sparse) {
+    if (stat == NULL) return;
+    for (size_t ich = 0; ich < infmap.size(); ich++) stat->nz += (infmap[ich] != 0);
+    stat->total += infmap.size();
+    (is_sparse ? stat->sparse_num : stat->dense_num)++;
+}
+
+// scalar oracle: conv_layer / fc_layer of the simulation loop on the unpacked
+// parameters (packed_conv::src), one int32 accumulator per output
+static void conv_scalar (const vector<vector<vector<int>>>& infmap, const packed_conv& pw, vector<vector<vector<int>>>& otfmap,
+                         const int OY_, const int OX_, const int M_INV, layer_density* stat) {
+    count_conv_input(infmap, stat, false);
+    const oracle_conv& src = pw.src;
+    const vector<vector<vector<vector<int>>>>& w = *src.weight;
+    conv_layer(infmap, w, *src.bias, otfmap, w.size(), OY_, OX_, w[0].size(), w[0][0].size(), w[0][0][0].size(), M_INV, src.B_SCALE);
+}
+static void fc_scalar (const vector<int>& infmap, const packed_fc& pw, vector<int>& otfmap,
+                       const int M_INV, const bool relu, layer_density* stat) {
+    count_fc_input(infmap, stat, false);
+    const oracle_fc& src = pw.src;
+    fc_layer(infmap, *src.weight, *src.bias, otfmap, src.weight->size(), (*src.weight)[0].size(), M_INV, src.B_SCALE, relu);
+}
+static void conv_packed (const vector<vector<vector<int>>>& infmap, const packed_conv& pw, vector<vector<vector<int>>>& otfmap,
+                         const int OY_, const int OX_, const int M_INV, layer_density* stat) {
+    count_conv_input(infmap, stat, false);
+    conv_layer_packed(infmap, pw, otfmap, OX_, M_INV, 0, pw.BLK_NUM, 0, OY_);
+}
+static void fc_packed (const vector<int>& infmap, const packed_fc& pw, vector<int>& otfmap,
+                       const int M_INV, const bool relu, layer_density* stat) {
+    count_fc_input(infmap, stat, false);
+    fc_layer_packed(infmap, pw, otfmap, M_INV, relu, 0, pw.BLK_NUM);
+}
+static void conv_sparse (const vector<vector<vector<int>>>& infmap, const packed_conv& pw, vector<vector<vector<int>>>& otfmap,
+                         const int OY_, const int OX_, const int M_INV, layer_density* stat) {
+    count_conv_input(infmap, stat, true);
+    conv_layer_sparse(infmap, pw, otfmap, OY_, OX_, M_INV);
+}
+static void fc_sparse (const vector<int>& infmap, const packed_fc& pw, vector<int>& otfmap,
+                       const int M_INV, const bool relu, layer_density* stat) {
+    count_fc_input(infmap, stat, true);
+    fc_layer_sparse(infmap, pw, otfmap, M_INV, relu);
+}
+static void conv_auto (const vector<vector<vector<int>>>& infmap, const packed_conv& pw, vector<vector<vector<int>>>& otfmap,
+                       const int OY_, const int OX_, const int M_INV, layer_density* stat) {
+    layer_density unused = {NULL, 0, 0, 0, 0};
+    conv_layer_auto(infmap, pw, otfmap, OY_, OX_, M_INV, (stat != NULL) ? *stat : unused);
+}
+static void fc_auto (const vector<int>& infmap, const packed_fc& pw, vector<int>& otfmap,
+                     const int M_INV, const bool relu, layer_density* stat) {
+    layer_density unused = {NULL, 0, 0, 0, 0};
+    fc_layer_auto(infmap, pw, otfmap, M_INV, relu, (stat != NULL) ? *stat : unused);
+}
+
+static const layer_backend be_scalar = {"scalar", BACKEND_CAP_CONV | BACKEND_CAP_FC | BACKEND_CAP_ORACLE, conv_scalar, fc_scalar};
+static const layer_backend be_packed = {"packed", BACKEND_CAP_CONV | BACKEND_CAP_FC, conv_packed, fc_packed};
+static const layer_backend be_sparse = {"sparse", BACKEND_CAP_CONV | BACKEND_CAP_FC | BACKEND_CAP_DATA, conv_sparse, fc_sparse};
+static const layer_backend be_auto   = {"auto", BACKEND_CAP_CONV | BACKEND_CAP_FC | BACKEND_CAP_DATA, conv_auto, fc_auto};
+
+const layer_backend* const backend_list[] = {&be_scalar, &be_packed, &be_sparse, &be_auto};  // [0]: oracle
+const int backend_num = sizeof(backend_list) / sizeof(backend_list[0]);
+const layer_backend* const backend_default[NET_LAYER_NUM] = {&be_packed, &be_auto, &be_auto, &be_auto, &be_auto};
+const layer_backend* const backend_oracle[NET_LAYER_NUM]  = {&be_scalar, &be_scalar, &be_scalar, &be_scalar, &be_scalar};
+
+static bool backend_takes (const layer_backend* b, const int k) {
+    return (b->cap & ((k < 2) ? BACKEND_CAP_CONV : BACKEND_CAP_FC)) != 0;
+}
+
+const layer_backend* backend_find (const std::string& name) {
+    for (int b = 0; b < backend_num; b++) {
+        if (name == backend_list[b]->name) return backend_list[b];
+    }
+    return NULL;
+}
+
+int parse_backend_opt (int& argc, char** argv, backend_opt& opt) {
+    opt.name.clear();
+    opt.verify_every = 0;
+    opt.team_num = 0;
+    int n = 1;
+    for (int i = 1; i < argc; i++) {
+        const std::string a = argv[i];
+        if ((a != "--backend") && (a != "--verify") && (a != "--team")) {
+            argv[n++] = argv[i];
+            continue;
+        }
+        if (i + 1 == argc) {
+            std::cerr << a << ": missing value" << std::endl;
+            return -1;
+        }
+        const char* v = argv[++i];
+        if (a == "--backend") {
+            if (backend_find(v) == NULL) {
+                std::cerr << "--backend " << v << ": expected one of";
+                for (int b = 0; b < backend_num; b++) std::cerr << " " << backend_list[b]->name;
+                std::cerr << std::endl;
+                return -1;
+            }
+            opt.name = v;
+        } else if (a == "--team") {
+            opt.team_num = atoi(v);
+            if ((opt.team_num < 1) || (opt.team_num > TEAM_MAX)) {
+                std::cerr << "--team " << v << ": expected 1 .. " << TEAM_MAX << " threads" << std::endl;
+                return -1;
+            }
+        } else {
+            opt.verify_every = atoi(v);
+            if (opt.verify_every <= 0) {
+                std::cerr << "--verify " << v << ": expected a positive image interval" << std::endl;
+                return -1;
+            }
+        }
+    }
+    argc = n;
+    argv[argc] = NULL;
+    return 0;
+}
+
+//===========================================================================
+// calibration
+//===========================================================================
+// layer k of the calibration images: nested inputs, and outputs to fill
+struct cal_layer {
+    vector<vector<vector<vector<int>>>> conv_in;   // [img][ich][iy][ix]
+    vector<vector<vector<vector<int>>>> conv_out;
+    vector<vector<int>> fc_in;                     // [img][ich]
+    vector<vector<int>> fc_out;
+};
+
+static const int conv_out_dim[2] = {28, 10};
+
+static void cal_run (const layer_backend* b, const lenet5_net& net, const int k, cal_layer& c, const int i) {
+    const packed_model& m = net.model;
+    if (k == 0) b->conv(c.conv_in[i], m.conv1, c.conv_out[i], conv_out_dim[0], conv_out_dim[0], net.M_INV[0], NULL);
+    else if (k == 1) b->conv(c.conv_in[i], m.conv2, c.conv_out[i], conv_out_dim[1], conv_out_dim[1], net.M_INV[1], NULL);
+    else {
+        const packed_fc* fc[3] = {&m.fc1, &m.fc2, &m.fc3};
+        b->fc(c.fc_in[i], *fc[k - 2], c.fc_out[i], net.M_INV[k], (k != NET_LAYER_NUM - 1), NULL);
+    }
+}
+
+static void cal_layer_init (cal_layer& c, const lenet5_net& net, const int k, const vector<vector<int8_t>>& act) {
+    const int img_num = act.size();
+    if (k < 2) {
+        const packed_conv& pw = (k == 0) ? net.model.conv1 : net.model.conv2;
+        const int o = conv_out_dim[k], in = o + pw.KY - 1;
+        c.conv_in.assign(img_num, vector<vector<vector<int>>>(pw.ICH, vector<vector<int>>(in, vector<int>(in))));
+        c.conv_out.assign(img_num, vector<vector<vector<int>>>(pw.OCH, vector<vector<int>>(o, vector<int>(o))));
+        for (int i = 0; i < img_num; i++) {
+            for (int j = 0; j < layer_in_byte[k]; j++) c.conv_in[i][j / (in * in)][j / in % in][j % in] = act[i][j];
+        }
+    } else {
+        const packed_fc* fc[3] = {&net.model.fc1, &net.model.fc2, &net.model.fc3};
+        c.fc_in.assign(img_num, vector<int>(layer_in_byte[k]));
+        c.fc_out.assign(img_num, vector<int>(fc[k - 2]->OCH));
+        for (int i = 0; i < img_num; i++) std::copy(act[i].begin(), act[i].end(), c.fc_in[i].begin());
+    }
+}
+
+static bool cal_equal (const cal_layer& a, const cal_layer& b) {
+    return (a.conv_out == b.conv_out) && (a.fc_out == b.fc_out);
+}
+
+std::shared_ptr<backend_plan> backend_plan_make (const lenet5_net& net, const backend_opt& opt, const int8_t* img, const int img_num) {
+    std::shared_ptr<backend_plan> plan = std::make_shared<backend_plan>();
+    plan->cal_img = 0;
+    plan->verify_every = opt.verify_every;
+    plan->run_num = plan->verify_num = plan->mismatch_num = 0;
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        plan->layer[k] = backend_default[k];
+        for (int b = 0; b < BACKEND_MAX; b++) plan->cal_us[k][b] = -1.0;
+    }
+    if (!opt.name.empty()) {
+        const layer_backend* forced = backend_find(opt.name);
+        for (int k = 0; k < NET_LAYER_NUM; k++) {
+            if (backend_takes(forced, k)) plan->layer[k] = forced;
+        }
+        return plan;
+    }
+    if (img_num <= 0) {
+        std::cerr << "backend: no calibration images, using the default kernels" << std::endl;
+        return plan;
+    }
+
+    // layer inputs of the calibration images, from the oracle
+    vector<vector<vector<int8_t>>> act(NET_LAYER_NUM, vector<vector<int8_t>>(img_num));
+    for (int i = 0; i < img_num; i++) {
+        int8_t* ckpt[NET_LAYER_NUM];
+        for (int k = 0; k < NET_LAYER_NUM; k++) {
+            act[k][i].resize(layer_in_byte[k]);
+            ckpt[k] = act[k][i].data();
+        }
+        std::copy(img + (size_t)i * NET_IMG_BYTE, img + (size_t)(i + 1) * NET_IMG_BYTE, ckpt[0]);
+        net_run_with(net, backend_oracle, 0, ckpt[0], ckpt, NULL, NULL);
+    }
+
+    plan->cal_img = img_num;
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        cal_layer ref, c;
+        cal_layer_init(ref, net, k, act[k]);
+        for (int i = 0; i < img_num; i++) cal_run(backend_list[0], net, k, ref, i);
+        double best_us = -1.0;
+        for (int b = 0; b < backend_num; b++) {
+            const layer_backend* be = backend_list[b];
+            if (!backend_takes(be, k)) continue;
+            cal_layer_init(c, net, k, act[k]);
+            double min_s = -1.0;
+            for (int rep = 0; rep < BACKEND_CAL_REP; rep++) {
+                const cal_clock::time_point t0 = cal_clock::now();
+                for (int i = 0; i < img_num; i++) cal_run(be, net, k, c, i);
+                const double s = std::chrono::duration<double>(cal_clock::now() - t0).count();
+                if ((min_s < 0) || (s < min_s)) min_s = s;
+            }
+            if (!cal_equal(c, ref)) {
+                std::cerr << "backend: " << be->name << " differs from the scalar oracle on " << layer_name[k] << ", not used" << std::endl;
+                continue;
+            }
+            plan->cal_us[k][b] = 1e6 * min_s / img_num;
+            if ((best_us < 0) || (plan->cal_us[k][b] < best_us)) {
+                best_us = plan->cal_us[k][b];
+                plan->layer[k] = be;
+            }
+        }
+    }
+    return plan;
+}
+
+void backend_report (const backend_plan& plan) {
+    std::ios state(NULL);
+    state.copyfmt(cout);
+    if (plan.cal_img == 0) {
+        cout << "layer backends (forced):";
+        for (int k = 0; k < NET_LAYER_NUM; k++) cout << " " << layer_name[k] << "=" << plan.layer[k]->name;
+        cout << endl;
+    } else {
+        cout << "layer backends, calibrated on " << plan.cal_img << " images (us/image)" << endl;
+        cout << "  layer ";
+        for (int b = 0; b < backend_num; b++) cout << std::setw(9) << backend_list[b]->name;
+        cout << "   pick" << endl;
+        for (int k = 0; k < NET_LAYER_NUM; k++) {
+            cout << "  " << std::left << std::setw(6) << layer_name[k] << std::right << std::fixed << std::setprecision(2);
+            for (int b = 0; b < backend_num; b++) {
+                if (plan.cal_us[k][b] < 0) cout << std::setw(9) << "-";
+                else cout << std::setw(9) << plan.cal_us[k][b];
+            }
+            cout << "   " << plan.layer[k]->name << endl;
+        }
+    }
+    cout.copyfmt(state);
+}
+
+void verify_report (const backend_plan& plan) {
+    if (plan.verify_every > 0) {
+        cout << "verify: " << plan.verify_num << " of " << plan.run_num << " images re-run on the scalar oracle, "
+             << plan.mismatch_num << " mismatches" << endl;
+    }
+}
@@ -0,0 +1,114 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+// 
+// Create Date: 2025.06.14
+// Associated Filename: LeNet5_core_ip_cache.cpp
+// Project Name: CNN_FPGA
+// Tool Versions: 
+// Purpose: Per-image result cache of the reference model
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Same scheme as SW/dma_LeNet5_cache.cpp (two 64-bit lanes, parameter
+//     fingerprint as seed). A repeated image is served without conv1 ~ fc3.
+// 
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "LeNet5_core_ip.h"
+
+#define CACHE_MUL0  0x9e3779b97f4a7c15ULL
+#define CACHE_MUL1  0xc2b2ae3d27d4eb4fULL
+
+static uint64_t cache_mix (uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t param_hash_i8 (uint64_t hash, const vector<int8_t>& v) {
+    if (hash == 0) hash = FNV_OFFSET;
+    for (size_t i = 0; i < v.size(); i++) {
+        hash ^= (uint8_t)v[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t param_hash_i16 (uint64_t hash, const vector<int16_t>& v) {
+    if (hash == 0) hash = FNV_OFFSET;
+    for (size_t i = 0; i < v.size(); i++) {
+        hash ^= (uint16_t)v[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+void cache_init (result_cache& cache, const size_t capacity, const uint64_t param_hash) {
+    cache.capacity   = capacity;
+    cache.param_hash = param_hash;
+    cache.lru.clear();
+    cache.index.clear();
+    cache.hit  = 0;
+    cache.miss = 0;
+}
+
+cache_key cache_key_of (
+    const result_cache& cache,
+    const vector<vector<vector<int8_t>>>& infmap_qnt
+) {
+    uint64_t h0 = cache.param_hash;
+    uint64_t h1 = ~cache.param_hash;
+    for (size_t ich = 0; ich < infmap_qnt.size(); ich++) {
+        for (size_t iy = 0; iy < infmap_qnt[ich].size(); iy++) {
+            const vector<int8_t>& row = infmap_qnt[ich][iy];
+            for (size_t ix = 0; ix < row.size(); ix += 8) {
+                uint64_t word = 0;
+                for (size_t col = 0; (col < 8) && (ix + col < row.size()); col++) {
+                    word |= (uint64_t)(uint8_t)row[ix + col] << (col * 8);
+                }
+                h0 = (h0 ^ word) * CACHE_MUL0;
+                h1 = (h1 + word) * CACHE_MUL1;
+                h1 ^= h1 >> 29;
+            }
+        }
+    }
+    return cache_key{cache_mix(h0), cache_mix(h1)};
+}
+
+bool cache_lookup (result_cache& cache, const cache_key& key, vector<int>& fc3_otfmap) {
+    auto it = cache.index.find(key);
+    if (it == cache.index.end()) {
+        cache.miss++;
+        return false;
+    }
+    cache.hit++;
+    cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+    fc3_otfmap = it->second->second;
+    return true;
+}
+
+void cache_insert (result_cache& cache, const cache_key& key, const vector<int>& fc3_otfmap) {
+    if (cache.capacity == 0) {
+        return;
+    }
+    auto it = cache.index.find(key);
+    if (it != cache.index.end()) {
+        it->second->second = fc3_otfmap;
+        cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+        return;
+    }
+    if (cache.lru.size() >= cache.capacity) {
+        cache.index.erase(cache.lru.back().first);
+        cache.lru.pop_back();
+    }
+    cache.lru.emplace_front(key, fc3_otfmap);
+    cache.index[key] = cache.lru.begin();
+}
+
+void cache_report (const result_cache& cache) {
+    unsigned long num = cache.hit + cache.miss;
+    cout << "result cache: " << cache.lru.size() << " / " << cache.capacity << " entries, hit " << cache.hit
+         << ", miss " << cache.miss << " (" << std::fixed << std::setprecision(1)
+         << ((num == 0) ? 0.0 : 100.0 * cache.hit / num) << "% hit)" << endl;
+}
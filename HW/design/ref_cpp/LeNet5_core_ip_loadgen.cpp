@@ -0,0 +1,174 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.19
+// Associated Filename: LeNet5_core_ip_loadgen.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Open-loop load generator for the inference daemon
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Requests are scheduled with exponential inter-arrival times at the
+//     given rate and sent round-robin over conn_num connections, whether or
+//     not earlier responses have arrived. Latency is measured from the
+//     scheduled send time, so time spent blocked on a backpressured socket
+//     is counted instead of hidden.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "LeNet5_core_ip.h"
+
+typedef std::chrono::steady_clock loadgen_clock;
+
+static bool send_all (const int fd, const void* buf, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(buf);
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool recv_all (const int fd, void* buf, size_t len) {
+    uint8_t* p = static_cast<uint8_t*>(buf);
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// raw 28x28 images and labels straight from the IDX files
+int rd_idx_set (const int num, vector<uint8_t>& pixel, vector<uint8_t>& label) {
+    std::ifstream fp_img(FP_IN_INFMAP_BIN, std::ios::binary);
+    std::ifstream fp_lbl(FP_IN_LABEL_BIN, std::ios::binary);
+    if (!fp_img.is_open() || !fp_lbl.is_open()) {
+        std::cerr << "cannot open the MNIST IDX files" << std::endl;
+        return 0;
+    }
+    uint32_t img_hdr[4], lbl_hdr[2];
+    fp_img.read(reinterpret_cast<char*>(img_hdr), sizeof(img_hdr));
+    fp_lbl.read(reinterpret_cast<char*>(lbl_hdr), sizeof(lbl_hdr));
+    const int n = std::min<int>(num, __builtin_bswap32(img_hdr[1]));
+    pixel.resize(n * 28 * 28);
+    label.resize(n);
+    fp_img.read(reinterpret_cast<char*>(pixel.data()), pixel.size());
+    fp_lbl.read(reinterpret_cast<char*>(label.data()), label.size());
+    return (fp_img && fp_lbl) ? n : 0;
+}
+
+int run_loadgen (int argc, char** argv) {
+    if (argc < 5) {
+        printf("Usage : <executable> loadgen <socket_path> <rate_per_s> <request_num> [conn_num]\n");
+        return -1;
+    }
+    const char* path = argv[2];
+    const double rate = atof(argv[3]);
+    const int req_num = atoi(argv[4]);
+    const int conn_num = (argc > 5) ? std::max(1, atoi(argv[5])) : LOADGEN_CONN_NUM;
+    if ((rate <= 0) || (req_num <= 0)) {
+        std::cerr << "loadgen: rate and request_num must be positive" << std::endl;
+        return -1;
+    }
+
+    vector<uint8_t> pixel, label;
+    const int img_num = rd_idx_set(req_num, pixel, label);
+    if (img_num == 0) return -1;
+
+    // open-loop schedule
+    std::mt19937 rd(1);
+    std::exponential_distribution<double> gap(rate);
+    vector<loadgen_clock::duration> t_sched(req_num);
+    double t = 0;
+    for (int i = 0; i < req_num; i++) {
+        t_sched[i] = std::chrono::duration_cast<loadgen_clock::duration>(std::chrono::duration<double>(t));
+        t += gap(rd);
+    }
+
+    vector<int> fd(conn_num, -1);
+    for (int c = 0; c < conn_num; c++) {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+        fd[c] = socket(AF_UNIX, SOCK_STREAM, 0);
+        if ((fd[c] < 0) || (connect(fd[c], (sockaddr*)&addr, sizeof(addr)) != 0)) {
+            std::cerr << "loadgen: cannot connect to " << path << ": " << strerror(errno) << std::endl;
+            return -1;
+        }
+    }
+
+    vector<double> latency_us(req_num, -1);
+    vector<int> cls(req_num, -1);
+    vector<uint32_t> batch(req_num, 0);
+    const loadgen_clock::time_point t0 = loadgen_clock::now();
+
+    vector<std::thread> team;
+    for (int c = 0; c < conn_num; c++) {
+        // receiver
+        team.emplace_back([&, c]() {
+            for (int i = c; i < req_num; i += conn_num) {
+                serve_rsp rsp;
+                if (!recv_all(fd[c], &rsp, sizeof(rsp)) || (rsp.magic != SERVE_MAGIC) || (rsp.id >= (uint32_t)req_num)) {
+                    std::cerr << "loadgen: connection " << c << " lost" << std::endl;
+                    return;
+                }
+                latency_us[rsp.id] = std::chrono::duration<double, std::micro>(loadgen_clock::now() - (t0 + t_sched[rsp.id])).count();
+                cls[rsp.id]   = rsp.cls;
+                batch[rsp.id] = rsp.batch;
+            }
+        });
+        // sender
+        team.emplace_back([&, c]() {
+            vector<uint8_t> frame(sizeof(serve_req_hdr) + 28 * 28);
+            for (int i = c; i < req_num; i += conn_num) {
+                serve_req_hdr hdr = {SERVE_MAGIC, (uint32_t)i, SERVE_FMT_RAW28, 0};
+                memcpy(frame.data(), &hdr, sizeof(hdr));
+                memcpy(frame.data() + sizeof(hdr), &pixel[(i % img_num) * 28 * 28], 28 * 28);
+                std::this_thread::sleep_until(t0 + t_sched[i]);
+                if (!send_all(fd[c], frame.data(), frame.size())) {
+                    std::cerr << "loadgen: send failed on connection " << c << std::endl;
+                    return;
+                }
+            }
+        });
+    }
+    for (size_t i = 0; i < team.size(); i++) team[i].join();
+    const double wall_s = std::chrono::duration<double>(loadgen_clock::now() - t0).count();
+    for (int c = 0; c < conn_num; c++) close(fd[c]);
+
+    vector<double> lat;
+    unsigned long hit = 0, batch_sum = 0;
+    for (int i = 0; i < req_num; i++) {
+        if (latency_us[i] < 0) continue;
+        lat.push_back(latency_us[i]);
+        hit += (cls[i] == label[i % img_num]);
+        batch_sum += batch[i];
+    }
+    if (lat.empty()) {
+        std::cerr << "loadgen: no responses" << std::endl;
+        return -1;
+    }
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&](const double p) { return lat[std::min<size_t>(lat.size() - 1, p * lat.size())]; };
+
+    cout << std::fixed << std::setprecision(1);
+    cout << "loadgen: offered " << rate << " req/s, " << lat.size() << " / " << req_num << " responses in "
+         << std::setprecision(3) << wall_s << " s (" << std::setprecision(1) << lat.size() / wall_s << " req/s)" << endl;
+    cout << "latency (us): p50 " << pct(0.50) << ", p90 " << pct(0.90) << ", p99 " << pct(0.99)
+         << ", p99.9 " << pct(0.999) << ", max " << lat.back() << endl;
+    cout << "avg batch " << std::setprecision(2) << 1.0 * batch_sum / lat.size()
+         << ", accuracy " << 100.0 * hit / lat.size() << " %" << endl;
+    return (lat.size() == (size_t)req_num) ? 0 : -1;
+}
@@ -0,0 +1,93 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.28
+// Associated Filename: LeNet5_core_ip_memh.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Bus beat packer and $readmemh memory images for the RTL testbench
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     The testbench used to rebuild every RDMA beat from the text traces with
+//     $fscanf. The reference now packs the beats once, with the same loops as
+//     rd_param_fatfs and the RDMA image file, and writes them one per line;
+//     the testbench only $readmemh's them into the memory model.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include "LeNet5_core_ip.h"
+
+// beat b holds pixels [b * COL_NUM, (b + 1) * COL_NUM), pixel c at bits [c * 8 +: 8]
+void rdma_pack_img (const int8_t* img, uint64_t* beat) {
+    for (int b = 0; b < RDMA_IMG_BEAT_NUM; b++) {
+        uint64_t bus_data = 0;
+        for (int col = 0; col < RDMA_IMG_COL_NUM; col++) {
+            bus_data |= (uint64_t)(uint8_t)img[b * RDMA_IMG_COL_NUM + col] << (col * 8);
+        }
+        beat[b] = bus_data;
+    }
+}
+
+// one beat per (och, ich, ky) row, kx at bits [kx * 8 +: 8], then one beat per bias
+void rdma_pack_conv (
+    const vector<vector<vector<vector<int8_t>>>>& weight_qnt,
+    const vector<int16_t>& bias_qnt,
+    vector<uint64_t>& beat
+) {
+    for (size_t och = 0; och < weight_qnt.size(); och++) {
+        for (size_t ich = 0; ich < weight_qnt[och].size(); ich++) {
+            for (size_t ky = 0; ky < weight_qnt[och][ich].size(); ky++) {
+                uint64_t bus_data = 0;
+                for (size_t kx = 0; kx < weight_qnt[och][ich][ky].size(); kx++) {
+                    bus_data |= (uint64_t)(uint8_t)weight_qnt[och][ich][ky][kx] << (kx * 8);
+                }
+                beat.push_back(bus_data);
+            }
+        }
+    }
+    for (size_t och = 0; och < bias_qnt.size(); och++) beat.push_back((uint16_t)bias_qnt[och]);
+}
+
+// one beat per (och, ich block) of ceil(ICH / ICH_B) weights, then one beat per bias
+void rdma_pack_fc (
+    const vector<vector<int8_t>>& weight_qnt,
+    const vector<int16_t>& bias_qnt,
+    const int ICH_B,
+    vector<uint64_t>& beat
+) {
+    for (size_t och = 0; och < weight_qnt.size(); och++) {
+        const int ICH_ = weight_qnt[och].size();
+        const int ICH_T = (ICH_ + ICH_B - 1) / ICH_B;
+        for (int ichb = 0; ichb < ICH_; ichb += ICH_T) {
+            uint64_t bus_data = 0;
+            for (int icht = 0; (icht < ICH_T) && (ichb + icht < ICH_); icht++) {
+                bus_data |= (uint64_t)(uint8_t)weight_qnt[och][ichb + icht] << (icht * 8);
+            }
+            beat.push_back(bus_data);
+        }
+    }
+    for (size_t och = 0; och < bias_qnt.size(); och++) beat.push_back((uint16_t)bias_qnt[och]);
+}
+
+// index of the first largest output, OCH_ when none is above -128 (wr_result)
+int result_class (const vector<int8_t>& otfmap_qnt, const int OCH_) {
+    int otfmap = -128;
+    int result = OCH_;
+    for (int och = 0; och < OCH_; och++) {
+        if (otfmap_qnt[och] > otfmap) {
+            otfmap = otfmap_qnt[och];
+            result = och;
+        }
+    }
+    return result;
+}
+
+void wr_memh (std::ofstream& fp, const uint64_t* beat, const size_t num) {
+    char line[20];
+    for (size_t i = 0; i < num; i++) {
+        snprintf(line, sizeof(line), "%016llx\n", (unsigned long long)beat[i]);
+        fp << line;
+    }
+}
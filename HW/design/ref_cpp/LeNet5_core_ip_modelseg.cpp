@@ -0,0 +1,223 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.23
+// Associated Filename: LeNet5_core_ip_modelseg.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Packed model published once into a shared read-only segment
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Shards, daemons and sweep workers on one host all run the same packed
+//     weights. Instead of a private copy per process, the first process
+//     writes them into a segment file (temporary name + rename, so a reader
+//     never sees a partial one) and every process maps it PROT_READ. The
+//     page cache holds one copy and the per-process memory is the activations.
+//     A segment is used only when its param_hash, bias shifts and layer shapes
+//     match the key, and every array it declares lies inside the mapping.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include "LeNet5_core_ip.h"
+
+#define HUGETLBFS_MAGIC_NUM  0x958458f6
+
+struct model_seg_layer {
+    int32_t  dim[5];          // conv: OCH ICH KY KX BLK_NUM, fc: OCH ICH ICH_PAIR BLK_NUM -
+    int32_t  b_shift;         // the bias is stored << b_shift
+    uint32_t weight_ofs;      // bytes from the segment start
+    uint32_t weight_num;
+    uint32_t bias_ofs;
+    uint32_t bias_num;
+};
+struct model_seg_hdr {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t och_blk;
+    uint32_t reserved;
+    uint64_t param_hash;
+    uint64_t data_byte;       // header + arrays, the file may be rounded up to the page size
+    model_seg_layer layer[NET_LAYER_NUM];
+};
+
+static bool is_hugetlbfs (const char* dir, long& page_byte) {
+    struct statfs sb;
+    if ((statfs(dir, &sb) != 0) || ((unsigned long)sb.f_type != HUGETLBFS_MAGIC_NUM)) return false;
+    page_byte = sb.f_bsize;
+    return true;
+}
+
+static size_t seg_align (const size_t ofs) {
+    return (ofs + MODEL_SEG_ALIGN - 1) / MODEL_SEG_ALIGN * MODEL_SEG_ALIGN;
+}
+
+// offsets of every array after the header
+static size_t seg_layout (const packed_model& model, model_seg_hdr& hdr) {
+    memset(&hdr, 0, sizeof(hdr));
+    const packed_conv* conv[2] = {&model.conv1, &model.conv2};
+    const packed_fc*   fc[3]   = {&model.fc1, &model.fc2, &model.fc3};
+    size_t ofs = seg_align(sizeof(hdr));
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        model_seg_layer& l = hdr.layer[k];
+        size_t w_num, b_num;
+        if (k < 2) {
+            const packed_conv& pw = *conv[k];
+            const int32_t dim[5] = {pw.OCH, pw.ICH, pw.KY, pw.KX, pw.BLK_NUM};
+            memcpy(l.dim, dim, sizeof(dim));
+            l.b_shift = pw.B_SHIFT;
+            w_num = pw.weight.size();
+            b_num = pw.bias.size();
+        } else {
+            const packed_fc& pw = *fc[k - 2];
+            const int32_t dim[5] = {pw.OCH, pw.ICH, pw.ICH_PAIR, pw.BLK_NUM, 0};
+            memcpy(l.dim, dim, sizeof(dim));
+            l.b_shift = pw.B_SHIFT;
+            w_num = pw.weight.size();
+            b_num = pw.bias.size();
+        }
+        l.weight_ofs = ofs;
+        l.weight_num = w_num;
+        ofs = seg_align(ofs + w_num * sizeof(int16_t));
+        l.bias_ofs = ofs;
+        l.bias_num = b_num;
+        ofs = seg_align(ofs + b_num * sizeof(int32_t));
+    }
+    hdr.magic      = MODEL_SEG_MAGIC;
+    hdr.version    = MODEL_SEG_VERSION;
+    hdr.och_blk    = PACK_OCH_BLK;
+    hdr.param_hash = model.param_hash;
+    hdr.data_byte  = ofs;
+    return ofs;
+}
+
+// an array of the segment: aligned, after the header and inside data_byte
+static bool seg_array_ok (const model_seg_hdr& hdr, const uint32_t ofs, const uint32_t num, const size_t elem_byte) {
+    return (ofs >= sizeof(hdr)) && (ofs % MODEL_SEG_ALIGN == 0) && ((uint64_t)ofs + (uint64_t)num * elem_byte <= hdr.data_byte);
+}
+
+static bool seg_map (const char* dir, const packed_model_key& key, const uint8_t*& base, size_t& map_byte) {
+    const std::string path = std::string(dir) + "/" + MODEL_SEG_FILE;
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat sb;
+    model_seg_hdr hdr;
+    if ((fstat(fd, &sb) != 0) || ((size_t)sb.st_size < sizeof(hdr))) {
+        close(fd);
+        return false;
+    }
+    map_byte = sb.st_size;
+    void* p = mmap(NULL, map_byte, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+    memcpy(&hdr, p, sizeof(hdr));
+    bool is_ok = (hdr.magic == MODEL_SEG_MAGIC) && (hdr.version == MODEL_SEG_VERSION) && (hdr.och_blk == PACK_OCH_BLK) &&
+                 (hdr.param_hash == key.param_hash) && (hdr.data_byte <= map_byte);
+    for (int k = 0; is_ok && (k < NET_LAYER_NUM); k++) {
+        const model_seg_layer& l = hdr.layer[k];
+        is_ok = packed_layer_ok(key, k, l.dim, l.weight_num, l.bias_num, l.b_shift) &&
+                seg_array_ok(hdr, l.weight_ofs, l.weight_num, sizeof(int16_t)) &&
+                seg_array_ok(hdr, l.bias_ofs, l.bias_num, sizeof(int32_t));
+    }
+    if (!is_ok) {
+        munmap(p, map_byte);
+        return false;
+    }
+    base = static_cast<const uint8_t*>(p);
+    return true;
+}
+
+bool attach_model_segment (packed_model& model, const packed_model_key& key) {
+    const char* dir[2] = {MODEL_SEG_HUGE_DIR, MODEL_SEG_SHM_DIR};
+    long page_byte = 0;
+    for (int d = 0; d < 2; d++) {
+        const uint8_t* base;
+        size_t map_byte;
+        if (!seg_map(dir[d], key, base, map_byte)) continue;
+        const bool is_huge = is_hugetlbfs(dir[d], page_byte);
+        if (!is_huge) madvise(const_cast<uint8_t*>(base), map_byte, MADV_HUGEPAGE);  // tmpfs THP, if enabled
+
+        const model_seg_hdr& hdr = *reinterpret_cast<const model_seg_hdr*>(base);
+        packed_conv* conv[2] = {&model.conv1, &model.conv2};
+        packed_fc*   fc[3]   = {&model.fc1, &model.fc2, &model.fc3};
+        for (int k = 0; k < NET_LAYER_NUM; k++) {
+            const model_seg_layer& l = hdr.layer[k];
+            const int16_t* w = reinterpret_cast<const int16_t*>(base + l.weight_ofs);
+            const int32_t* b = reinterpret_cast<const int32_t*>(base + l.bias_ofs);
+            if (k < 2) {
+                packed_conv& pw = *conv[k];
+                pw.OCH = l.dim[0]; pw.ICH = l.dim[1]; pw.KY = l.dim[2]; pw.KX = l.dim[3]; pw.BLK_NUM = l.dim[4];
+                pw.B_SHIFT = l.b_shift;
+                pw.ACC16_CHUNK = 0;
+                pw.weight.view(w, l.weight_num);
+                pw.bias.view(b, l.bias_num);
+            } else {
+                packed_fc& pw = *fc[k - 2];
+                pw.OCH = l.dim[0]; pw.ICH = l.dim[1]; pw.ICH_PAIR = l.dim[2]; pw.BLK_NUM = l.dim[3];
+                pw.B_SHIFT = l.b_shift;
+                pw.ACC16_CHUNK = 0;
+                pw.weight.view(w, l.weight_num);
+                pw.bias.view(b, l.bias_num);
+            }
+        }
+        model.param_hash = key.param_hash;
+        model.seg = std::shared_ptr<const void>(base, [map_byte](const void* p) { munmap(const_cast<void*>(p), map_byte); });
+        cout << "model segment: " << dir[d] << "/" << MODEL_SEG_FILE << " (" << (is_huge ? "hugetlbfs" : "tmpfs")
+             << ", " << map_byte / 1024 << " KB, read-only)" << endl;
+        return true;
+    }
+    return false;
+}
+
+static bool seg_write (const char* dir, const packed_model& model, const model_seg_hdr& hdr, const size_t file_byte) {
+    const std::string path = std::string(dir) + "/" + MODEL_SEG_FILE;
+    const std::string tmp  = path + "." + std::to_string(getpid());
+    const int fd = open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    // hugetlbfs only takes data through a mapping; mmap fails when no huge pages are free
+    void* p = (ftruncate(fd, file_byte) == 0) ? mmap(NULL, file_byte, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (p == MAP_FAILED) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    uint8_t* base = static_cast<uint8_t*>(p);
+    memcpy(base, &hdr, sizeof(hdr));
+    const packed_conv* conv[2] = {&model.conv1, &model.conv2};
+    const packed_fc*   fc[3]   = {&model.fc1, &model.fc2, &model.fc3};
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        const model_seg_layer& l = hdr.layer[k];
+        const int16_t* w = (k < 2) ? conv[k]->weight.data() : fc[k - 2]->weight.data();
+        const int32_t* b = (k < 2) ? conv[k]->bias.data()   : fc[k - 2]->bias.data();
+        memcpy(base + l.weight_ofs, w, l.weight_num * sizeof(int16_t));
+        memcpy(base + l.bias_ofs,   b, l.bias_num * sizeof(int32_t));
+    }
+    munmap(p, file_byte);
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool publish_model_segment (const packed_model& model) {
+    model_seg_hdr hdr;
+    const size_t data_byte = seg_layout(model, hdr);
+    long page_byte = 0;
+    if (is_hugetlbfs(MODEL_SEG_HUGE_DIR, page_byte)) {
+        const size_t file_byte = (data_byte + page_byte - 1) / page_byte * page_byte;
+        if (seg_write(MODEL_SEG_HUGE_DIR, model, hdr, file_byte)) return true;
+    }
+    page_byte = sysconf(_SC_PAGESIZE);
+    const size_t file_byte = (data_byte + page_byte - 1) / page_byte * page_byte;
+    if (seg_write(MODEL_SEG_SHM_DIR, model, hdr, file_byte)) return true;
+    std::cerr << "model segment: cannot publish in " << MODEL_SEG_HUGE_DIR << " or " << MODEL_SEG_SHM_DIR
+              << ", using a private copy" << std::endl;
+    return false;
+}
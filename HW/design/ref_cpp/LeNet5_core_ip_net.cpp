@@ -0,0 +1,131 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.19
+// Associated Filename: LeNet5_core_ip_net.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Whole-network inference on flat int8 buffers
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     The simulation loop keeps the nested vectors of every layer for the
+//     trace files. The sweep, the daemon and the other drivers only need
+//     an image in and a class out, and pass activations as flat int8
+//     buffers at the layer boundaries (layer_in_byte).
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "LeNet5_core_ip.h"
+
+// int8 inputs of each layer: 32x32 image, pool1 6x14x14, flatten 400, fc1 120, fc2 84
+const int layer_in_byte[NET_LAYER_NUM] = {NET_IMG_BYTE, 6 * 14 * 14, 16 * 5 * 5, 120, 84};
+const char* const layer_name[NET_LAYER_NUM] = {"conv1", "conv2", "fc1", "fc2", "fc3"};
+
+void net_init (lenet5_net& net, const packed_model& model, const layer_scale* scale) {
+    net.model = model;
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        net.scale[k] = scale[k];
+        net.M_INV[k] = scale[k].IN_I_INV * scale[k].IN_W_INV / scale[k].IN_O_INV;
+    }
+    // the conv1 int16 runs are planned for quantized pixels only
+    conv1_input_range(net.in_lo, net.in_hi);
+}
+
+bool net_img_ok (const lenet5_net& net, const int8_t* img) {
+    bool is_ok = true;
+    for (int i = 0; i < NET_IMG_BYTE; i++) {
+        is_ok &= (img[i] >= net.in_lo) && (img[i] <= net.in_hi);
+    }
+    return is_ok;
+}
+
+void pad_image (const uint8_t* pixel, int8_t* img) {
+    static const vector<int8_t> table = []() {
+        vector<int8_t> t(256);
+        for (int p = 0; p < 256; p++) t[p] = quantize_pixel(p);
+        return t;
+    }();
+    for (int i = 0; i < NET_IMG_BYTE; i++) img[i] = table[0];
+    for (int y = 0; y < 28; y++) {
+        for (int x = 0; x < 28; x++) {
+            img[(y + 2) * 32 + (x + 2)] = table[pixel[y * 28 + x]];
+        }
+    }
+}
+
+int net_run_with (const lenet5_net& net, const layer_backend* const* be, const int first, const int8_t* act,
+                  int8_t* const* ckpt, int32_t* logit, layer_density* density) {
+    const packed_model& m = net.model;
+    vector<int> fc_in;
+    layer_density unused[NET_LAYER_NUM - 1];
+    layer_density* stat = (density != NULL) ? density : unused;  // conv2, fc1, fc2, fc3
+
+    if (first <= 1) {
+        vector<vector<vector<int>>> pool1(6, vector<vector<int>>(14, vector<int>(14)));
+        if (first == 0) {
+            vector<vector<vector<int>>> infmap(1, vector<vector<int>>(32, vector<int>(32)));
+            for (int i = 0; i < layer_in_byte[0]; i++) infmap[0][i / 32][i % 32] = act[i];
+            vector<vector<vector<int>>> conv1(6, vector<vector<int>>(28, vector<int>(28)));
+            be[0]->conv(infmap, m.conv1, conv1, 28, 28, net.M_INV[0], NULL);
+            max_pooling(conv1, pool1, 6, 14, 14, 2, 2);
+            if (ckpt) for (int i = 0; i < layer_in_byte[1]; i++) ckpt[1][i] = pool1[i / 196][i / 14 % 14][i % 14];
+        } else {
+            for (int i = 0; i < layer_in_byte[1]; i++) pool1[i / 196][i / 14 % 14][i % 14] = act[i];
+        }
+        vector<vector<vector<int>>> conv2(16, vector<vector<int>>(10, vector<int>(10)));
+        vector<vector<vector<int>>> pool2(16, vector<vector<int>>(5, vector<int>(5)));
+        be[1]->conv(pool1, m.conv2, conv2, 10, 10, net.M_INV[1], &stat[0]);
+        max_pooling(conv2, pool2, 16, 5, 5, 2, 2);
+        fc_in.assign(layer_in_byte[2], 0);
+        flatten(pool2, fc_in, 16, 5, 5);
+        if (ckpt) for (int i = 0; i < layer_in_byte[2]; i++) ckpt[2][i] = fc_in[i];
+    } else {
+        fc_in.assign(act, act + layer_in_byte[first]);
+    }
+
+    const packed_fc* fc[3] = {&m.fc1, &m.fc2, &m.fc3};
+    for (int k = std::max(first, 2); k < NET_LAYER_NUM; k++) {
+        vector<int> fc_out(fc[k - 2]->OCH, 0);
+        be[k]->fc(fc_in, *fc[k - 2], fc_out, net.M_INV[k], (k != NET_LAYER_NUM - 1), &stat[k - 1]);
+        fc_in.swap(fc_out);
+        if (ckpt && (k + 1 < NET_LAYER_NUM)) {
+            for (int i = 0; i < layer_in_byte[k + 1]; i++) ckpt[k + 1][i] = fc_in[i];
+        }
+    }
+    if (logit) std::copy(fc_in.begin(), fc_in.end(), logit);
+    return std::max_element(fc_in.begin(), fc_in.end()) - fc_in.begin();
+}
+
+int net_run_from (const lenet5_net& net, const int first, const int8_t* act, int8_t* const* ckpt, int32_t* logit, layer_density* density) {
+    const backend_plan* plan = net.plan.get();
+    int32_t out[NET_CLASS_NUM];
+    int cls = 0;
+    const bool on_team = (net.team != NULL) && (first == 0) && (ckpt == NULL) && (density == NULL) &&
+                         team_run_image(*net.team, net, act, out, cls);
+    if (!on_team) cls = net_run_with(net, (plan != NULL) ? plan->layer : backend_default, first, act, ckpt, out, density);
+    net_verify(net, first, act, out);
+    if (logit) std::copy(out, out + NET_CLASS_NUM, logit);
+    return cls;
+}
+
+int net_run_image (const lenet5_net& net, const int8_t* img, int32_t* logit) {
+    return net_run_from(net, 0, img, NULL, logit, NULL);
+}
+
+int net_run_oracle (const lenet5_net& net, const int first, const int8_t* act, int32_t* logit) {
+    return net_run_with(net, backend_oracle, first, act, NULL, logit, NULL);
+}
+
+bool net_verify (const lenet5_net& net, const int first, const int8_t* act, const int32_t* logit) {
+    backend_plan* plan = net.plan.get();
+    if ((plan == NULL) || (plan->verify_every <= 0) || ((plan->run_num++ % plan->verify_every) != 0)) return true;
+    plan->verify_num++;
+    int32_t ref[NET_CLASS_NUM];
+    net_run_oracle(net, first, act, ref);
+    if (std::equal(ref, ref + NET_CLASS_NUM, logit)) return true;
+    if (++plan->mismatch_num <= 10) {
+        std::cerr << "verify: logits differ from the scalar oracle (image " << plan->run_num - 1 << " of this process)" << std::endl;
+    }
+    return false;
+}
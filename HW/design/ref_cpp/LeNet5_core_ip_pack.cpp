@@ -0,0 +1,317 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.16
+// Associated Filename: LeNet5_core_ip_pack.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Load-time weight prepack and the dense kernels on the packed layout
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     The nested vector<int> weights are repacked once into flat int16 blocks
+//     of PACK_OCH_BLK output channels. The lane index is innermost, so the
+//     kernel inner loop is a contiguous multiply-accumulate over the block
+//     that the compiler vectorizes. fc weights keep input channel pairs
+//     together ([ich / 2][lane][ich % 2]) for widening int16 dot products.
+//     The bias is stored already shifted by B_SHIFT.
+//     The packed model is written next to the parameter files and reused
+//     while its param_hash, bias shifts and layer shapes match the loaded
+//     parameters, the scales and the RTL.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "LeNet5_core_ip.h"
+
+void pack_conv_weight (
+    packed_conv& pw,
+    const vector<vector<vector<vector<int8_t>>>>& weight_qnt,
+    const vector<int16_t>& bias_qnt,
+    const int B_SCALE
+) {
+    const int B_SHIFT = log2(B_SCALE);
+    pw.OCH = weight_qnt.size();
+    pw.ICH = weight_qnt[0].size();
+    pw.KY  = weight_qnt[0][0].size();
+    pw.KX  = weight_qnt[0][0][0].size();
+    pw.BLK_NUM = (pw.OCH + PACK_OCH_BLK - 1) / PACK_OCH_BLK;
+    pw.B_SHIFT = B_SHIFT;
+    pw.ACC16_CHUNK = 0;
+    vector<int16_t>& weight = pw.weight.own();
+    vector<int32_t>& bias = pw.bias.own();
+    weight.assign(pw.BLK_NUM * pw.ICH * pw.KY * pw.KX * PACK_OCH_BLK, 0);
+    bias.assign(pw.BLK_NUM * PACK_OCH_BLK, 0);
+
+    for (int och = 0; och < pw.OCH; och++) {
+        const int blk = och / PACK_OCH_BLK, lane = och % PACK_OCH_BLK;
+        for (int ich = 0; ich < pw.ICH; ich++) {
+            for (int ky = 0; ky < pw.KY; ky++) {
+                for (int kx = 0; kx < pw.KX; kx++) {
+                    weight[(((blk * pw.ICH + ich) * pw.KY + ky) * pw.KX + kx) * PACK_OCH_BLK + lane]
+                        = weight_qnt[och][ich][ky][kx];
+        } } }
+        bias[och] = static_cast<int32_t>(bias_qnt[och]) << B_SHIFT;
+    }
+}
+
+void pack_fc_weight (
+    packed_fc& pw,
+    const vector<vector<int8_t>>& weight_qnt,
+    const vector<int16_t>& bias_qnt,
+    const int B_SCALE
+) {
+    const int B_SHIFT = log2(B_SCALE);
+    pw.OCH = weight_qnt.size();
+    pw.ICH = weight_qnt[0].size();
+    pw.ICH_PAIR = (pw.ICH + 1) / 2;
+    pw.BLK_NUM = (pw.OCH + PACK_OCH_BLK - 1) / PACK_OCH_BLK;
+    pw.B_SHIFT = B_SHIFT;
+    pw.ACC16_CHUNK = 0;
+    vector<int16_t>& weight = pw.weight.own();
+    vector<int32_t>& bias = pw.bias.own();
+    weight.assign(pw.BLK_NUM * pw.ICH_PAIR * PACK_OCH_BLK * 2, 0);
+    bias.assign(pw.BLK_NUM * PACK_OCH_BLK, 0);
+
+    for (int och = 0; och < pw.OCH; och++) {
+        const int blk = och / PACK_OCH_BLK, lane = och % PACK_OCH_BLK;
+        for (int ich = 0; ich < pw.ICH; ich++) {
+            weight[((blk * pw.ICH_PAIR + ich / 2) * PACK_OCH_BLK + lane) * 2 + (ich % 2)] = weight_qnt[och][ich];
+        }
+        bias[och] = static_cast<int32_t>(bias_qnt[och]) << B_SHIFT;
+    }
+}
+
+//===========================================================================
+// packed model file
+//===========================================================================
+struct packed_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t och_blk;
+    uint32_t reserved;
+    uint64_t param_hash;
+};
+
+// a packed layer as a file or segment declares it, against the key and the
+// layout PACK_OCH_BLK implies for the key's shape
+bool packed_layer_ok (
+    const packed_model_key& key,
+    const int k,
+    const int* dim,
+    const size_t weight_num,
+    const size_t bias_num,
+    const int b_shift
+) {
+    const int* shape = key.shape[k];
+    if ((dim[0] != shape[0]) || (dim[1] != shape[1]) || (b_shift != key.b_shift[k])) return false;
+    const int blk_num = (shape[0] + PACK_OCH_BLK - 1) / PACK_OCH_BLK;
+    size_t expect;
+    if (k < 2) {
+        if ((dim[2] != shape[2]) || (dim[3] != shape[3]) || (dim[4] != blk_num)) return false;
+        expect = (size_t)blk_num * shape[1] * shape[2] * shape[3] * PACK_OCH_BLK;
+    } else {
+        if ((dim[2] != (shape[1] + 1) / 2) || (dim[3] != blk_num)) return false;
+        expect = (size_t)blk_num * dim[2] * PACK_OCH_BLK * 2;
+    }
+    return (weight_num == expect) && (bias_num == (size_t)blk_num * PACK_OCH_BLK);
+}
+
+template <typename T>
+static void wr_array (std::ofstream& fp, const pack_array<T>& v) {
+    uint32_t num = v.size();
+    fp.write(reinterpret_cast<const char*>(&num), sizeof(num));
+    fp.write(reinterpret_cast<const char*>(v.data()), num * sizeof(T));
+}
+
+template <typename T>
+static bool rd_array (std::ifstream& fp, vector<T>& v, const size_t expect) {
+    uint32_t num = 0;
+    fp.read(reinterpret_cast<char*>(&num), sizeof(num));
+    if (!fp || (num != expect)) return false;
+    v.resize(num);
+    fp.read(reinterpret_cast<char*>(v.data()), num * sizeof(T));
+    return static_cast<bool>(fp);
+}
+
+static void wr_conv (std::ofstream& fp, const packed_conv& pw) {
+    int32_t dim[6] = {pw.OCH, pw.ICH, pw.KY, pw.KX, pw.BLK_NUM, pw.B_SHIFT};
+    fp.write(reinterpret_cast<const char*>(dim), sizeof(dim));
+    wr_array(fp, pw.weight);
+    wr_array(fp, pw.bias);
+}
+
+static bool rd_conv (std::ifstream& fp, const packed_model_key& key, const int k, packed_conv& pw) {
+    int32_t dim[6];
+    fp.read(reinterpret_cast<char*>(dim), sizeof(dim));
+    if (!fp) return false;
+    const size_t w_num = (size_t)dim[4] * dim[1] * dim[2] * dim[3] * PACK_OCH_BLK;
+    const size_t b_num = (size_t)dim[4] * PACK_OCH_BLK;
+    if (!packed_layer_ok(key, k, dim, w_num, b_num, dim[5])) return false;
+    pw.OCH = dim[0]; pw.ICH = dim[1]; pw.KY = dim[2]; pw.KX = dim[3]; pw.BLK_NUM = dim[4]; pw.B_SHIFT = dim[5];
+    pw.ACC16_CHUNK = 0;
+    return rd_array(fp, pw.weight.own(), w_num) && rd_array(fp, pw.bias.own(), b_num);
+}
+
+static void wr_fc (std::ofstream& fp, const packed_fc& pw) {
+    int32_t dim[5] = {pw.OCH, pw.ICH, pw.ICH_PAIR, pw.BLK_NUM, pw.B_SHIFT};
+    fp.write(reinterpret_cast<const char*>(dim), sizeof(dim));
+    wr_array(fp, pw.weight);
+    wr_array(fp, pw.bias);
+}
+
+static bool rd_fc (std::ifstream& fp, const packed_model_key& key, const int k, packed_fc& pw) {
+    int32_t dim[5];
+    fp.read(reinterpret_cast<char*>(dim), sizeof(dim));
+    if (!fp) return false;
+    const size_t w_num = (size_t)dim[3] * dim[2] * PACK_OCH_BLK * 2;
+    const size_t b_num = (size_t)dim[3] * PACK_OCH_BLK;
+    if (!packed_layer_ok(key, k, dim, w_num, b_num, dim[4])) return false;
+    pw.OCH = dim[0]; pw.ICH = dim[1]; pw.ICH_PAIR = dim[2]; pw.BLK_NUM = dim[3]; pw.B_SHIFT = dim[4];
+    pw.ACC16_CHUNK = 0;
+    return rd_array(fp, pw.weight.own(), w_num) && rd_array(fp, pw.bias.own(), b_num);
+}
+
+// false when the file is missing, from another layout, or from other
+// parameters, scales or layer shapes
+bool load_packed_model (const char* path, packed_model& model, const packed_model_key& key) {
+    std::ifstream fp(path, std::ios::binary);
+    if (!fp.is_open()) return false;
+
+    packed_header hdr;
+    fp.read(reinterpret_cast<char*>(&hdr), sizeof(hdr));
+    if (!fp || (hdr.magic != PACK_MAGIC) || (hdr.version != PACK_VERSION) ||
+        (hdr.och_blk != PACK_OCH_BLK) || (hdr.param_hash != key.param_hash)) {
+        return false;
+    }
+    model.param_hash = hdr.param_hash;
+    return rd_conv(fp, key, 0, model.conv1) && rd_conv(fp, key, 1, model.conv2)
+        && rd_fc(fp, key, 2, model.fc1) && rd_fc(fp, key, 3, model.fc2) && rd_fc(fp, key, 4, model.fc3);
+}
+
+bool save_packed_model (const char* path, const packed_model& model) {
+    std::ofstream fp(path, std::ios::binary | std::ios::trunc);
+    if (!fp.is_open()) {
+        std::cerr << "Error opening " << path << " for the packed model" << std::endl;
+        return false;
+    }
+    packed_header hdr = {PACK_MAGIC, PACK_VERSION, PACK_OCH_BLK, 0, model.param_hash};
+    fp.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    wr_conv(fp, model.conv1);
+    wr_conv(fp, model.conv2);
+    wr_fc(fp, model.fc1);
+    wr_fc(fp, model.fc2);
+    wr_fc(fp, model.fc3);
+    return static_cast<bool>(fp);
+}
+
+//===========================================================================
+// dense kernels
+//===========================================================================
+void conv_layer_packed (
+    const vector<vector<vector<int>>>& infmap,
+    const packed_conv& pw,
+    vector<vector<vector<int>>>& otfmap,
+    const int OX_ ,
+    const int M_INV ,
+    const int BLK0 ,
+    const int BLK1 ,
+    const int OY0 ,
+    const int OY1
+) {
+    const int WIN = pw.ICH * pw.KY * pw.KX;
+
+    for (int blk = BLK0; blk < BLK1; blk++) {
+        const int16_t* w_blk = &pw.weight[blk * WIN * PACK_OCH_BLK];
+        const int32_t* b_blk = &pw.bias[blk * PACK_OCH_BLK];
+        const int lane_num = std::min(PACK_OCH_BLK, pw.OCH - blk * PACK_OCH_BLK);
+        for (int oy = OY0; oy < OY1; oy++) {
+            for (int ox = 0; ox < OX_; ox++) {
+                int32_t acc[PACK_OCH_BLK];
+                for (int lane = 0; lane < PACK_OCH_BLK; lane++) acc[lane] = b_blk[lane];
+
+                const int16_t* w = w_blk;
+                if (pw.ACC16_CHUNK > 0) {
+                    // int16 lanes, widened every ACC16_CHUNK taps (overflow-free by plan_conv_layer)
+                    int16_t acc16[PACK_OCH_BLK] = {0};
+                    int run = 0;
+                    for (int ich = 0; ich < pw.ICH; ich++) {
+                        for (int ky = 0; ky < pw.KY; ky++) {
+                            const int* in_row = &infmap[ich][oy + ky][ox];
+                            for (int kx = 0; kx < pw.KX; kx++, w += PACK_OCH_BLK) {
+                                const int16_t in_val = in_row[kx];
+                                for (int lane = 0; lane < PACK_OCH_BLK; lane++) {
+                                    acc16[lane] = static_cast<int16_t>(acc16[lane] + in_val * w[lane]);
+                                }
+                                if (++run == pw.ACC16_CHUNK) {
+                                    for (int lane = 0; lane < PACK_OCH_BLK; lane++) {
+                                        acc[lane] += acc16[lane];
+                                        acc16[lane] = 0;
+                                    }
+                                    run = 0;
+                                }
+                    } } }
+                    for (int lane = 0; lane < PACK_OCH_BLK; lane++) acc[lane] += acc16[lane];
+                } else {
+                    for (int ich = 0; ich < pw.ICH; ich++) {
+                        for (int ky = 0; ky < pw.KY; ky++) {
+                            const int* in_row = &infmap[ich][oy + ky][ox];
+                            for (int kx = 0; kx < pw.KX; kx++, w += PACK_OCH_BLK) {
+                                const int32_t in_val = in_row[kx];
+                                for (int lane = 0; lane < PACK_OCH_BLK; lane++) {
+                                    acc[lane] += in_val * w[lane];
+                                }
+                    } } }
+                }
+
+                for (int lane = 0; lane < lane_num; lane++) {
+                    otfmap[blk * PACK_OCH_BLK + lane][oy][ox] = requant_acc(acc[lane], M_INV, true);
+                }
+    } } }
+}
+
+void fc_layer_packed (
+    const vector<int>& infmap,
+    const packed_fc& pw,
+    vector<int>& otfmap,
+    const int M_INV ,
+    const bool relu ,
+    const int BLK0 ,
+    const int BLK1
+) {
+    // odd ICH: the padded input pairs with a zero weight
+    vector<int16_t> in(pw.ICH_PAIR * 2, 0);
+    for (int ich = 0; ich < pw.ICH; ich++) in[ich] = infmap[ich];
+
+    for (int blk = BLK0; blk < BLK1; blk++) {
+        const int16_t* w = &pw.weight[blk * pw.ICH_PAIR * PACK_OCH_BLK * 2];
+        int32_t acc[PACK_OCH_BLK];
+        for (int lane = 0; lane < PACK_OCH_BLK; lane++) acc[lane] = pw.bias[blk * PACK_OCH_BLK + lane];
+
+        if (pw.ACC16_CHUNK > 0) {
+            // int16 lanes, widened every ACC16_CHUNK pairs (overflow-free by plan_fc_layer)
+            for (int p0 = 0; p0 < pw.ICH_PAIR; p0 += pw.ACC16_CHUNK) {
+                const int p1 = std::min(pw.ICH_PAIR, p0 + pw.ACC16_CHUNK);
+                int16_t acc16[PACK_OCH_BLK] = {0};
+                for (int p = p0; p < p1; p++, w += PACK_OCH_BLK * 2) {
+                    const int16_t in0 = in[2 * p], in1 = in[2 * p + 1];
+                    for (int lane = 0; lane < PACK_OCH_BLK; lane++) {
+                        acc16[lane] = static_cast<int16_t>(acc16[lane] + in0 * w[2 * lane] + in1 * w[2 * lane + 1]);
+                    }
+                }
+                for (int lane = 0; lane < PACK_OCH_BLK; lane++) acc[lane] += acc16[lane];
+            }
+        } else {
+            for (int p = 0; p < pw.ICH_PAIR; p++, w += PACK_OCH_BLK * 2) {
+                const int32_t in0 = in[2 * p], in1 = in[2 * p + 1];
+                for (int lane = 0; lane < PACK_OCH_BLK; lane++) {
+                    acc[lane] += in0 * w[2 * lane] + in1 * w[2 * lane + 1];
+                }
+            }
+        }
+
+        const int lane_num = std::min(PACK_OCH_BLK, pw.OCH - blk * PACK_OCH_BLK);
+        for (int lane = 0; lane < lane_num; lane++) {
+            otfmap[blk * PACK_OCH_BLK + lane] = requant_acc(acc[lane], M_INV, relu);
+        }
+    }
+}
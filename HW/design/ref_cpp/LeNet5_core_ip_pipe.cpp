@@ -0,0 +1,242 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.20
+// Associated Filename: LeNet5_core_ip_pipe.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Three-stage ingest -> compute -> emit pipeline of the simulation loop
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Like RDMA / core / WDMA in the HW, image read, inference and trace
+//     write overlap. Image k goes to worker k % worker_num and emit takes the
+//     results back in the same round-robin order, so every ring keeps a
+//     single producer and a single consumer and the traces stay in order.
+//     Stages spin with yield() on an empty or full ring; the counters show
+//     where the pipeline waits.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include "LeNet5_core_ip.h"
+
+typedef std::chrono::steady_clock pipe_clock;
+
+struct pipe_stage {
+    unsigned long item_num;
+    double        busy_s;
+};
+
+static void spsc_init (spsc_ring& r, const size_t num) {
+    size_t cap = 1;
+    while (cap < num) cap <<= 1;
+    r.buf.assign(cap, -1);
+    r.mask = cap - 1;
+    r.head = 0;
+    r.tail = 0;
+    r.push_num = 0;
+    r.occ_sum = 0;
+    r.occ_max = 0;
+    r.full_num = 0;
+    r.empty_num = 0;
+}
+
+static void spsc_push (spsc_ring& r, const int v) {
+    const size_t t = r.tail.load(std::memory_order_relaxed);
+    size_t h = r.head.load(std::memory_order_acquire);
+    if (t - h == r.buf.size()) {
+        r.full_num++;
+        do {
+            std::this_thread::yield();
+            h = r.head.load(std::memory_order_acquire);
+        } while (t - h == r.buf.size());
+    }
+    r.buf[t & r.mask] = v;
+    r.tail.store(t + 1, std::memory_order_release);
+    r.push_num++;
+    r.occ_sum += t + 1 - h;
+    r.occ_max = std::max<unsigned long>(r.occ_max, t + 1 - h);
+}
+
+static int spsc_pop (spsc_ring& r) {
+    const size_t h = r.head.load(std::memory_order_relaxed);
+    size_t t = r.tail.load(std::memory_order_acquire);
+    if (h == t) {
+        r.empty_num++;
+        do {
+            std::this_thread::yield();
+            t = r.tail.load(std::memory_order_acquire);
+        } while (h == t);
+    }
+    const int v = r.buf[h & r.mask];
+    r.head.store(h + 1, std::memory_order_release);
+    return v;
+}
+
+static void ring_report (const std::string& name, const spsc_ring& r) {
+    cout << "  " << std::left << std::setw(8) << name << std::right
+         << " occupancy avg " << std::setw(5) << std::setprecision(2)
+         << ((r.push_num == 0) ? 0.0 : 1.0 * r.occ_sum / r.push_num)
+         << " max " << std::setw(3) << r.occ_max << " / " << r.buf.size()
+         << ", producer stalls " << std::setw(6) << r.full_num
+         << ", consumer stalls " << std::setw(6) << r.empty_num << endl;
+}
+
+int run_pipeline (
+    const lenet5_net& net,
+    const int first,
+    const int loop_num,
+    const int worker_num,
+    result_cache* cache,
+    const img_cache* ic,
+    vector<layer_density>& density,
+    const std::function<void (const pipe_slot&)>& emit
+) {
+    // the prep cache only when it holds the whole range
+    if ((ic != NULL) && (first + loop_num > ic->img_num)) ic = NULL;
+    std::ifstream fp_img, fp_lbl;
+    if (ic == NULL) {
+        fp_img.open(FP_IN_INFMAP_BIN, std::ios::binary);
+        fp_lbl.open(FP_IN_LABEL_BIN, std::ios::binary);
+        uint32_t img_hdr[4], lbl_hdr[2];
+        fp_img.read(reinterpret_cast<char*>(img_hdr), sizeof(img_hdr));
+        fp_lbl.read(reinterpret_cast<char*>(lbl_hdr), sizeof(lbl_hdr));
+        if (!fp_img || !fp_lbl || (first + loop_num > (int)__builtin_bswap32(img_hdr[1]))) {
+            std::cerr << "pipeline: cannot read images " << first << " .. " << first + loop_num - 1 << " from the MNIST IDX files" << std::endl;
+            return -1;
+        }
+        fp_img.seekg(sizeof(img_hdr) + (size_t)first * 28 * 28);
+        fp_lbl.seekg(sizeof(lbl_hdr) + first);
+    }
+
+    vector<pipe_slot> slot(PIPE_SLOT_NUM);
+    for (int s = 0; s < PIPE_SLOT_NUM; s++) {
+        slot[s].infmap_qnt.assign(1, vector<vector<int8_t>>(32, vector<int8_t>(32, 0)));
+        slot[s].fc3_otfmap.assign(NET_CLASS_NUM, 0);
+    }
+    spsc_ring free_ring;
+    vector<spsc_ring> work(worker_num);
+    vector<spsc_ring> done(worker_num);
+    spsc_init(free_ring, PIPE_SLOT_NUM);
+    for (int w = 0; w < worker_num; w++) {
+        spsc_init(work[w], PIPE_SLOT_NUM);
+        spsc_init(done[w], PIPE_SLOT_NUM);
+    }
+    for (int s = 0; s < PIPE_SLOT_NUM; s++) spsc_push(free_ring, s);
+    free_ring.push_num = free_ring.occ_sum = free_ring.occ_max = 0;
+
+    vector<pipe_stage> stage(worker_num + 2);
+    for (size_t i = 0; i < stage.size(); i++) stage[i] = {0, 0.0};
+    vector<vector<layer_density>> worker_density(worker_num, density);
+    std::mutex cache_mu;
+    const pipe_clock::time_point t0 = pipe_clock::now();
+
+    // ingest: IDX read + preprocessing, or a copy from the prep cache, into a free slot
+    std::thread ingest([&]() {
+        pipe_stage& st = stage[0];
+        uint8_t pixel[28 * 28];
+        for (int loop = 0; loop < loop_num; loop++) {
+            const int s = spsc_pop(free_ring);
+            pipe_clock::time_point t = pipe_clock::now();
+            pipe_slot& sl = slot[s];
+            uint8_t label = 0;
+            if (ic != NULL) {
+                memcpy(sl.img, ic->img + (size_t)(first + loop) * 32 * 32, 32 * 32);
+                label = ic->label[first + loop];
+            } else {
+                fp_img.read(reinterpret_cast<char*>(pixel), sizeof(pixel));
+                fp_lbl.read(reinterpret_cast<char*>(&label), 1);
+                pad_image(pixel, sl.img);
+            }
+            for (int y = 0; y < 32; y++) {
+                std::copy(sl.img + y * 32, sl.img + (y + 1) * 32, sl.infmap_qnt[0][y].begin());
+            }
+            sl.loop  = first + loop;
+            sl.label = label;
+            st.busy_s += std::chrono::duration<double>(pipe_clock::now() - t).count();
+            st.item_num++;
+            spsc_push(work[loop % worker_num], s);
+        }
+        for (int w = 0; w < worker_num; w++) spsc_push(work[w], -1);
+    });
+
+    // compute
+    vector<std::thread> worker;
+    for (int w = 0; w < worker_num; w++) {
+        worker.emplace_back([&, w]() {
+            pipe_stage& st = stage[1 + w];
+            int32_t logit[NET_CLASS_NUM];
+            for (int s = spsc_pop(work[w]); s >= 0; s = spsc_pop(work[w])) {
+                pipe_clock::time_point t = pipe_clock::now();
+                pipe_slot& sl = slot[s];
+                cache_key key;
+                sl.is_hit = false;
+                if (cache != NULL) {
+                    std::lock_guard<std::mutex> lk(cache_mu);
+                    key = cache_key_of(*cache, sl.infmap_qnt);
+                    sl.is_hit = cache_lookup(*cache, key, sl.fc3_otfmap);
+                }
+                if (!sl.is_hit) {
+                    net_run_from(net, 0, sl.img, NULL, logit, worker_density[w].data());
+                    std::copy(logit, logit + NET_CLASS_NUM, sl.fc3_otfmap.begin());
+                    if (cache != NULL) {
+                        std::lock_guard<std::mutex> lk(cache_mu);
+                        cache_insert(*cache, key, sl.fc3_otfmap);
+                    }
+                }
+                st.busy_s += std::chrono::duration<double>(pipe_clock::now() - t).count();
+                st.item_num++;
+                spsc_push(done[w], s);
+            }
+        });
+    }
+
+    // emit: traces in image order, on the calling thread
+    pipe_stage& st = stage[worker_num + 1];
+    for (int loop = 0; loop < loop_num; loop++) {
+        const int s = spsc_pop(done[loop % worker_num]);
+        pipe_clock::time_point t = pipe_clock::now();
+        emit(slot[s]);
+        st.busy_s += std::chrono::duration<double>(pipe_clock::now() - t).count();
+        st.item_num++;
+        spsc_push(free_ring, s);
+    }
+    ingest.join();
+    for (int w = 0; w < worker_num; w++) worker[w].join();
+    const double wall_s = std::chrono::duration<double>(pipe_clock::now() - t0).count();
+
+    for (int w = 0; w < worker_num; w++) {
+        for (size_t k = 0; k < density.size(); k++) {
+            density[k].nz         += worker_density[w][k].nz;
+            density[k].total      += worker_density[w][k].total;
+            density[k].sparse_num += worker_density[w][k].sparse_num;
+            density[k].dense_num  += worker_density[w][k].dense_num;
+        }
+    }
+
+    const std::ios::fmtflags cout_flags = cout.flags();
+    const std::streamsize cout_prec = cout.precision();
+    cout << std::fixed << std::setprecision(3);
+    cout << "pipeline: " << loop_num << " images, " << worker_num << " workers, "
+         << PIPE_SLOT_NUM << " slots, " << wall_s << " s" << endl;
+    for (size_t i = 0; i < stage.size(); i++) {
+        std::string name = (i == 0) ? "ingest" : (i == stage.size() - 1) ? "emit" : "worker" + std::to_string(i - 1);
+        cout << "  " << std::left << std::setw(8) << name << std::right
+             << " items " << std::setw(6) << stage[i].item_num
+             << ", busy " << std::setw(8) << stage[i].busy_s << " s ("
+             << std::setprecision(1) << std::setw(5) << ((wall_s == 0) ? 0.0 : 100.0 * stage[i].busy_s / wall_s) << "%)"
+             << std::setprecision(3) << endl;
+    }
+    ring_report("free", free_ring);
+    for (int w = 0; w < worker_num; w++) {
+        ring_report("work" + std::to_string(w), work[w]);
+        ring_report("done" + std::to_string(w), done[w]);
+    }
+    cout.flags(cout_flags);
+    cout.precision(cout_prec);
+    return 0;
+}
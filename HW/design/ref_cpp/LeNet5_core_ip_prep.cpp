@@ -0,0 +1,156 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.24
+// Associated Filename: LeNet5_core_ip_prep.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: One-time preprocessing of the MNIST test set into padded int8 files
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Every run used to decode the IDX file and normalize, quantize and pad
+//     each pixel again. prep does it once: the reference maps the int8 cache
+//     and copies 1 KB per image, the firmware reads the RDMA file and copies
+//     its 256 beats per image straight into an infmap DMA buffer.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "LeNet5_core_ip.h"
+
+uint64_t fnv1a_64w (uint64_t hash, const uint64_t* word, const size_t num) {
+    for (size_t i = 0; i < num; i++) {
+        hash ^= word[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static size_t prep_align (const size_t ofs, const size_t align) {
+    return (ofs + align - 1) / align * align;
+}
+
+// labels padded to whole words for the hash
+static size_t cache_label_byte (const int img_num) {
+    return prep_align(img_num, sizeof(uint64_t));
+}
+
+bool img_cache_open (img_cache& ic) {
+    const int fd = open(FP_IMG_CACHE, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat sb, src;
+    img_cache_hdr hdr;
+    if ((fstat(fd, &sb) != 0) || ((size_t)sb.st_size < IMG_CACHE_HDR_BYTE)) {
+        close(fd);
+        return false;
+    }
+    const size_t map_byte = sb.st_size;
+    void* p = mmap(NULL, map_byte, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+    const uint8_t* base = static_cast<const uint8_t*>(p);
+    memcpy(&hdr, base, sizeof(hdr));
+    const size_t data_byte = (size_t)hdr.img_num * 32 * 32 + cache_label_byte(hdr.img_num);
+    if ((hdr.magic != IMG_CACHE_MAGIC) || (hdr.version != IMG_CACHE_VERSION) ||
+        (hdr.label_ofs != IMG_CACHE_HDR_BYTE + (size_t)hdr.img_num * 32 * 32) || (IMG_CACHE_HDR_BYTE + data_byte > map_byte)) {
+        std::cerr << "image cache: " << FP_IMG_CACHE << " has an unknown format, run 'prep' again" << std::endl;
+        munmap(p, map_byte);
+        return false;
+    }
+    if ((stat(FP_IN_INFMAP_BIN, &src) != 0) || ((uint64_t)src.st_size != hdr.src_byte) || ((int64_t)src.st_mtime != hdr.src_mtime)) {
+        std::cerr << "image cache: " << FP_IN_INFMAP_BIN << " changed since 'prep', using the IDX files" << std::endl;
+        munmap(p, map_byte);
+        return false;
+    }
+    if (fnv1a_64w(FNV_OFFSET, reinterpret_cast<const uint64_t*>(base + IMG_CACHE_HDR_BYTE), data_byte / sizeof(uint64_t)) != hdr.data_hash) {
+        std::cerr << "image cache: " << FP_IMG_CACHE << " is corrupt, using the IDX files" << std::endl;
+        munmap(p, map_byte);
+        return false;
+    }
+    ic.img_num = hdr.img_num;
+    ic.img     = reinterpret_cast<const int8_t*>(base + IMG_CACHE_HDR_BYTE);
+    ic.label   = base + hdr.label_ofs;
+    ic.map     = std::shared_ptr<const void>(base, [map_byte](const void* q) { munmap(const_cast<void*>(q), map_byte); });
+    cout << "image cache: " << FP_IMG_CACHE << " (" << ic.img_num << " images, mmap)" << endl;
+    return true;
+}
+
+// temporary name + rename, a reader never maps a partial file
+static bool prep_write (const char* path, const vector<uint8_t>& buf) {
+    const std::string tmp = std::string(path) + "." + std::to_string(getpid());
+    std::ofstream fp(tmp, std::ios::binary | std::ios::trunc);
+    fp.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+    fp.close();
+    if (!fp || (rename(tmp.c_str(), path) != 0)) {
+        std::cerr << "prep: cannot write " << path << std::endl;
+        unlink(tmp.c_str());
+        return false;
+    }
+    cout << "prep: " << path << " (" << buf.size() / 1024 << " KB)" << endl;
+    return true;
+}
+
+int run_prep (int argc, char** argv) {
+    if (argc > 3) {
+        printf("Usage : <executable> prep [image_num]\n");
+        return -1;
+    }
+    vector<uint8_t> pixel, label;
+    const int img_num = rd_idx_set((argc == 3) ? atoi(argv[2]) : INT32_MAX, pixel, label);
+    struct stat src;
+    if ((img_num <= 0) || (stat(FP_IN_INFMAP_BIN, &src) != 0)) {
+        std::cerr << "prep: no images read from " << FP_IN_INFMAP_BIN << std::endl;
+        return -1;
+    }
+
+    // int8 [N][32][32] + labels
+    const size_t label_ofs = IMG_CACHE_HDR_BYTE + (size_t)img_num * 32 * 32;
+    vector<uint8_t> cache(label_ofs + cache_label_byte(img_num), 0);
+    int8_t* img = reinterpret_cast<int8_t*>(cache.data() + IMG_CACHE_HDR_BYTE);
+    for (int i = 0; i < img_num; i++) pad_image(&pixel[(size_t)i * 28 * 28], img + (size_t)i * 32 * 32);
+    memcpy(cache.data() + label_ofs, label.data(), img_num);
+    img_cache_hdr chdr;
+    memset(&chdr, 0, sizeof(chdr));
+    chdr.magic     = IMG_CACHE_MAGIC;
+    chdr.version   = IMG_CACHE_VERSION;
+    chdr.img_num   = img_num;
+    chdr.label_ofs = label_ofs;
+    chdr.src_byte  = src.st_size;
+    chdr.src_mtime = src.st_mtime;
+    chdr.data_hash = fnv1a_64w(FNV_OFFSET, reinterpret_cast<const uint64_t*>(cache.data() + IMG_CACHE_HDR_BYTE),
+                               (cache.size() - IMG_CACHE_HDR_BYTE) / sizeof(uint64_t));
+    memcpy(cache.data(), &chdr, sizeof(chdr));
+
+    // RDMA bus layout, rdma_pack_img
+    const size_t data_ofs = prep_align(IMG_RDMA_HDR_BYTE + (size_t)img_num * sizeof(uint64_t), IMG_RDMA_ALIGN);
+    vector<uint8_t> rdma(data_ofs + (size_t)img_num * RDMA_IMG_BEAT_NUM * sizeof(uint64_t), 0);
+    uint64_t* table = reinterpret_cast<uint64_t*>(rdma.data() + IMG_RDMA_HDR_BYTE);
+    for (int i = 0; i < img_num; i++) {
+        const int8_t* q = img + (size_t)i * 32 * 32;
+        uint64_t* beat = reinterpret_cast<uint64_t*>(rdma.data() + data_ofs) + (size_t)i * RDMA_IMG_BEAT_NUM;
+        rdma_pack_img(q, beat);
+        table[i] = fnv1a_64w(FNV_OFFSET, beat, RDMA_IMG_BEAT_NUM);
+    }
+    img_rdma_hdr rhdr;
+    memset(&rhdr, 0, sizeof(rhdr));
+    rhdr.magic      = IMG_RDMA_MAGIC;
+    rhdr.version    = IMG_RDMA_VERSION;
+    rhdr.img_num    = img_num;
+    rhdr.beat_num   = RDMA_IMG_BEAT_NUM;
+    rhdr.beat_byte  = sizeof(uint64_t);
+    rhdr.col_num    = RDMA_IMG_COL_NUM;
+    rhdr.data_ofs   = data_ofs;
+    rhdr.src_hash   = param_hash_i8(0, vector<int8_t>(pixel.begin(), pixel.end()));
+    rhdr.table_hash = fnv1a_64w(FNV_OFFSET, table, img_num);
+    memcpy(rdma.data(), &rhdr, sizeof(rhdr));
+
+    if (!prep_write(FP_IMG_CACHE, cache) || !prep_write(FP_IMG_RDMA, rdma)) return -1;
+    cout << "prep: " << img_num << " images, copy " << FP_IMG_RDMA << " to the SD card as LeNet5/img_rdma.bin" << endl;
+    return 0;
+}
@@ -0,0 +1,146 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.17
+// Associated Filename: LeNet5_core_ip_range.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Static accumulator range analysis and the int16 accumulation plan
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     For an input x in [in_lo, in_hi] a MAC term w * x lies in
+//     [min(w * in_lo, w * in_hi), max(w * in_lo, w * in_hi)], so the bounds
+//     of every accumulator follow from the loaded weights alone.
+//     A run of MAC steps accumulated from 0 never leaves
+//     [sum of the negative term bounds, sum of the positive term bounds],
+//     whatever the order of its partial sums. ACC16_CHUNK is the longest run
+//     length for which every aligned run of every och stays inside int16.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "LeNet5_core_ip.h"
+
+// conv1 inputs are the 256 quantized pixel values (padding is pixel 0)
+void conv1_input_range (int& lo, int& hi) {
+    lo = quantize_pixel(0);
+    hi = lo;
+    for (int pixel = 1; pixel < 256; pixel++) {
+        lo = std::min(lo, quantize_pixel(pixel));
+        hi = std::max(hi, quantize_pixel(pixel));
+    }
+}
+
+static int signed_bw (const int64_t lo, const int64_t hi) {
+    int bw = 1;
+    while ((lo < -(int64_t(1) << (bw - 1))) || (hi > (int64_t(1) << (bw - 1)) - 1)) bw++;
+    return bw;
+}
+
+// term_lo / term_hi: [och][step] bounds of one MAC step (a step may hold several terms)
+static void plan_steps (
+    layer_plan& plan,
+    const vector<vector<int32_t>>& term_lo,
+    const vector<vector<int32_t>>& term_hi,
+    const pack_array<int32_t>& bias
+) {
+    const int OCH_  = term_lo.size();
+    const int STEPS = term_lo[0].size();
+
+    int64_t acc_lo = INT64_MAX, acc_hi = INT64_MIN;
+    for (int och = 0; och < OCH_; och++) {
+        int64_t lo = bias[och], hi = bias[och];
+        for (int t = 0; t < STEPS; t++) {
+            lo += term_lo[och][t];
+            hi += term_hi[och][t];
+        }
+        acc_lo = std::min(acc_lo, lo);
+        acc_hi = std::max(acc_hi, hi);
+    }
+    plan.acc_lo = acc_lo;
+    plan.acc_hi = acc_hi;
+    plan.acc_bw = signed_bw(acc_lo, acc_hi);
+
+    // longest run length whose aligned runs all fit int16
+    plan.chunk_max = 0;
+    for (int len = STEPS; len > 0; len--) {
+        bool is_safe = true;
+        for (int och = 0; (och < OCH_) && is_safe; och++) {
+            for (int t0 = 0; (t0 < STEPS) && is_safe; t0 += len) {
+                int64_t neg = 0, pos = 0;
+                for (int t = t0; t < std::min(STEPS, t0 + len); t++) {
+                    neg += std::min(0, term_lo[och][t]);
+                    pos += std::max(0, term_hi[och][t]);
+                }
+                is_safe = (neg >= INT16_MIN) && (pos <= INT16_MAX);
+            }
+        }
+        if (is_safe) {
+            plan.chunk_max = len;
+            break;
+        }
+    }
+    plan.chunk = (plan.chunk_max >= ACC16_CHUNK_MIN) ? plan.chunk_max : 0;
+}
+
+layer_plan plan_conv_layer (const char* name, packed_conv& pw, const int in_lo, const int in_hi, const int hw_bw) {
+    layer_plan plan = {name, in_lo, in_hi, 0, 0, 0, hw_bw, 0, 0};
+    const int WIN = pw.ICH * pw.KY * pw.KX;
+    vector<vector<int32_t>> term_lo(pw.OCH, vector<int32_t>(WIN));
+    vector<vector<int32_t>> term_hi(pw.OCH, vector<int32_t>(WIN));
+
+    // step order of conv_layer_packed: ich, ky, kx
+    for (int och = 0; och < pw.OCH; och++) {
+        const int blk = och / PACK_OCH_BLK, lane = och % PACK_OCH_BLK;
+        for (int t = 0; t < WIN; t++) {
+            const int32_t w = pw.weight[(blk * WIN + t) * PACK_OCH_BLK + lane];
+            term_lo[och][t] = std::min(w * in_lo, w * in_hi);
+            term_hi[och][t] = std::max(w * in_lo, w * in_hi);
+        }
+    }
+    plan_steps(plan, term_lo, term_hi, pw.bias);
+    pw.ACC16_CHUNK = plan.chunk;
+    return plan;
+}
+
+layer_plan plan_fc_layer (const char* name, packed_fc& pw, const int in_lo, const int in_hi) {
+    layer_plan plan = {name, in_lo, in_hi, 0, 0, 0, 0, 0, 0};
+    vector<vector<int32_t>> term_lo(pw.OCH, vector<int32_t>(pw.ICH_PAIR));
+    vector<vector<int32_t>> term_hi(pw.OCH, vector<int32_t>(pw.ICH_PAIR));
+
+    // step of fc_layer_packed: one input channel pair
+    for (int och = 0; och < pw.OCH; och++) {
+        const int blk = och / PACK_OCH_BLK, lane = och % PACK_OCH_BLK;
+        for (int p = 0; p < pw.ICH_PAIR; p++) {
+            int32_t lo = 0, hi = 0;
+            for (int h = 0; h < 2; h++) {
+                const int32_t w = pw.weight[((blk * pw.ICH_PAIR + p) * PACK_OCH_BLK + lane) * 2 + h];
+                lo += std::min(w * in_lo, w * in_hi);
+                hi += std::max(w * in_lo, w * in_hi);
+            }
+            term_lo[och][p] = lo;
+            term_hi[och][p] = hi;
+        }
+    }
+    plan_steps(plan, term_lo, term_hi, pw.bias);
+    pw.ACC16_CHUNK = plan.chunk;
+    return plan;
+}
+
+void plan_report (const vector<layer_plan>& plans) {
+    cout << "accumulator range plan (int16 runs of at least " << ACC16_CHUNK_MIN << " steps)" << endl;
+    for (size_t i = 0; i < plans.size(); i++) {
+        const layer_plan& p = plans[i];
+        cout << "  " << std::left << std::setw(6) << p.name << std::right
+             << " in [" << p.in_lo << ", " << p.in_hi << "]"
+             << " acc [" << p.acc_lo << ", " << p.acc_hi << "] " << p.acc_bw << "b";
+        if (p.hw_bw != 0) {
+            cout << " (HW " << p.hw_bw << "b" << ((p.acc_bw > p.hw_bw) ? ", OVERFLOW" : "") << ")";
+        }
+        if (p.chunk != 0) {
+            cout << ", int16 x " << p.chunk << endl;
+        } else {
+            cout << ", int32 (int16-safe run " << p.chunk_max << ")" << endl;
+        }
+    }
+}
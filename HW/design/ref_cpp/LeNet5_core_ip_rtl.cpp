@@ -0,0 +1,131 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.29
+// Associated Filename: LeNet5_core_ip_rtl.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: RTL parameters read from the Verilog sources
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     The conv accumulator widths, the fc weight beat blocking, the bus width
+//     and the RDMA parameter beat count were copies of
+//     defines_parameter_LeNet5.vh and dma_LeNet5_top.v. They are read from
+//     those files at start-up instead: every parameter / localparam that is
+//     assigned an integer literal is taken, expressions are skipped. The
+//     result record format comes from the firmware header and is checked
+//     against DATA_IDX_BW here. The layer shapes key the packed model.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <map>
+#include "LeNet5_core_ip.h"
+#include "dma_LeNet5_result.h"
+
+// name -> value of the literal parameter / localparam assignments of one file
+static bool rd_verilog_param (const char* path, std::map<std::string, long>& param) {
+    std::ifstream fp(path);
+    if (!fp.is_open()) {
+        std::cerr << "Error opening " << path << " for the RTL parameters" << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(fp, line)) {
+        line = line.substr(0, line.find("//"));
+        std::istringstream ss(line);
+        std::string key;
+        ss >> key;
+        if ((key != "parameter") && (key != "localparam")) continue;
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            item = item.substr(0, item.find(';'));
+            const size_t eq = item.find('=');
+            if (eq == std::string::npos) continue;
+            std::istringstream name_ss(item.substr(0, eq)), value_ss(item.substr(eq + 1));
+            std::string name, value, rest;
+            name_ss >> name;
+            value_ss >> value;
+            if (name.empty() || value.empty() || (value_ss >> rest)) continue;
+            if (value.find_first_not_of("0123456789") != std::string::npos) continue;
+            param[name] = atol(value.c_str());
+        }
+    }
+    return true;
+}
+
+static bool rtl_get (const std::map<std::string, long>& param, const char* path, const char* name, int& value) {
+    const std::map<std::string, long>::const_iterator it = param.find(name);
+    if (it == param.end()) {
+        std::cerr << "rtl: " << name << " is not an integer parameter of " << path << std::endl;
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+bool rd_rtl_param (rtl_param& rtl) {
+    std::map<std::string, long> def, top;
+    if (!rd_verilog_param(FP_RTL_DEFINES, def) || !rd_verilog_param(FP_RTL_DMA_TOP, top)) return false;
+
+    int I_F_BW = 0, TOP_DATA_IDX_BW = 0, AXI_DATA_W = 0;
+    if (!rtl_get(def, FP_RTL_DEFINES, "CONV1_O_F_BW", rtl.CONV_O_F_BW[0]) ||
+        !rtl_get(def, FP_RTL_DEFINES, "CONV2_O_F_BW", rtl.CONV_O_F_BW[1]) ||
+        !rtl_get(def, FP_RTL_DEFINES, "FC1_ICH_B", rtl.FC_ICH_B[0]) ||
+        !rtl_get(def, FP_RTL_DEFINES, "FC2_ICH_B", rtl.FC_ICH_B[1]) ||
+        !rtl_get(def, FP_RTL_DEFINES, "FC3_ICH_B", rtl.FC_ICH_B[2]) ||
+        !rtl_get(def, FP_RTL_DEFINES, "DATA_IDX_BW", rtl.DATA_IDX_BW) ||
+        !rtl_get(def, FP_RTL_DEFINES, "I_F_BW", I_F_BW) ||
+        !rtl_get(top, FP_RTL_DMA_TOP, "C_M00_AXI_DATA_WIDTH", AXI_DATA_W) ||
+        !rtl_get(top, FP_RTL_DMA_TOP, "NUM_RD_PARAM", rtl.NUM_RD_PARAM) ||
+        !rtl_get(top, FP_RTL_DMA_TOP, "DATA_IDX_BW", TOP_DATA_IDX_BW)) {
+        return false;
+    }
+    // conv: OCH ICH KY KX, fc: OCH ICH 1 1
+    const char* och_name[NET_LAYER_NUM] = {"CONV1_OCH", "CONV2_OCH", "FC1_OCH", "FC2_OCH", "FC3_OCH"};
+    const char* ich_name[NET_LAYER_NUM] = {"CONV1_ICH", "CONV2_ICH", "FC1_ICH", "FC2_ICH", "FC3_ICH"};
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        int* shape = rtl.LAYER_SHAPE[k];
+        shape[2] = 1;
+        shape[3] = 1;
+        if (!rtl_get(def, FP_RTL_DEFINES, och_name[k], shape[0]) || !rtl_get(def, FP_RTL_DEFINES, ich_name[k], shape[1]) ||
+            ((k < 2) && (!rtl_get(def, FP_RTL_DEFINES, "CONV_KY", shape[2]) || !rtl_get(def, FP_RTL_DEFINES, "CONV_KX", shape[3])))) {
+            return false;
+        }
+        if ((shape[0] <= 0) || (shape[1] <= 0) || (shape[2] <= 0) || (shape[3] <= 0)) {
+            std::cerr << "rtl: " << och_name[k] << " / " << ich_name[k] << " give an empty layer" << std::endl;
+            return false;
+        }
+    }
+    rtl.AXI_DATA_BYTE = AXI_DATA_W / 8;
+
+    // the beat packers build 64-bit beats of RDMA_IMG_COL_NUM pixels, the records are the firmware's
+    if (rtl.AXI_DATA_BYTE != (int)sizeof(uint64_t)) {
+        std::cerr << "rtl: C_M00_AXI_DATA_WIDTH is " << AXI_DATA_W << ", the beat packers are 64-bit" << std::endl;
+        return false;
+    }
+    if ((I_F_BW <= 0) || (32 / I_F_BW != RDMA_IMG_COL_NUM)) {
+        std::cerr << "rtl: B_COL_NUM is 32 / " << I_F_BW << ", RDMA_IMG_COL_NUM is " << RDMA_IMG_COL_NUM << std::endl;
+        return false;
+    }
+    if ((TOP_DATA_IDX_BW != rtl.DATA_IDX_BW) || (((1ULL << rtl.DATA_IDX_BW) - 1) != RESULT_IDX_MASK)) {
+        std::cerr << "rtl: DATA_IDX_BW is " << rtl.DATA_IDX_BW << " (" << TOP_DATA_IDX_BW << " in dma_LeNet5_top.v), "
+                  << "the firmware result record has RESULT_IDX_MASK 0x" << std::hex << RESULT_IDX_MASK << std::dec << std::endl;
+        return false;
+    }
+    for (int k = 0; k < 3; k++) {
+        if (rtl.FC_ICH_B[k] <= 0) {
+            std::cerr << "rtl: FC" << k + 1 << "_ICH_B is " << rtl.FC_ICH_B[k] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t rtl_result_rec (const int idx, const int cls) {
+    return RESULT_REC(idx, cls);
+}
+
+int rtl_result_bit () {
+    return __builtin_popcountll(RESULT_REC(RESULT_IDX_MASK, 0xf));
+}
@@ -0,0 +1,379 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.19
+// Associated Filename: LeNet5_core_ip_serve.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Inference daemon with dynamic batching over a UNIX domain socket
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     The parameters are loaded and packed once by main. The I/O thread polls
+//     the listening socket and the clients, cuts requests out of each client
+//     stream and queues them. The batch thread takes up to max_batch requests
+//     once the batch is full or the oldest request has waited max_wait_us,
+//     and hands the responses back through an eventfd.
+//     Backpressure: while queue_depth requests are waiting, client sockets are
+//     not read, so senders block on their full socket buffers. A client that
+//     does not read its responses is not read either once SERVE_OUT_MAX bytes
+//     of them are pending.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include "LeNet5_core_ip.h"
+
+typedef std::chrono::steady_clock serve_clock;
+
+struct serve_conn {
+    int             fd;
+    uint32_t        gen;       // bumped on close, stale responses are dropped
+    vector<uint8_t> in;
+    size_t          in_ofs;
+    vector<uint8_t> out;
+    size_t          out_ofs;
+};
+
+struct serve_item {
+    int                     conn;
+    uint32_t                gen;
+    uint32_t                id;
+    int8_t                  img[NET_IMG_BYTE];
+    serve_clock::time_point t_arrive;
+};
+
+struct serve_done {
+    int       conn;
+    uint32_t  gen;
+    serve_rsp rsp;
+};
+
+struct serve_state {
+    std::mutex              mu;
+    std::condition_variable cv;
+    std::deque<serve_item>  queue;
+    vector<serve_done>      done;
+    std::atomic<int>        queued;
+    int                     event_fd;
+    bool                    is_stop;
+
+    // stats
+    unsigned long request_num;
+    unsigned long batch_num;
+    unsigned long queue_max;
+    unsigned long stall_num;   // poll rounds with the clients held back
+    unsigned long reject_num;  // padded images outside the planned conv1 input range
+};
+
+static volatile sig_atomic_t serve_is_stop = 0;
+
+static void serve_on_signal (int) {
+    serve_is_stop = 1;
+}
+
+//===========================================================================
+// batch thread
+//===========================================================================
+static void serve_batch_loop (serve_state& st, const lenet5_net& net, const int max_batch, const int max_wait_us) {
+    vector<serve_item> batch;
+    std::unique_lock<std::mutex> lk(st.mu);
+    while (!st.is_stop) {
+        if (st.queue.empty()) {
+            st.cv.wait(lk);
+            continue;
+        }
+        serve_clock::time_point deadline = st.queue.front().t_arrive + std::chrono::microseconds(max_wait_us);
+        if (((int)st.queue.size() < max_batch) && (serve_clock::now() < deadline)) {
+            st.cv.wait_until(lk, deadline);
+            continue;
+        }
+
+        const int n = std::min<int>(max_batch, st.queue.size());
+        batch.assign(st.queue.begin(), st.queue.begin() + n);
+        st.queue.erase(st.queue.begin(), st.queue.begin() + n);
+        st.queued -= n;
+        st.batch_num++;
+        lk.unlock();
+
+        vector<serve_done> rsp(n);
+        for (int i = 0; i < n; i++) {
+            rsp[i].conn = batch[i].conn;
+            rsp[i].gen  = batch[i].gen;
+            rsp[i].rsp.magic = SERVE_MAGIC;
+            rsp[i].rsp.id    = batch[i].id;
+            rsp[i].rsp.batch = n;
+            rsp[i].rsp.cls   = net_run_image(net, batch[i].img, rsp[i].rsp.logit);
+        }
+
+        lk.lock();
+        st.done.insert(st.done.end(), rsp.begin(), rsp.end());
+        uint64_t one = 1;
+        if (write(st.event_fd, &one, sizeof(one)) != sizeof(one)) {
+            std::cerr << "serve: eventfd write failed" << std::endl;
+        }
+    }
+}
+
+//===========================================================================
+// I/O thread
+//===========================================================================
+static void conn_close (serve_conn& c) {
+    close(c.fd);
+    c.fd = -1;
+    c.gen++;
+    c.in.clear();
+    c.in_ofs = 0;
+    c.out.clear();
+    c.out_ofs = 0;
+}
+
+// cuts complete requests out of the stream until the queue is full;
+// false on a protocol error. a padded image outside the conv1 input range
+// the accumulators are planned for is answered at once with NET_CLS_REJECT
+static bool conn_is_out_full (const serve_conn& c) {
+    return c.out.size() - c.out_ofs >= SERVE_OUT_MAX;
+}
+
+static bool conn_parse (serve_state& st, serve_conn& c, const int idx, const int queue_depth, const lenet5_net& net) {
+    while ((c.in.size() - c.in_ofs >= sizeof(serve_req_hdr)) && (st.queued < queue_depth) && !conn_is_out_full(c)) {
+        serve_req_hdr hdr;
+        memcpy(&hdr, &c.in[c.in_ofs], sizeof(hdr));
+        size_t body;
+        if ((hdr.magic == SERVE_MAGIC) && (hdr.format == SERVE_FMT_RAW28)) {
+            body = 28 * 28;
+        } else if ((hdr.magic == SERVE_MAGIC) && (hdr.format == SERVE_FMT_PAD32)) {
+            body = NET_IMG_BYTE;
+        } else {
+            std::cerr << "serve: bad request header (magic " << std::hex << hdr.magic << std::dec
+                      << ", format " << hdr.format << "), closing client" << std::endl;
+            return false;
+        }
+        if (c.in.size() - c.in_ofs < sizeof(hdr) + body) break;
+
+        serve_item item;
+        item.conn = idx;
+        item.gen  = c.gen;
+        item.id   = hdr.id;
+        const uint8_t* payload = &c.in[c.in_ofs + sizeof(hdr)];
+        if (hdr.format == SERVE_FMT_RAW28) {
+            pad_image(payload, item.img);
+        } else {
+            memcpy(item.img, payload, NET_IMG_BYTE);
+        }
+        c.in_ofs += sizeof(hdr) + body;
+        if (!net_img_ok(net, item.img)) {
+            serve_rsp rsp;
+            memset(&rsp, 0, sizeof(rsp));
+            rsp.magic = SERVE_MAGIC;
+            rsp.id    = hdr.id;
+            rsp.cls   = NET_CLS_REJECT;
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(&rsp);
+            c.out.insert(c.out.end(), p, p + sizeof(rsp));
+            st.reject_num++;
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lk(st.mu);
+        item.t_arrive = serve_clock::now();
+        st.queue.push_back(item);
+        st.queued++;
+        st.request_num++;
+        st.queue_max = std::max<unsigned long>(st.queue_max, st.queue.size());
+        st.cv.notify_one();
+    }
+    if (c.in_ofs == c.in.size()) {
+        c.in.clear();
+        c.in_ofs = 0;
+    } else if (c.in_ofs >= 65536) {
+        c.in.erase(c.in.begin(), c.in.begin() + c.in_ofs);  // keep a streaming client's buffer bounded
+        c.in_ofs = 0;
+    }
+    return true;
+}
+
+static bool conn_flush (serve_conn& c) {
+    while (c.out_ofs < c.out.size()) {
+        ssize_t n = send(c.fd, &c.out[c.out_ofs], c.out.size() - c.out_ofs, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (c.out_ofs >= SERVE_OUT_MAX) {
+                c.out.erase(c.out.begin(), c.out.begin() + c.out_ofs);  // a slow reader's buffer stays bounded
+                c.out_ofs = 0;
+            }
+            return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+        }
+        c.out_ofs += n;
+    }
+    c.out.clear();
+    c.out_ofs = 0;
+    return true;
+}
+
+int run_serve (int argc, char** argv, const lenet5_net& net) {
+    const char* path      = argv[2];
+    const int max_batch   = std::max(1, atoi(argv[3]));
+    const int max_wait_us = std::max(0, atoi(argv[4]));
+    const int queue_depth = (argc > 5) ? std::max(max_batch, atoi(argv[5])) : SERVE_QUEUE_DEPTH;
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    // a socket file nobody accepts on is left over from a dead daemon;
+    // never unlink the socket of a live one
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((probe >= 0) && (connect(probe, (sockaddr*)&addr, sizeof(addr)) == 0)) {
+        std::cerr << "serve: a daemon already listens on " << path << std::endl;
+        close(probe);
+        if (lfd >= 0) close(lfd);
+        return -1;
+    }
+    if ((probe >= 0) && (errno == ECONNREFUSED)) {
+        unlink(path);
+    }
+    if (probe >= 0) close(probe);
+    if ((lfd < 0) || (bind(lfd, (sockaddr*)&addr, sizeof(addr)) != 0) || (listen(lfd, SERVE_CONN_MAX) != 0)) {
+        std::cerr << "serve: cannot listen on " << path << ": " << strerror(errno) << std::endl;
+        return -1;
+    }
+
+    serve_state st;
+    st.queued      = 0;
+    st.event_fd    = eventfd(0, EFD_NONBLOCK);
+    st.is_stop     = false;
+    st.request_num = 0;
+    st.batch_num   = 0;
+    st.queue_max   = 0;
+    st.stall_num   = 0;
+    st.reject_num  = 0;
+    std::thread batch_thread(serve_batch_loop, std::ref(st), std::cref(net), max_batch, max_wait_us);
+
+    signal(SIGINT, serve_on_signal);
+    signal(SIGTERM, serve_on_signal);
+    cout << "serve: " << path << ", max_batch " << max_batch << ", max_wait " << max_wait_us
+         << " us, queue_depth " << queue_depth << endl;
+
+    vector<serve_conn> conn(SERVE_CONN_MAX);
+    for (int i = 0; i < SERVE_CONN_MAX; i++) {
+        conn[i].fd = -1;
+        conn[i].gen = 0;
+        conn[i].in_ofs = 0;
+        conn[i].out_ofs = 0;
+    }
+    vector<pollfd> pfd;
+    vector<int> pfd_conn;
+    vector<serve_done> done;
+    uint8_t buf[16384];
+
+    while (!serve_is_stop) {
+        // requests left in the client buffers by an earlier full queue
+        for (int i = 0; i < SERVE_CONN_MAX; i++) {
+            if ((conn[i].fd >= 0) && (conn[i].in_ofs < conn[i].in.size()) && !conn_parse(st, conn[i], i, queue_depth, net)) {
+                conn_close(conn[i]);
+            }
+        }
+        const bool is_full = (st.queued >= queue_depth);
+        st.stall_num += is_full;
+        pfd.clear();
+        pfd_conn.clear();
+        pfd.push_back({lfd, POLLIN, 0});
+        pfd.push_back({st.event_fd, POLLIN, 0});
+        for (int i = 0; i < SERVE_CONN_MAX; i++) {
+            if (conn[i].fd < 0) continue;
+            short ev = ((is_full || conn_is_out_full(conn[i])) ? 0 : POLLIN) | (conn[i].out.empty() ? 0 : POLLOUT);
+            pfd.push_back({conn[i].fd, ev, 0});
+            pfd_conn.push_back(i);
+        }
+        if (poll(pfd.data(), pfd.size(), is_full ? 1 : 100) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "serve: poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        if (pfd[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+                int i = 0;
+                while ((i < SERVE_CONN_MAX) && (conn[i].fd >= 0)) i++;
+                if (i == SERVE_CONN_MAX) {
+                    std::cerr << "serve: too many clients" << std::endl;
+                    close(fd);
+                    continue;
+                }
+                conn[i].fd = fd;
+            }
+        }
+
+        if (pfd[1].revents & POLLIN) {
+            uint64_t cnt;
+            if (read(st.event_fd, &cnt, sizeof(cnt)) == sizeof(cnt)) {
+                std::lock_guard<std::mutex> lk(st.mu);
+                done.swap(st.done);
+            }
+            for (size_t d = 0; d < done.size(); d++) {
+                serve_conn& c = conn[done[d].conn];
+                if ((c.fd < 0) || (c.gen != done[d].gen)) continue;  // client gone
+                const uint8_t* p = reinterpret_cast<const uint8_t*>(&done[d].rsp);
+                c.out.insert(c.out.end(), p, p + sizeof(serve_rsp));
+            }
+            done.clear();
+            for (int i = 0; i < SERVE_CONN_MAX; i++) {
+                if ((conn[i].fd >= 0) && !conn_flush(conn[i])) conn_close(conn[i]);
+            }
+        }
+
+        for (size_t p = 2; p < pfd.size(); p++) {
+            serve_conn& c = conn[pfd_conn[p - 2]];
+            if (c.fd < 0) continue;
+            if (pfd[p].revents & POLLOUT) {
+                if (!conn_flush(c)) {
+                    conn_close(c);
+                    continue;
+                }
+            }
+            if (pfd[p].revents & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t n = recv(c.fd, buf, sizeof(buf), MSG_DONTWAIT);
+                if (n == 0 || ((n < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK))) {
+                    conn_close(c);
+                    continue;
+                }
+                if (n > 0) {
+                    c.in.insert(c.in.end(), buf, buf + n);
+                    if (!conn_parse(st, c, pfd_conn[p - 2], queue_depth, net)) conn_close(c);
+                }
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(st.mu);
+        st.is_stop = true;
+        st.cv.notify_one();
+    }
+    batch_thread.join();
+    for (int i = 0; i < SERVE_CONN_MAX; i++) {
+        if (conn[i].fd >= 0) conn_close(conn[i]);
+    }
+    close(lfd);
+    close(st.event_fd);
+    unlink(path);
+
+    cout << "serve: " << st.request_num << " requests in " << st.batch_num << " batches (avg "
+         << std::fixed << std::setprecision(2) << ((st.batch_num == 0) ? 0.0 : 1.0 * st.request_num / st.batch_num)
+         << "), queue max " << st.queue_max << ", backpressure rounds " << st.stall_num
+         << ", rejected images " << st.reject_num << endl;
+    return 0;
+}
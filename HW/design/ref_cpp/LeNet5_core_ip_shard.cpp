@@ -0,0 +1,348 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.22
+// Associated Filename: LeNet5_core_ip_shard.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Sharded evaluation over processes / machines and the result merge
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Every shard maps the same results file and writes only the records of
+//     its own images, so shards need no coordination and can run on other
+//     machines against a shared filesystem (--range / --shard with --out).
+//     The launcher forks the shards on this machine, one NUMA node each
+//     round-robin (CPU affinity + preferred memory node from sysfs), and
+//     merges when all of them have exited.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/mempolicy.h>
+#include "LeNet5_core_ip.h"
+
+int parse_shard_opt (int& argc, char** argv, shard_opt& opt) {
+    opt.is_on   = false;
+    opt.shard_i = 0;
+    opt.shard_n = 0;
+    opt.start   = 0;
+    opt.count   = 0;
+    opt.path    = FP_SHARD_RESULT;
+    opt.run     = "";
+    int n = 1;
+    for (int i = 1; i < argc; i++) {
+        const std::string a = argv[i];
+        if ((a != "--shard") && (a != "--range") && (a != "--out") && (a != "--run")) {
+            argv[n++] = argv[i];
+            continue;
+        }
+        if (i + 1 == argc) {
+            std::cerr << a << ": missing value" << std::endl;
+            return -1;
+        }
+        const char* v = argv[++i];
+        if (a == "--out") {
+            opt.path = v;
+        } else if (a == "--run") {
+            opt.run = v;
+        } else if (a == "--shard") {
+            if ((sscanf(v, "%d/%d", &opt.shard_i, &opt.shard_n) != 2) || (opt.shard_n <= 0) ||
+                (opt.shard_i < 0) || (opt.shard_i >= opt.shard_n)) {
+                std::cerr << "--shard " << v << ": expected i/n with 0 <= i < n" << std::endl;
+                return -1;
+            }
+            opt.is_on = true;
+        } else {
+            if ((sscanf(v, "%d:%d", &opt.start, &opt.count) != 2) || (opt.start < 0) || (opt.count <= 0)) {
+                std::cerr << "--range " << v << ": expected start:count" << std::endl;
+                return -1;
+            }
+            opt.shard_n = 0;
+            opt.is_on = true;
+        }
+    }
+    argc = n;
+    argv[argc] = NULL;
+    return 0;
+}
+
+int shard_resolve (shard_opt& opt, const int loop_num) {
+    if (opt.shard_n > 0) {
+        int chunk = (loop_num + opt.shard_n - 1) / opt.shard_n;
+        chunk = (chunk + SHARD_ALIGN_IMG - 1) / SHARD_ALIGN_IMG * SHARD_ALIGN_IMG;
+        opt.start = std::min(opt.shard_i * chunk, loop_num);
+        opt.count = std::min(chunk, loop_num - opt.start);
+    } else if (opt.start + opt.count > loop_num) {
+        std::cerr << "--range " << opt.start << ":" << opt.count << " is outside the " << loop_num << " images" << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+uint64_t shard_run_id (const shard_opt& opt, const int seed, const int loop_num) {
+    const uint64_t word[2] = {(uint64_t)(uint32_t)seed, (uint64_t)(uint32_t)loop_num};
+    uint64_t hash = fnv1a_64w(FNV_OFFSET, word, 2);
+    for (size_t i = 0; i < opt.run.size(); i++) {
+        hash ^= (uint8_t)opt.run[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+int shard_store_open (shard_store& st, const std::string& path, const int img_num, const uint64_t param_hash, const uint64_t run_id) {
+    st.map_byte = SHARD_HDR_BYTE + (size_t)img_num * sizeof(shard_rec);
+    st.fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    struct stat sb;
+    if ((st.fd < 0) || (fstat(st.fd, &sb) != 0)) {
+        std::cerr << "shard: cannot open " << path << ": " << strerror(errno) << std::endl;
+        if (st.fd >= 0) close(st.fd);
+        return -1;
+    }
+    // every shard sizes the file the same way, whoever comes first
+    if (((sb.st_size == 0) && (ftruncate(st.fd, st.map_byte) != 0)) || ((sb.st_size != 0) && ((size_t)sb.st_size != st.map_byte))) {
+        std::cerr << "shard: " << path << " belongs to a run of another size" << std::endl;
+        close(st.fd);
+        return -1;
+    }
+    void* p = mmap(NULL, st.map_byte, PROT_READ | PROT_WRITE, MAP_SHARED, st.fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "shard: mmap failed: " << strerror(errno) << std::endl;
+        close(st.fd);
+        return -1;
+    }
+    st.hdr = static_cast<shard_hdr*>(p);
+    st.rec = reinterpret_cast<shard_rec*>(static_cast<uint8_t*>(p) + SHARD_HDR_BYTE);
+    if (st.hdr->magic == 0) {
+        // identical from every shard, so concurrent writers agree
+        st.hdr->version    = SHARD_VERSION;
+        st.hdr->img_num    = img_num;
+        st.hdr->rec_byte   = sizeof(shard_rec);
+        st.hdr->param_hash = param_hash;
+        st.hdr->run_id     = run_id;
+        st.hdr->magic      = SHARD_MAGIC;
+    } else if ((st.hdr->magic != SHARD_MAGIC) || (st.hdr->version != SHARD_VERSION) || (st.hdr->img_num != (uint32_t)img_num) ||
+               (st.hdr->rec_byte != sizeof(shard_rec)) || (st.hdr->param_hash != param_hash)) {
+        std::cerr << "shard: " << path << " belongs to another run or model" << std::endl;
+        shard_store_close(st);
+        return -1;
+    } else if (st.hdr->run_id != run_id) {
+        // its records are results of another run, a merge would count them as this one
+        std::cerr << "shard: " << path << " holds records of run " << std::hex << st.hdr->run_id << ", not " << run_id
+                  << std::dec << " (pass the same seed, loop_num and --run to every shard, or remove it)" << std::endl;
+        shard_store_close(st);
+        return -1;
+    }
+    return 0;
+}
+
+void shard_store_put (shard_store& st, const int idx, const int label, const vector<int>& fc3_otfmap, const int shard) {
+    shard_rec& r = st.rec[idx];
+    int otfmap = -128;
+    int result = 10;
+    for (int och = 0; och < NET_CLASS_NUM; och++) {
+        r.logit[och] = fc3_otfmap[och];
+        if (r.logit[och] > otfmap) {   // first maximum, as wr_result
+            otfmap = r.logit[och];
+            result = och;
+        }
+    }
+    r.label = label;
+    r.cls   = result;
+    r.shard = shard;
+    __atomic_store_n(&r.state, 1, __ATOMIC_RELEASE);
+}
+
+void shard_store_close (shard_store& st) {
+    msync(st.hdr, st.map_byte, MS_SYNC);
+    munmap(st.hdr, st.map_byte);
+    close(st.fd);
+}
+
+//===========================================================================
+// launcher
+//===========================================================================
+// cpus of every NUMA node, from sysfs cpulist ("0-3,8-11")
+static vector<vector<int>> numa_node_cpus () {
+    vector<vector<int>> node;
+    for (int k = 0; ; k++) {
+        std::ifstream fp("/sys/devices/system/node/node" + std::to_string(k) + "/cpulist");
+        std::string list;
+        if (!fp.is_open() || !std::getline(fp, list)) break;
+        vector<int> cpu;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            int lo, hi;
+            const int n = sscanf(item.c_str(), "%d-%d", &lo, &hi);
+            if (n == 1) hi = lo;
+            if (n >= 1) for (int c = lo; c <= hi; c++) cpu.push_back(c);
+        }
+        node.push_back(cpu);
+    }
+    return node;
+}
+
+static void pin_to_node (const vector<int>& cpu, const int node) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < cpu.size(); i++) CPU_SET(cpu[i], &set);
+    if (!cpu.empty() && (sched_setaffinity(0, sizeof(set), &set) != 0)) {
+        std::cerr << "launch: cannot pin to node " << node << ": " << strerror(errno) << std::endl;
+    }
+    unsigned long mask[4] = {0, 0, 0, 0};
+    mask[node / 64] |= 1UL << (node % 64);
+    syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, sizeof(mask) * 8);
+}
+
+int run_launch (int argc, char** argv) {
+    backend_opt backend;
+    if (parse_backend_opt(argc, argv, backend) != 0) return -1;
+    if ((argc < 5) || (argc > 7)) {
+        printf("Usage : <executable> launch <proc_num> <srand_val> <loop_num> [cache_entries] [pipe_workers]\n");
+        return -1;
+    }
+    const int proc_num = atoi(argv[2]);
+    if ((proc_num <= 0) || (proc_num > 255)) {
+        std::cerr << "launch: proc_num must be 1 .. 255" << std::endl;
+        return -1;
+    }
+    const vector<vector<int>> node = numa_node_cpus();
+    const int node_num = std::max<int>(1, node.size());
+    remove(FP_SHARD_RESULT);   // a shard that never runs then shows up as missing in the merge
+    // a fresh run token, a shard left over from an earlier launch cannot join this file
+    const std::string run = std::to_string(getpid()) + "." +
+                            std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+
+    const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    vector<pid_t> pid(proc_num, -1);
+    for (int i = 0; i < proc_num; i++) {
+        const std::string shard = std::to_string(i) + "/" + std::to_string(proc_num);
+        const std::string log = FP_SHARD_LOG + std::to_string(i) + ".log";
+        pid[i] = fork();
+        if (pid[i] < 0) {
+            std::cerr << "launch: fork failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (pid[i] == 0) {
+            if (!node.empty()) pin_to_node(node[i % node_num], i % node_num);
+            const int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0) {
+                dup2(fd, STDOUT_FILENO);
+                close(fd);
+            }
+            vector<char*> arg;
+            arg.push_back(argv[0]);
+            for (int k = 3; k < argc; k++) arg.push_back(argv[k]);
+            arg.push_back(const_cast<char*>("--shard"));
+            arg.push_back(const_cast<char*>(shard.c_str()));
+            arg.push_back(const_cast<char*>("--run"));
+            arg.push_back(const_cast<char*>(run.c_str()));
+            const std::string verify = std::to_string(backend.verify_every);
+            if (!backend.name.empty()) {
+                arg.push_back(const_cast<char*>("--backend"));
+                arg.push_back(const_cast<char*>(backend.name.c_str()));
+            }
+            if (backend.verify_every > 0) {
+                arg.push_back(const_cast<char*>("--verify"));
+                arg.push_back(const_cast<char*>(verify.c_str()));
+            }
+            arg.push_back(NULL);
+            execv("/proc/self/exe", arg.data());
+            std::cerr << "launch: exec failed: " << strerror(errno) << std::endl;
+            _exit(127);
+        }
+        cout << "launch: shard " << shard << " pid " << pid[i] << " node " << (i % node_num) << ", log " << log << endl;
+    }
+
+    int fail = 0;
+    for (int i = 0; i < proc_num; i++) {
+        int status = 0;
+        if ((pid[i] <= 0) || (waitpid(pid[i], &status, 0) != pid[i]) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+            std::cerr << "launch: shard " << i << " failed" << std::endl;
+            fail++;
+        }
+    }
+    const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    cout << "launch: " << proc_num - fail << " / " << proc_num << " shards done in " << std::fixed
+         << std::setprecision(3) << wall_s << " s" << endl;
+    cout.unsetf(std::ios::floatfield);
+
+    char* merge_argv[] = {argv[0], const_cast<char*>("merge"), NULL};
+    const int rc = run_merge(2, merge_argv);
+    return (fail == 0) ? rc : -1;
+}
+
+//===========================================================================
+// merge
+//===========================================================================
+int run_merge (int argc, char** argv) {
+    const std::string path = (argc > 2) ? argv[2] : FP_SHARD_RESULT;
+    const int fd = open(path.c_str(), O_RDONLY);
+    struct stat sb;
+    if ((fd < 0) || (fstat(fd, &sb) != 0) || ((size_t)sb.st_size < SHARD_HDR_BYTE)) {
+        std::cerr << "merge: cannot read " << path << std::endl;
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    void* p = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        std::cerr << "merge: mmap failed: " << strerror(errno) << std::endl;
+        return -1;
+    }
+    const shard_hdr* hdr = static_cast<const shard_hdr*>(p);
+    const shard_rec* rec = reinterpret_cast<const shard_rec*>(static_cast<const uint8_t*>(p) + SHARD_HDR_BYTE);
+    if ((hdr->magic != SHARD_MAGIC) || (hdr->version != SHARD_VERSION) || (hdr->rec_byte != sizeof(shard_rec)) ||
+        ((size_t)sb.st_size != SHARD_HDR_BYTE + (size_t)hdr->img_num * sizeof(shard_rec))) {
+        std::cerr << "merge: " << path << " is not a shard results file" << std::endl;
+        munmap(p, sb.st_size);
+        return -1;
+    }
+
+    std::ofstream fp_ot_otfmap (FP_OT_OTFMAP);
+    int done = 0, hit = 0, first_missing = -1;
+    int class_num[NET_CLASS_NUM] = {0}, class_hit[NET_CLASS_NUM] = {0};
+    for (uint32_t i = 0; i < hdr->img_num; i++) {
+        const shard_rec& r = rec[i];
+        if (r.state != 1) {
+            if (first_missing < 0) first_missing = i;
+            continue;
+        }
+        // same line format as wr_result
+        fp_ot_otfmap << "idx: ";
+        fp_ot_otfmap.width(3); fp_ot_otfmap.fill('0');
+        fp_ot_otfmap << dec << i;
+        fp_ot_otfmap << "  result: " << dec << (int)r.cls << std::endl;
+        done++;
+        hit += (r.cls == r.label);
+        if (r.label < NET_CLASS_NUM) {
+            class_num[r.label]++;
+            class_hit[r.label] += (r.cls == r.label);
+        }
+    }
+    fp_ot_otfmap.close();
+
+    cout << "merge: " << done << " / " << hdr->img_num << " images";
+    if (first_missing >= 0) cout << ", " << hdr->img_num - done << " missing (first idx " << first_missing << ")";
+    cout << " -> " << FP_OT_OTFMAP << endl;
+    cout << std::fixed << std::setprecision(2);
+    cout << "accuracy " << ((done == 0) ? 0.0 : 100.0 * hit / done) << " %" << endl;
+    for (int c = 0; c < NET_CLASS_NUM; c++) {
+        cout << "  class " << c << " : " << std::setw(6) << class_hit[c] << " / " << std::setw(6) << class_num[c]
+             << " (" << std::setw(6) << ((class_num[c] == 0) ? 0.0 : 100.0 * class_hit[c] / class_num[c]) << " %)" << endl;
+    }
+    cout.unsetf(std::ios::floatfield);
+    const bool is_complete = (done == (int)hdr->img_num);
+    munmap(p, sb.st_size);
+    return is_complete ? 0 : -1;
+}
@@ -0,0 +1,299 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.21
+// Associated Filename: LeNet5_core_ip_shm.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Shared-memory request ring: engine and client library
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Producer processes hand padded int8 images to the engine through a
+//     POSIX shm segment instead of IDX files or a socket. The client writes
+//     the image straight into a ring slot and the engine runs the network on
+//     that slot and writes the logits back into it, so no image or result is
+//     copied through the kernel. Wakeups use process-shared futexes on the
+//     slot state words.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include <thread>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "LeNet5_core_ip.h"
+
+typedef std::chrono::steady_clock shm_clock;
+
+static uint32_t* futex_word (std::atomic<uint32_t>& word) {
+    return reinterpret_cast<uint32_t*>(&word);
+}
+
+// wait until word == want: spin first, then sleep with wait_flag raised so the
+// other side knows to wake us. false on timeout.
+static bool shm_wait_for (std::atomic<uint32_t>& word, const uint32_t want, std::atomic<uint32_t>& wait_flag,
+                          const int timeout_us, unsigned long& sleep_num) {
+    for (int i = 0; i < SHM_SPIN_NUM; i++) {
+        if (word.load(std::memory_order_acquire) == want) return true;
+        std::this_thread::yield();
+    }
+    const shm_clock::time_point deadline = shm_clock::now() + std::chrono::microseconds(timeout_us);
+    wait_flag.store(1);
+    uint32_t v = word.load();
+    while (v != want) {
+        const long left_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - shm_clock::now()).count();
+        if (left_ns <= 0) break;
+        timespec ts = {left_ns / 1000000000L, left_ns % 1000000000L};
+        sleep_num++;
+        syscall(SYS_futex, futex_word(word), FUTEX_WAIT, v, &ts, NULL, 0);
+        v = word.load();
+    }
+    wait_flag.store(0);
+    return word.load(std::memory_order_acquire) == want;
+}
+
+// store a new state, wake the other side only if it is asleep
+static void shm_post (std::atomic<uint32_t>& word, const uint32_t state, std::atomic<uint32_t>& wait_flag) {
+    word.store(state);
+    if (wait_flag.load()) syscall(SYS_futex, futex_word(word), FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static size_t shm_ring_byte (const uint32_t slot_num) {
+    return sizeof(shm_ring_hdr) + slot_num * sizeof(shm_slot);
+}
+
+//===========================================================================
+// client library
+//===========================================================================
+// a killed client can linger as a zombie that kill(pid, 0) still reports
+static bool pid_is_alive (const pid_t pid) {
+    if ((kill(pid, 0) != 0) && (errno == ESRCH)) return false;
+    std::ifstream fp("/proc/" + std::to_string(pid) + "/stat");
+    std::string comm;
+    char state = 0;
+    pid_t p;
+    fp >> p >> comm >> state;
+    return !fp || (state != 'Z');
+}
+
+int shm_client_open (shm_client& c, const char* name) {
+    c.fd = shm_open(name, O_RDWR, 0);
+    if (c.fd < 0) {
+        std::cerr << "shm: cannot open " << name << ": " << strerror(errno) << std::endl;
+        return -1;
+    }
+    struct stat sb;
+    if ((fstat(c.fd, &sb) != 0) || ((size_t)sb.st_size < sizeof(shm_ring_hdr))) {
+        std::cerr << "shm: " << name << " is not initialized" << std::endl;
+        close(c.fd);
+        return -1;
+    }
+    c.map_byte = sb.st_size;
+    void* p = mmap(NULL, c.map_byte, PROT_READ | PROT_WRITE, MAP_SHARED, c.fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "shm: mmap failed: " << strerror(errno) << std::endl;
+        close(c.fd);
+        return -1;
+    }
+    c.hdr  = static_cast<shm_ring_hdr*>(p);
+    c.slot = reinterpret_cast<shm_slot*>(static_cast<uint8_t*>(p) + sizeof(shm_ring_hdr));
+    c.sleep_num = 0;
+    if ((__atomic_load_n(&c.hdr->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC) || (c.hdr->version != SHM_VERSION) ||
+        (c.hdr->slot_byte != sizeof(shm_slot)) || (shm_ring_byte(c.hdr->slot_num) != c.map_byte)) {
+        std::cerr << "shm: " << name << " has no compatible ring (engine not ready?)" << std::endl;
+        munmap(p, c.map_byte);
+        close(c.fd);
+        return -1;
+    }
+    c.mask = c.hdr->slot_num - 1;
+
+    // one client at a time; take over from a client that died
+    uint32_t prev = 0;
+    const uint32_t self = getpid();
+    while (!c.hdr->client_pid.compare_exchange_strong(prev, self)) {
+        if (pid_is_alive(prev)) {
+            std::cerr << "shm: " << name << " is in use by pid " << prev << std::endl;
+            munmap(p, c.map_byte);
+            close(c.fd);
+            return -1;
+        }
+    }
+
+    // results an earlier client left behind. it may have died between a
+    // slot state store and the cursor update, on either side.
+    while ((shm_client_pending(c) < (int)c.hdr->slot_num) && (c.slot[c.hdr->submit_pos & c.mask].state != SHM_SLOT_FREE)) {
+        c.hdr->submit_pos++;
+    }
+    int stale = 0;
+    shm_result r;
+    while (shm_client_pending(c) > 0) {
+        if (c.slot[c.hdr->reap_pos & c.mask].state == SHM_SLOT_FREE) {
+            c.hdr->reap_pos++;
+            continue;
+        }
+        if (!shm_client_reap(c, r, 1000000)) {
+            std::cerr << "shm: engine does not answer" << std::endl;
+            shm_client_close(c);
+            return -1;
+        }
+        stale++;
+    }
+    if (stale > 0) cout << "shm: dropped " << stale << " results of an earlier client" << endl;
+    return 0;
+}
+
+int8_t* shm_client_slot (shm_client& c) {
+    shm_slot& s = c.slot[c.hdr->submit_pos & c.mask];
+    return (s.state.load(std::memory_order_acquire) == SHM_SLOT_FREE) ? s.img : NULL;
+}
+
+void shm_client_submit (shm_client& c, const uint32_t id) {
+    shm_slot& s = c.slot[c.hdr->submit_pos & c.mask];
+    s.id = id;
+    shm_post(s.state, SHM_SLOT_READY, c.hdr->engine_wait);
+    c.hdr->submit_pos++;
+}
+
+bool shm_client_reap (shm_client& c, shm_result& r, const int timeout_us) {
+    if (shm_client_pending(c) == 0) return false;
+    shm_slot& s = c.slot[c.hdr->reap_pos & c.mask];
+    if (!shm_wait_for(s.state, SHM_SLOT_DONE, c.hdr->client_wait, timeout_us, c.sleep_num)) return false;
+    r.id  = s.id;
+    r.cls = s.cls;
+    std::copy(s.logit, s.logit + NET_CLASS_NUM, r.logit);
+    s.state.store(SHM_SLOT_FREE, std::memory_order_release);
+    c.hdr->reap_pos++;
+    return true;
+}
+
+int shm_client_pending (const shm_client& c) {
+    return c.hdr->submit_pos - c.hdr->reap_pos;
+}
+
+void shm_client_close (shm_client& c) {
+    c.hdr->client_pid.store(0);
+    munmap(c.hdr, c.map_byte);
+    close(c.fd);
+}
+
+//===========================================================================
+// engine
+//===========================================================================
+static volatile sig_atomic_t shm_is_stop = 0;
+
+static void shm_on_signal (int) {
+    shm_is_stop = 1;
+}
+
+// pid of the engine serving name, 0 when there is none or it died
+static pid_t shm_live_engine (const char* name) {
+    const int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return 0;
+    pid_t pid = 0;
+    struct stat sb;
+    if ((fstat(fd, &sb) == 0) && ((size_t)sb.st_size >= sizeof(shm_ring_hdr))) {
+        void* p = mmap(NULL, sizeof(shm_ring_hdr), PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            const shm_ring_hdr* hdr = static_cast<const shm_ring_hdr*>(p);
+            if ((__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) == SHM_MAGIC) && (hdr->version == SHM_VERSION) &&
+                (hdr->engine_pid != 0) && pid_is_alive(hdr->engine_pid)) {
+                pid = hdr->engine_pid;
+            }
+            munmap(p, sizeof(shm_ring_hdr));
+        }
+    }
+    close(fd);
+    return pid;
+}
+
+int run_shm_serve (int argc, char** argv, const lenet5_net& net) {
+    if (argc < 3) {
+        printf("Usage : <executable> shmserve <shm_name> [slot_num]\n");
+        return -1;
+    }
+    const char* name = argv[2];
+    const uint32_t slot_num = (argc > 3) ? atoi(argv[3]) : SHM_SLOT_NUM;
+    if ((slot_num == 0) || ((slot_num & (slot_num - 1)) != 0)) {
+        std::cerr << "shmserve: slot_num must be a power of two" << std::endl;
+        return -1;
+    }
+
+    // a segment left by an engine that died is replaced, a live one is not
+    const pid_t engine = shm_live_engine(name);
+    if (engine != 0) {
+        std::cerr << "shmserve: " << name << " is served by pid " << engine << std::endl;
+        return -1;
+    }
+    shm_unlink(name);
+    const int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    const size_t map_byte = shm_ring_byte(slot_num);
+    if ((fd < 0) || (ftruncate(fd, map_byte) != 0)) {
+        std::cerr << "shmserve: cannot create " << name << ": " << strerror(errno) << std::endl;
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    void* p = mmap(NULL, map_byte, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "shmserve: mmap failed: " << strerror(errno) << std::endl;
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    shm_ring_hdr* hdr = new (p) shm_ring_hdr();
+    shm_slot* slot = reinterpret_cast<shm_slot*>(static_cast<uint8_t*>(p) + sizeof(shm_ring_hdr));
+    for (uint32_t i = 0; i < slot_num; i++) new (&slot[i]) shm_slot();
+    hdr->version    = SHM_VERSION;
+    hdr->slot_num   = slot_num;
+    hdr->slot_byte  = sizeof(shm_slot);
+    hdr->param_hash = net.model.param_hash;
+    hdr->engine_pid = getpid();
+    __atomic_store_n(&hdr->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+    signal(SIGINT, shm_on_signal);
+    signal(SIGTERM, shm_on_signal);
+    cout << "shmserve: " << name << ", " << slot_num << " slots x " << sizeof(shm_slot) << " B" << endl;
+
+    const uint32_t mask = slot_num - 1;
+    uint32_t head = 0;
+    unsigned long request_num = 0, sleep_num = 0, reject_num = 0;
+    double busy_s = 0;
+    const shm_clock::time_point t0 = shm_clock::now();
+    while (!shm_is_stop) {
+        shm_slot& s = slot[head & mask];
+        if (!shm_wait_for(s.state, SHM_SLOT_READY, hdr->engine_wait, SHM_POLL_US, sleep_num)) continue;
+        const shm_clock::time_point t = shm_clock::now();
+        if (net_img_ok(net, s.img)) {
+            s.cls = net_run_from(net, 0, s.img, NULL, s.logit, NULL);
+        } else {
+            // outside the conv1 range the int16 runs are planned for
+            s.cls = NET_CLS_REJECT;
+            memset(s.logit, 0, sizeof(s.logit));
+            reject_num++;
+        }
+        busy_s += std::chrono::duration<double>(shm_clock::now() - t).count();
+        shm_post(s.state, SHM_SLOT_DONE, hdr->client_wait);
+        head++;
+        request_num++;
+    }
+    const double wall_s = std::chrono::duration<double>(shm_clock::now() - t0).count();
+
+    __atomic_store_n(&hdr->magic, 0, __ATOMIC_RELEASE);
+    munmap(p, map_byte);
+    close(fd);
+    shm_unlink(name);
+
+    cout << "shmserve: " << request_num << " requests, busy " << std::fixed << std::setprecision(1)
+         << ((wall_s == 0) ? 0.0 : 100.0 * busy_s / wall_s) << "% of " << std::setprecision(3) << wall_s
+         << " s, futex sleeps " << sleep_num << ", rejected images " << reject_num << endl;
+    return 0;
+}
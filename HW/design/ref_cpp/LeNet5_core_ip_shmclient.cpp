@@ -0,0 +1,82 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.21
+// Associated Filename: LeNet5_core_ip_shmclient.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Example producer for the shared-memory request ring
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Preprocesses MNIST test images directly into ring slots, keeps up to
+//     window requests in flight and reports throughput, latency from submit
+//     to result, and accuracy.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include "LeNet5_core_ip.h"
+
+typedef std::chrono::steady_clock shmc_clock;
+
+int run_shm_client (int argc, char** argv) {
+    if (argc < 4) {
+        printf("Usage : <executable> shmclient <shm_name> <request_num> [window]\n");
+        return -1;
+    }
+    const int req_num = atoi(argv[3]);
+    if (req_num <= 0) {
+        std::cerr << "shmclient: request_num must be positive" << std::endl;
+        return -1;
+    }
+    vector<uint8_t> pixel, label;
+    const int img_num = rd_idx_set(req_num, pixel, label);
+    if (img_num == 0) return -1;
+
+    shm_client c;
+    if (shm_client_open(c, argv[2]) != 0) return -1;
+    const int window = std::min<int>((argc > 4) ? std::max(1, atoi(argv[4])) : c.hdr->slot_num, c.hdr->slot_num);
+
+    vector<shmc_clock::time_point> t_submit(req_num);
+    vector<double> latency_us(req_num, -1);
+    unsigned long hit = 0;
+    int submit = 0, reap = 0;
+    const shmc_clock::time_point t0 = shmc_clock::now();
+    while (reap < req_num) {
+        int8_t* img;
+        if ((submit < req_num) && (shm_client_pending(c) < window) && ((img = shm_client_slot(c)) != NULL)) {
+            t_submit[submit] = shmc_clock::now();
+            pad_image(&pixel[(submit % img_num) * 28 * 28], img);
+            shm_client_submit(c, submit);
+            submit++;
+            continue;
+        }
+        shm_result r;
+        if (!shm_client_reap(c, r, 1000000) || (r.id >= (uint32_t)req_num)) {
+            std::cerr << "shmclient: engine does not answer" << std::endl;
+            break;
+        }
+        latency_us[r.id] = std::chrono::duration<double, std::micro>(shmc_clock::now() - t_submit[r.id]).count();
+        hit += (r.cls == label[r.id % img_num]);
+        reap++;
+    }
+    const double wall_s = std::chrono::duration<double>(shmc_clock::now() - t0).count();
+    const unsigned long sleep_num = c.sleep_num;
+    shm_client_close(c);
+    if (reap == 0) return -1;
+
+    vector<double> lat;
+    for (int i = 0; i < req_num; i++) if (latency_us[i] >= 0) lat.push_back(latency_us[i]);
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&](const double q) { return lat[std::min<size_t>(lat.size() - 1, q * lat.size())]; };
+
+    cout << std::fixed << std::setprecision(3);
+    cout << "shmclient: " << reap << " / " << req_num << " results in " << wall_s << " s ("
+         << std::setprecision(1) << reap / wall_s << " req/s), window " << window
+         << ", futex sleeps " << sleep_num << endl;
+    cout << "latency (us): p50 " << pct(0.50) << ", p90 " << pct(0.90) << ", p99 " << pct(0.99)
+         << ", max " << lat.back() << endl;
+    cout << "accuracy " << std::setprecision(2) << 100.0 * hit / reap << " %" << endl;
+    return (reap == req_num) ? 0 : -1;
+}
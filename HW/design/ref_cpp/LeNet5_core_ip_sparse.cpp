@@ -0,0 +1,171 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+// 
+// Create Date: 2025.06.15
+// Associated Filename: LeNet5_core_ip_sparse.cpp
+// Project Name: CNN_FPGA
+// Tool Versions: 
+// Purpose: Sparse-input conv / fc kernels
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Inputs after ReLU + max pooling are often exactly 0. The sparse kernels
+//     compact the non-zero inputs into an index list and accumulate only the
+//     matching weights. A zero input adds 0 to the int32 accumulator, so the
+//     result is bit-exact with conv_layer / fc_layer.
+//     Both kernels read the prepacked weights of LeNet5_core_ip_pack.cpp.
+// 
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "LeNet5_core_ip.h"
+
+// input scatter: every non-zero input adds its KY x KX window to each och.
+// acc is [oy][ox][och] so one weight row of the packed block updates
+// PACK_OCH_BLK adjacent accumulators.
+void conv_layer_sparse(
+    const vector<vector<vector<int>>>& infmap,
+    const packed_conv& pw,
+    vector<vector<vector<int>>>& otfmap,
+    const int OY_ ,
+    const int OX_ ,
+    const int M_INV
+) {
+    const int IY_ = OY_ + pw.KY - 1;
+    const int IX_ = OX_ + pw.KX - 1;
+    const int OCH_PAD = pw.BLK_NUM * PACK_OCH_BLK;
+    const int BLK_STRIDE = pw.ICH * pw.KY * pw.KX * PACK_OCH_BLK;
+    vector<int32_t> acc(OY_ * OX_ * OCH_PAD);
+    for (int i = 0; i < OY_ * OX_; i++) {
+        std::copy(pw.bias.begin(), pw.bias.end(), acc.begin() + i * OCH_PAD);
+    }
+    
+    for (int ich = 0; ich < pw.ICH; ich++) {
+        for (int iy = 0; iy < IY_; iy++) {
+            for (int ix = 0; ix < IX_; ix++) {
+                int32_t in_val = infmap[ich][iy][ix];
+                if (in_val == 0) continue;
+                // outputs (oy, ox) = (iy - ky, ix - kx) inside the output map
+                int ky_lo = std::max(0, iy - (OY_ - 1)), ky_hi = std::min(pw.KY - 1, iy);
+                int kx_lo = std::max(0, ix - (OX_ - 1)), kx_hi = std::min(pw.KX - 1, ix);
+                for (int ky = ky_lo; ky <= ky_hi; ky++) {
+                    for (int kx = kx_lo; kx <= kx_hi; kx++) {
+                        int32_t* acc_px = &acc[((iy - ky) * OX_ + (ix - kx)) * OCH_PAD];
+                        const int16_t* w = &pw.weight[((ich * pw.KY + ky) * pw.KX + kx) * PACK_OCH_BLK];
+                        for (int blk = 0; blk < pw.BLK_NUM; blk++, w += BLK_STRIDE, acc_px += PACK_OCH_BLK) {
+                            for (int lane = 0; lane < PACK_OCH_BLK; lane++) {
+                                acc_px[lane] += in_val * w[lane];
+                            }
+                        }
+                    }
+                }
+    } } }
+    
+    for (int och = 0; och < pw.OCH; och++) {
+        for (int oy = 0; oy < OY_; oy++) {
+            for (int ox = 0; ox < OX_; ox++) {
+                otfmap[och][oy][ox] = requant_acc(acc[(oy * OX_ + ox) * OCH_PAD + och], M_INV, true);
+    } } }
+}
+
+void fc_layer_sparse (
+    const vector<int>& infmap,
+    const packed_fc& pw,
+    vector<int>& otfmap,
+    const int M_INV ,
+    const bool relu
+) {
+    vector<int> nz_idx;
+    vector<int> nz_val;
+    nz_idx.reserve(pw.ICH);
+    nz_val.reserve(pw.ICH);
+    for (int ich = 0; ich < pw.ICH; ich++) {
+        if (infmap[ich] != 0) {
+            nz_idx.push_back(ich);
+            nz_val.push_back(infmap[ich]);
+        }
+    }
+    const int nz_num = nz_idx.size();
+    const int BLK_STRIDE = pw.ICH_PAIR * PACK_OCH_BLK * 2;
+    
+    vector<int32_t> acc(pw.bias.begin(), pw.bias.end());
+    for (int i = 0; i < nz_num; i++) {
+        const int32_t in_val = nz_val[i];
+        // lane l of pair ich / 2 sits at [2 * l + ich % 2]
+        const int16_t* w = &pw.weight[(nz_idx[i] / 2) * PACK_OCH_BLK * 2 + (nz_idx[i] % 2)];
+        for (int blk = 0; blk < pw.BLK_NUM; blk++, w += BLK_STRIDE) {
+            int32_t* acc_blk = &acc[blk * PACK_OCH_BLK];
+            for (int lane = 0; lane < PACK_OCH_BLK; lane++) {
+                acc_blk[lane] += in_val * w[2 * lane];
+            }
+        }
+    }
+    for (int och = 0; och < pw.OCH; och++) {
+        otfmap[och] = requant_acc(acc[och], M_INV, relu);
+    }
+}
+
+// dense or sparse per call, from the input density of this image
+void conv_layer_auto(
+    const vector<vector<vector<int>>>& infmap,
+    const packed_conv& pw,
+    vector<vector<vector<int>>>& otfmap,
+    const int OY_ ,
+    const int OX_ ,
+    const int M_INV ,
+    layer_density& stat
+) {
+    unsigned long nz = 0, total = 0;
+    for (int ich = 0; ich < pw.ICH; ich++) {
+        for (size_t iy = 0; iy < infmap[ich].size(); iy++) {
+            for (size_t ix = 0; ix < infmap[ich][iy].size(); ix++) {
+                nz += (infmap[ich][iy][ix] != 0);
+            }
+            total += infmap[ich][iy].size();
+    } }
+    stat.nz += nz;
+    stat.total += total;
+    if (nz < SPARSE_DENSITY_TH * total) {
+        stat.sparse_num++;
+        conv_layer_sparse(infmap, pw, otfmap, OY_, OX_, M_INV);
+    } else {
+        stat.dense_num++;
+        conv_layer_packed(infmap, pw, otfmap, OX_, M_INV, 0, pw.BLK_NUM, 0, OY_);
+    }
+}
+
+void fc_layer_auto (
+    const vector<int>& infmap,
+    const packed_fc& pw,
+    vector<int>& otfmap,
+    const int M_INV ,
+    const bool relu ,
+    layer_density& stat
+) {
+    unsigned long nz = 0;
+    for (int ich = 0; ich < pw.ICH; ich++) {
+        nz += (infmap[ich] != 0);
+    }
+    stat.nz += nz;
+    stat.total += pw.ICH;
+    if (nz < SPARSE_DENSITY_TH * pw.ICH) {
+        stat.sparse_num++;
+        fc_layer_sparse(infmap, pw, otfmap, M_INV, relu);
+    } else {
+        stat.dense_num++;
+        fc_layer_packed(infmap, pw, otfmap, M_INV, relu, 0, pw.BLK_NUM);
+    }
+}
+
+void density_report (const vector<layer_density>& stats) {
+    std::ios state(NULL);
+    state.copyfmt(cout);
+    cout << "input density per layer (sparse kernel below " << SPARSE_DENSITY_TH * 100 << "%)" << endl;
+    for (size_t i = 0; i < stats.size(); i++) {
+        const layer_density& s = stats[i];
+        double density = (s.total == 0) ? 0.0 : 100.0 * s.nz / s.total;
+        cout << "  " << std::left << std::setw(6) << s.name << std::right
+             << " density " << std::fixed << std::setprecision(1) << std::setw(5) << density << "%"
+             << ", sparse " << s.sparse_num << " / dense " << s.dense_num << endl;
+    }
+    cout.copyfmt(state);
+}
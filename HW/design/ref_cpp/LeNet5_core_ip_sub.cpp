@@ -64,6 +64,17 @@ void read_mnist_labels(
     label = static_cast<int>(label_byte);
 }
 
+int quantize_pixel (const unsigned char pixel) {
+    // Normalize: (pixel / 255 - mean) / std
+    float normalized = (static_cast<float>(pixel) / 255.0f - 0.1307f) / 0.3081f;
+
+    // Scale and quantize: multiply by 32 and round
+    int quantized = static_cast<int>(std::round(normalized * 32.0f));
+
+    // Clip to [-128, 127]
+    return std::max(-128, std::min(127, quantized));
+}
+
 void read_mnist_images(std::ifstream& fp_in_infmap, 
                        vector<vector<vector<int>>>& infmap, 
                        vector<vector<vector<int8_t>>>& infmap_qnt,
@@ -120,9 +131,7 @@ void read_mnist_images(std::ifstream& fp_in_infmap,
     infmap_qnt.clear();
 
     // Calculate the padding value: normalized and scaled 0
-    float normalized_pad = (0.0f - 0.1307f) / 0.3081f;
-    int pad_value = static_cast<int>(std::round(normalized_pad * 32.0f));
-    pad_value = std::max(-128, std::min(127, pad_value));
+    int pad_value = quantize_pixel(0);
 
     // Initialize 32x32 image with padding (single channel) using pad_value
     vector<vector<int>> image(32, vector<int>(32, pad_value));
@@ -134,14 +143,7 @@ void read_mnist_images(std::ifstream& fp_in_infmap,
             unsigned char pixel;
             fp_in_infmap.read(reinterpret_cast<char*>(&pixel), 1);
 
-            // Normalize: (pixel / 255 - mean) / std
-            float normalized = (static_cast<float>(pixel) / 255.0f - 0.1307f) / 0.3081f;
-
-            // Scale and quantize: multiply by 32 and round
-            int quantized = static_cast<int>(std::round(normalized * 32.0f));
-
-            // Clip to [-128, 127]
-            quantized = std::max(-128, std::min(127, quantized));
+            int quantized = quantize_pixel(pixel);
 
             // Store in padded region [2:30][2:30]
             image[y + 2][x + 2] = quantized;
@@ -736,14 +738,7 @@ void wr_result (
     fp_ot_otfmap.width(3); fp_ot_otfmap.fill('0');
     fp_ot_otfmap << dec << loop ;
     
-    int otfmap = -128;
-    int result = 10;
-    for(int och = 0; och < OCH_; och++){
-        if(otfmap_qnt[och] > otfmap) {
-            otfmap = otfmap_qnt[och];
-            result = och;
-        }
-    } 
+    const int result = result_class(otfmap_qnt, OCH_);
     cout << "  result: " << dec << result << std::endl;
     fp_ot_otfmap << "  result: " << dec << result << std::endl;
 }
\ No newline at end of file
@@ -0,0 +1,373 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.18
+// Associated Filename: LeNet5_core_ip_sweep.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Quantization-scale sweep over cached layer checkpoints
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Weights and biases are fixed by the parameter files, so the free knob
+//     of a layer is its output scale IN_O_INV, which is also the input scale
+//     IN_I_INV of the next layer. A candidate that first differs from the
+//     base scales at layer k reproduces the base activations up to layer k,
+//     so it starts from the int8 checkpoint stored at that boundary.
+//     The checkpoint store is an mmap'd file written once per parameter set
+//     and base scales, and reused by later sweeps.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "LeNet5_core_ip.h"
+
+struct ckpt_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t image_num;
+    uint32_t reserved;
+    uint64_t param_hash;
+    int32_t  scale[NET_LAYER_NUM][4];
+    uint64_t src_byte[2];   // IDX image / label file size / mtime
+    int64_t  src_mtime[2];
+};
+
+struct ckpt_store {
+    uint8_t*     base;
+    size_t       byte;
+    ckpt_header* hdr;
+    uint8_t*     label;
+    int8_t*      act[NET_LAYER_NUM];
+};
+
+// a sweep candidate: scales and the packed model with its biases re-shifted
+struct sweep_cand {
+    lenet5_net net;
+    int        first;  // first layer that differs from the base scales
+};
+
+static bool is_pow2 (const int v) {
+    return (v > 0) && ((v & (v - 1)) == 0);
+}
+
+// M_INV and B_SCALE have to be integer powers of two for the shift datapath
+static bool scale_valid (const layer_scale& s) {
+    const int IW = s.IN_I_INV * s.IN_W_INV;
+    return (IW % s.IN_O_INV == 0) && is_pow2(IW / s.IN_O_INV)
+        && (s.IN_B_INV % IW == 0) && is_pow2(s.IN_B_INV / IW);
+}
+
+static int b_shift_of (const layer_scale& s) {
+    return log2(s.IN_B_INV / (s.IN_I_INV * s.IN_W_INV));
+}
+
+static bool scale_same (const layer_scale& a, const layer_scale& b) {
+    return (a.IN_I_INV == b.IN_I_INV) && (a.IN_W_INV == b.IN_W_INV)
+        && (a.IN_B_INV == b.IN_B_INV) && (a.IN_O_INV == b.IN_O_INV);
+}
+
+static void rebias (vector<int32_t>& bias, const int base_shift, const int new_shift) {
+    for (size_t i = 0; i < bias.size(); i++) {
+        bias[i] = (bias[i] >> base_shift) << new_shift;  // exact: the base bias is an int16 << base_shift
+    }
+}
+
+//===========================================================================
+// checkpoint store
+//===========================================================================
+static size_t ckpt_layout (ckpt_store& st, uint8_t* base, const int image_num) {
+    size_t ofs = (sizeof(ckpt_header) + 63) & ~size_t(63);
+    st.base  = base;
+    st.hdr   = reinterpret_cast<ckpt_header*>(base);
+    st.label = base + ofs;
+    ofs = (ofs + image_num + 63) & ~size_t(63);
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        st.act[k] = reinterpret_cast<int8_t*>(base + ofs);
+        ofs = (ofs + (size_t)image_num * layer_in_byte[k] + 63) & ~size_t(63);
+    }
+    return ofs;
+}
+
+// the dataset the store is built from, same rule as the image cache of 'prep'
+static bool ckpt_src_stat (uint64_t* src_byte, int64_t* src_mtime) {
+    const char* path[2] = {FP_IN_INFMAP_BIN, FP_IN_LABEL_BIN};
+    for (int i = 0; i < 2; i++) {
+        struct stat sb;
+        if (stat(path[i], &sb) != 0) return false;
+        src_byte[i]  = sb.st_size;
+        src_mtime[i] = sb.st_mtime;
+    }
+    return true;
+}
+
+static bool ckpt_match (const ckpt_header& hdr, const int image_num, const uint64_t param_hash, const layer_scale* base) {
+    if ((hdr.magic != CKPT_MAGIC) || (hdr.version != CKPT_VERSION) ||
+        (hdr.image_num != (uint32_t)image_num) || (hdr.param_hash != param_hash)) {
+        return false;
+    }
+    uint64_t src_byte[2];
+    int64_t  src_mtime[2];
+    if (!ckpt_src_stat(src_byte, src_mtime)) return false;
+    for (int i = 0; i < 2; i++) {
+        if ((hdr.src_byte[i] != src_byte[i]) || (hdr.src_mtime[i] != src_mtime[i])) return false;
+    }
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        const int32_t s[4] = {base[k].IN_I_INV, base[k].IN_W_INV, base[k].IN_B_INV, base[k].IN_O_INV};
+        if (memcmp(hdr.scale[k], s, sizeof(s)) != 0) return false;
+    }
+    return true;
+}
+
+// maps the store; is_valid is false when it has to be (re)built
+static bool ckpt_open (ckpt_store& st, const int image_num, const uint64_t param_hash, const layer_scale* base, bool& is_valid) {
+    ckpt_store probe;
+    const size_t byte = ckpt_layout(probe, NULL, image_num);
+
+    int fd = open(FP_SWEEP_CKPT, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        std::cerr << "Error opening " << FP_SWEEP_CKPT << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, byte) != 0) {
+        std::cerr << "Error sizing " << FP_SWEEP_CKPT << std::endl;
+        close(fd);
+        return false;
+    }
+    void* base_ptr = mmap(NULL, byte, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base_ptr == MAP_FAILED) {
+        std::cerr << "Error mapping " << FP_SWEEP_CKPT << std::endl;
+        return false;
+    }
+    ckpt_layout(st, static_cast<uint8_t*>(base_ptr), image_num);
+    st.byte = byte;
+    is_valid = ckpt_match(*st.hdr, image_num, param_hash, base);
+    return true;
+}
+
+// parallel over image blocks: work items are claimed from one atomic counter
+template <typename F>
+static void parallel_for (const int item_num, const int thread_num, F fn) {
+    std::atomic<int> next(0);
+    vector<std::thread> team;
+    for (int t = 0; t < thread_num; t++) {
+        team.emplace_back([&]() {
+            for (int i = next++; i < item_num; i = next++) fn(i);
+        });
+    }
+    for (size_t t = 0; t < team.size(); t++) team[t].join();
+}
+
+static void ckpt_build (
+    ckpt_store& st,
+    const lenet5_net& base_net,
+    const int image_num,
+    const int thread_num,
+    std::ifstream& fp_in_infmap,
+    std::ifstream& fp_in_label,
+    const img_cache* ic
+) {
+    st.hdr->magic = 0;  // invalid until the store is complete
+    for (int i = 0; i < image_num; i++) {
+        if ((ic != NULL) && (i < ic->img_num)) {
+            memcpy(st.act[0] + i * layer_in_byte[0], ic->img + (size_t)i * 32 * 32, 32 * 32);
+            st.label[i] = ic->label[i];
+            continue;
+        }
+        vector<vector<vector<int>>>    infmap;
+        vector<vector<vector<int8_t>>> infmap_qnt;
+        int label;
+        read_mnist_images(fp_in_infmap, infmap, infmap_qnt, i + 1);
+        read_mnist_labels(fp_in_label, label, i + 1);
+        for (int y = 0; y < 32; y++) memcpy(st.act[0] + i * layer_in_byte[0] + y * 32, infmap_qnt[0][y].data(), 32);
+        st.label[i] = label;
+    }
+
+    const int blk_num = (image_num + SWEEP_BLK_IMG - 1) / SWEEP_BLK_IMG;
+    parallel_for(blk_num, thread_num, [&](const int blk) {
+        for (int i = blk * SWEEP_BLK_IMG; i < std::min(image_num, (blk + 1) * SWEEP_BLK_IMG); i++) {
+            int8_t* ckpt[NET_LAYER_NUM];
+            for (int k = 0; k < NET_LAYER_NUM; k++) ckpt[k] = st.act[k] + (size_t)i * layer_in_byte[k];
+            net_run_from(base_net, 0, ckpt[0], ckpt, NULL, NULL);
+        }
+    });
+
+    ckpt_header& hdr = *st.hdr;
+    hdr.version    = CKPT_VERSION;
+    hdr.image_num  = image_num;
+    hdr.reserved   = 0;
+    hdr.param_hash = base_net.model.param_hash;
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        hdr.scale[k][0] = base_net.scale[k].IN_I_INV;
+        hdr.scale[k][1] = base_net.scale[k].IN_W_INV;
+        hdr.scale[k][2] = base_net.scale[k].IN_B_INV;
+        hdr.scale[k][3] = base_net.scale[k].IN_O_INV;
+    }
+    if (!ckpt_src_stat(hdr.src_byte, hdr.src_mtime)) {
+        memset(hdr.src_byte, 0, sizeof(hdr.src_byte));  // never matches, rebuilt next time
+    }
+    msync(st.base, st.byte, MS_SYNC);
+    hdr.magic = CKPT_MAGIC;
+    msync(st.base, 64, MS_SYNC);
+}
+
+//===========================================================================
+// sweep
+//===========================================================================
+// <layer>=<o_inv>[,<o_inv>...]
+static bool parse_grid (const char* arg, int& layer, vector<int>& o_inv) {
+    std::string s(arg);
+    size_t eq = s.find('=');
+    if (eq == std::string::npos) return false;
+    layer = -1;
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        if (s.substr(0, eq) == layer_name[k]) layer = k;
+    }
+    if (layer < 0) return false;
+    std::stringstream ss(s.substr(eq + 1));
+    std::string v;
+    while (std::getline(ss, v, ',')) {
+        int o = atoi(v.c_str());
+        if (o <= 0) return false;
+        o_inv.push_back(o);
+    }
+    return !o_inv.empty();
+}
+
+int run_sweep (
+    int argc,
+    char** argv,
+    const packed_model& model,
+    const layer_scale* base,
+    std::ifstream& fp_in_infmap,
+    std::ifstream& fp_in_label,
+    const img_cache* ic,
+    const std::shared_ptr<backend_plan>& plan
+) {
+    const int image_num  = atoi(argv[2]);
+    const int thread_num = std::max(1, atoi(argv[3]));
+    vector<int> grid_layer;
+    vector<vector<int>> grid_o_inv;
+    for (int a = 4; a < argc; a++) {
+        int layer;
+        vector<int> o_inv;
+        if (!parse_grid(argv[a], layer, o_inv)) {
+            std::cerr << "sweep: bad grid \"" << argv[a] << "\", expected <conv1|conv2|fc1|fc2|fc3>=<o_inv>[,<o_inv>...]" << std::endl;
+            return -1;
+        }
+        grid_layer.push_back(layer);
+        grid_o_inv.push_back(o_inv);
+    }
+    if ((image_num <= 0) || grid_layer.empty()) {
+        std::cerr << "sweep: nothing to do" << std::endl;
+        return -1;
+    }
+
+    lenet5_net base_net;
+    net_init(base_net, model, base);
+    base_net.plan = plan;
+
+    auto t0 = std::chrono::steady_clock::now();
+    ckpt_store st;
+    bool is_valid = false;
+    if (!ckpt_open(st, image_num, model.param_hash, base, is_valid)) {
+        return -1;
+    }
+    if (!is_valid) {
+        ckpt_build(st, base_net, image_num, thread_num, fp_in_infmap, fp_in_label, ic);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    cout << "checkpoints: " << FP_SWEEP_CKPT << (is_valid ? " reused" : " built") << ", "
+         << std::fixed << std::setprecision(2) << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+
+    // cartesian product of the grids, the base scales first
+    vector<vector<layer_scale>> grid(1, vector<layer_scale>(base, base + NET_LAYER_NUM));
+    for (size_t g = 0; g < grid_layer.size(); g++) {
+        vector<vector<layer_scale>> next;
+        for (size_t c = 0; c < grid.size(); c++) {
+            for (size_t v = 0; v < grid_o_inv[g].size(); v++) {
+                vector<layer_scale> scale = grid[c];
+                const int k = grid_layer[g];
+                scale[k].IN_O_INV = grid_o_inv[g][v];
+                if (k + 1 < NET_LAYER_NUM) scale[k + 1].IN_I_INV = grid_o_inv[g][v];
+                next.push_back(scale);
+            }
+        }
+        grid.swap(next);
+    }
+    grid.insert(grid.begin(), vector<layer_scale>(base, base + NET_LAYER_NUM));
+
+    vector<sweep_cand> cand(grid.size());
+    vector<bool> is_ok(cand.size(), true);
+    for (size_t c = 0; c < cand.size(); c++) {
+        lenet5_net& n = cand[c].net;
+        net_init(n, model, grid[c].data());
+        n.plan = plan;
+        cand[c].first = NET_LAYER_NUM - 1;
+        for (int k = NET_LAYER_NUM - 1; k >= 0; k--) {
+            if (!scale_same(n.scale[k], base[k])) cand[c].first = k;
+            is_ok[c] = is_ok[c] && scale_valid(n.scale[k]);
+        }
+        if (!is_ok[c]) continue;
+        rebias(n.model.conv1.bias.own(), b_shift_of(base[0]), b_shift_of(n.scale[0]));
+        rebias(n.model.conv2.bias.own(), b_shift_of(base[1]), b_shift_of(n.scale[1]));
+        rebias(n.model.fc1.bias.own(),   b_shift_of(base[2]), b_shift_of(n.scale[2]));
+        rebias(n.model.fc2.bias.own(),   b_shift_of(base[3]), b_shift_of(n.scale[3]));
+        rebias(n.model.fc3.bias.own(),   b_shift_of(base[4]), b_shift_of(n.scale[4]));
+        n.model.conv1.src.B_SCALE = 1 << b_shift_of(n.scale[0]);  // the oracle shifts the unpacked bias itself
+        n.model.conv2.src.B_SCALE = 1 << b_shift_of(n.scale[1]);
+        n.model.fc1.src.B_SCALE   = 1 << b_shift_of(n.scale[2]);
+        n.model.fc2.src.B_SCALE   = 1 << b_shift_of(n.scale[3]);
+        n.model.fc3.src.B_SCALE   = 1 << b_shift_of(n.scale[4]);
+        n.model.conv1.B_SHIFT = b_shift_of(n.scale[0]);
+        n.model.conv2.B_SHIFT = b_shift_of(n.scale[1]);
+        n.model.fc1.B_SHIFT   = b_shift_of(n.scale[2]);
+        n.model.fc2.B_SHIFT   = b_shift_of(n.scale[3]);
+        n.model.fc3.B_SHIFT   = b_shift_of(n.scale[4]);
+    }
+
+    // work item: one image block of one candidate
+    const int blk_num = (image_num + SWEEP_BLK_IMG - 1) / SWEEP_BLK_IMG;
+    vector<std::atomic<int>> correct(cand.size());
+    for (size_t c = 0; c < cand.size(); c++) correct[c] = 0;
+    parallel_for(cand.size() * blk_num, thread_num, [&](const int item) {
+        const int c = item / blk_num, blk = item % blk_num;
+        if (!is_ok[c]) return;
+        const int first = cand[c].first;
+        int hit = 0;
+        for (int i = blk * SWEEP_BLK_IMG; i < std::min(image_num, (blk + 1) * SWEEP_BLK_IMG); i++) {
+            hit += (net_run_from(cand[c].net, first, st.act[first] + (size_t)i * layer_in_byte[first], NULL, NULL, NULL) == st.label[i]);
+        }
+        correct[c] += hit;
+    });
+    auto t2 = std::chrono::steady_clock::now();
+
+    cout << "sweep: " << image_num << " images, " << cand.size() - 1 << " candidates, "
+         << thread_num << " threads, " << std::chrono::duration<double>(t2 - t1).count() << " s" << endl;
+    cout << "  ";
+    for (int k = 0; k < NET_LAYER_NUM; k++) cout << std::setw(6) << layer_name[k];
+    cout << "  from   accuracy" << endl;
+    for (size_t c = 0; c < cand.size(); c++) {
+        const lenet5_net& n = cand[c].net;
+        cout << "  ";
+        for (int k = 0; k < NET_LAYER_NUM; k++) cout << std::setw(6) << n.scale[k].IN_O_INV;
+        cout << "  " << std::left << std::setw(6) << layer_name[cand[c].first] << std::right;
+        if (is_ok[c]) {
+            cout << " " << std::setw(6) << std::setprecision(2) << 100.0 * correct[c] / image_num << " %";
+        } else {
+            cout << "   invalid (M_INV / B_SCALE not a power of two)";
+        }
+        cout << ((c == 0) ? "  (base)" : "") << endl;
+    }
+
+    munmap(st.base, st.byte);
+    return 0;
+}
@@ -0,0 +1,344 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.26
+// Associated Filename: LeNet5_core_ip_team.cpp
+// Project Name: CNN_FPGA
+// Tool Versions:
+// Purpose: Intra-image thread team for single-request latency
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Batching and the pipeline raise throughput, but one interactive
+//     request still runs its five layers on one thread. The team splits each
+//     layer of a single image by packed output channel blocks, and adds row
+//     bands for the conv layers so that conv1 (one block) still has work for
+//     every thread. Every task is a sub-range call of conv_layer_packed /
+//     fc_layer_packed, so the team keeps the int16 accumulator plan and is
+//     bit-exact with the packed backend. It is only used when it beats the
+//     serial backend plan on the calibration images.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <climits>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "LeNet5_core_ip.h"
+
+typedef std::chrono::steady_clock team_clock;
+
+struct team_task {
+    int blk0, blk1;   // PACK_OCH_BLK output channel blocks
+    int oy0, oy1;     // conv output rows, even; fc: unused
+};
+
+struct net_team {
+    int thread_num;                              // workers + the calling thread
+    vector<team_task> task[NET_LAYER_NUM];
+    vector<std::thread> worker;
+    std::mutex run_lock;                         // one image at a time
+    alignas(64) std::atomic<uint32_t> job;       // image generation, futex word of idle workers
+    alignas(64) std::atomic<uint32_t> phase;     // barrier generation, futex word
+    alignas(64) std::atomic<int> arrive;
+    alignas(64) std::atomic<int> next[NET_LAYER_NUM];
+    std::atomic<uint32_t> sleeper;               // threads parked on job or phase
+    std::atomic<bool> stop;
+    // image in flight, in the layouts of net_run_with
+    const lenet5_net* net;
+    vector<vector<vector<int>>> conv_in[2];      // image, pool1
+    vector<vector<vector<int>>> conv_out[2];     // conv1, conv2 before pooling
+    vector<int> fc_act[NET_LAYER_NUM - 1];       // flatten(pool2), fc1, fc2, fc3
+    // calibration against the serial backend plan
+    double cal_us[2];                            // serial, team; us per image
+    int    cal_img;
+    // stats
+    std::atomic<unsigned long> run_num;
+    std::atomic<unsigned long> busy_num;
+    std::atomic<unsigned long> park_num;
+
+    ~net_team ();
+};
+
+static const int team_och[NET_LAYER_NUM] = {6, 16, 120, 84, NET_CLASS_NUM};
+static const int team_conv_dim[2][3] = {{1, 32, 28}, {6, 14, 10}};   // ICH, IY (= IX), OY (= OX)
+
+static uint32_t* futex_word (std::atomic<uint32_t>& word) {
+    return reinterpret_cast<uint32_t*>(&word);
+}
+
+// wait until word moves off old: spin, then park. sleeper is raised before the
+// last check so a waker that stores first always sees it.
+static void team_wait (net_team& t, std::atomic<uint32_t>& word, const uint32_t old) {
+    for (int i = 0; i < TEAM_SPIN_NUM; i++) {
+        if (word.load(std::memory_order_acquire) != old) return;
+        std::this_thread::yield();
+    }
+    t.sleeper++;
+    t.park_num++;
+    while (word.load() == old) syscall(SYS_futex, futex_word(word), FUTEX_WAIT_PRIVATE, old, NULL, NULL, 0);
+    t.sleeper--;
+}
+
+static void team_wake (net_team& t, std::atomic<uint32_t>& word) {
+    if (t.sleeper.load() > 0) syscall(SYS_futex, futex_word(word), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+static void team_barrier (net_team& t) {
+    const uint32_t ph = t.phase.load();
+    if (t.arrive.fetch_add(1) + 1 == t.thread_num) {
+        t.arrive.store(0);
+        t.phase.store(ph + 1);
+        team_wake(t, t.phase);
+        return;
+    }
+    team_wait(t, t.phase, ph);
+}
+
+//===========================================================================
+// tasks: sub-ranges of the packed kernels
+//===========================================================================
+// conv rows [oy0, oy1) of the task's blocks, 2x2 max pooled into pool1 or, for
+// conv2, straight into the fc1 input (pool2 [och][y][x] is the flatten order)
+static void team_conv_task (net_team& t, const int k, const team_task& tk) {
+    const packed_conv& pw = (k == 0) ? t.net->model.conv1 : t.net->model.conv2;
+    const int OY = team_conv_dim[k][2], PY = OY / 2, PX = OY / 2;
+    const vector<vector<vector<int>>>& conv = t.conv_out[k];
+    conv_layer_packed(t.conv_in[k], pw, t.conv_out[k], OY, t.net->M_INV[k], tk.blk0, tk.blk1, tk.oy0, tk.oy1);
+    const int och1 = std::min(pw.OCH, tk.blk1 * PACK_OCH_BLK);
+    for (int och = tk.blk0 * PACK_OCH_BLK; och < och1; och++) {
+        for (int py = tk.oy0 / 2; py < tk.oy1 / 2; py++) {
+            for (int px = 0; px < PX; px++) {
+                int max_pool = 0;
+                max_pool = std::max(max_pool, conv[och][2 * py][2 * px]);
+                max_pool = std::max(max_pool, conv[och][2 * py][2 * px + 1]);
+                max_pool = std::max(max_pool, conv[och][2 * py + 1][2 * px]);
+                max_pool = std::max(max_pool, conv[och][2 * py + 1][2 * px + 1]);
+                if (k == 0) t.conv_in[1][och][py][px] = max_pool;
+                else t.fc_act[0][(och * PY + py) * PX + px] = max_pool;
+            }
+        }
+    }
+}
+
+static void team_fc_task (net_team& t, const int k, const team_task& tk) {
+    const packed_model& m = t.net->model;
+    const packed_fc& pw = (k == 2) ? m.fc1 : (k == 3) ? m.fc2 : m.fc3;
+    fc_layer_packed(t.fc_act[k - 2], pw, t.fc_act[k - 1], t.net->M_INV[k], (k != NET_LAYER_NUM - 1), tk.blk0, tk.blk1);
+}
+
+//===========================================================================
+// team
+//===========================================================================
+static void team_layer (net_team& t, const int k) {
+    const vector<team_task>& task = t.task[k];
+    for (int i = t.next[k]++; i < (int)task.size(); i = t.next[k]++) {
+        if (k < 2) team_conv_task(t, k, task[i]);
+        else team_fc_task(t, k, task[i]);
+    }
+}
+
+static void team_image (net_team& t) {
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        team_layer(t, k);
+        team_barrier(t);
+    }
+}
+
+static void team_worker (net_team* t) {
+    uint32_t seen = 0;
+    while (true) {
+        team_wait(*t, t->job, seen);
+        seen = t->job.load();
+        if (t->stop.load()) return;
+        team_image(*t);
+    }
+}
+
+net_team::~net_team () {
+    stop.store(true);
+    job++;
+    if (sleeper.load() > 0) syscall(SYS_futex, futex_word(job), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    for (size_t i = 0; i < worker.size(); i++) worker[i].join();
+}
+
+// groups of whole blocks, about TEAM_TASK_MIN tasks per thread; conv: x row bands
+static void team_tasks (vector<team_task>& task, const int OCH, const int OY, const int thread_num) {
+    const int blk_num = (OCH + PACK_OCH_BLK - 1) / PACK_OCH_BLK;
+    const int want = thread_num * TEAM_TASK_MIN;
+    const int blk_per = (blk_num + std::min(blk_num, want) - 1) / std::min(blk_num, want);
+    const int group_num = (blk_num + blk_per - 1) / blk_per;
+    const int pool_row = OY / 2;
+    const int band_num = (OY == 0) ? 1 : std::min(pool_row, std::max(1, (want + group_num - 1) / group_num));
+    const int band_row = (OY == 0) ? 0 : (pool_row + band_num - 1) / band_num * 2;
+    for (int blk = 0; blk < blk_num; blk += blk_per) {
+        const int blk1 = std::min(blk_num, blk + blk_per);
+        if (OY == 0) {
+            task.push_back({blk, blk1, 0, 0});
+            continue;
+        }
+        for (int oy = 0; oy < OY; oy += band_row) task.push_back({blk, blk1, oy, std::min(OY, oy + band_row)});
+    }
+}
+
+std::shared_ptr<net_team> team_make (const int thread_num) {
+    std::shared_ptr<net_team> t = std::make_shared<net_team>();
+    t->thread_num = std::max(1, std::min(thread_num, TEAM_MAX));
+    for (int k = 0; k < NET_LAYER_NUM; k++) {
+        team_tasks(t->task[k], team_och[k], (k < 2) ? team_conv_dim[k][2] : 0, t->thread_num);
+    }
+    for (int k = 0; k < 2; k++) {
+        const int ICH = team_conv_dim[k][0], IY = team_conv_dim[k][1], OY = team_conv_dim[k][2];
+        t->conv_in[k].assign(ICH, vector<vector<int>>(IY, vector<int>(IY, 0)));
+        t->conv_out[k].assign(team_och[k], vector<vector<int>>(OY, vector<int>(OY, 0)));
+    }
+    t->fc_act[0].assign(layer_in_byte[2], 0);
+    for (int k = 2; k < NET_LAYER_NUM; k++) t->fc_act[k - 1].assign(team_och[k], 0);
+    t->cal_us[0] = t->cal_us[1] = -1;
+    t->cal_img = 0;
+    t->job = 0;
+    t->phase = 0;
+    t->arrive = 0;
+    t->sleeper = 0;
+    t->stop = false;
+    t->net = NULL;
+    t->run_num = 0;
+    t->busy_num = 0;
+    t->park_num = 0;
+    for (int i = 1; i < t->thread_num; i++) t->worker.emplace_back(team_worker, t.get());
+    return t;
+}
+
+bool team_run_image (net_team& t, const lenet5_net& net, const int8_t* img, int32_t* logit, int& cls) {
+    std::unique_lock<std::mutex> lock(t.run_lock, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        t.busy_num++;
+        return false;
+    }
+    t.net = &net;
+    for (int i = 0; i < NET_IMG_BYTE; i++) t.conv_in[0][0][i / 32][i % 32] = img[i];
+    for (int k = 0; k < NET_LAYER_NUM; k++) t.next[k] = 0;
+    t.job++;
+    team_wake(t, t.job);
+    team_image(t);
+    t.run_num++;
+    const vector<int>& out = t.fc_act[NET_LAYER_NUM - 2];
+    if (logit) std::copy(out.begin(), out.end(), logit);
+    cls = std::max_element(out.begin(), out.end()) - out.begin();
+    return true;
+}
+
+bool team_calibrate (net_team& t, const lenet5_net& net, const int8_t* img, const int img_num) {
+    if (img_num <= 0) {
+        std::cerr << "team: no calibration images, images run on the calling thread" << std::endl;
+        return false;
+    }
+    const layer_backend* const* be = (net.plan != NULL) ? net.plan->layer : backend_default;
+    bool is_same = true;
+    for (int r = 0; r < BACKEND_CAL_REP; r++) {
+        double us[2] = {0, 0};
+        for (int i = 0; i < img_num; i++) {
+            const int8_t* p = &img[(size_t)i * NET_IMG_BYTE];
+            int32_t ref[NET_CLASS_NUM], out[NET_CLASS_NUM];
+            int cls = 0;
+            const team_clock::time_point t0 = team_clock::now();
+            net_run_with(net, be, 0, p, NULL, ref, NULL);
+            const team_clock::time_point t1 = team_clock::now();
+            team_run_image(t, net, p, out, cls);
+            const team_clock::time_point t2 = team_clock::now();
+            us[0] += std::chrono::duration<double, std::micro>(t1 - t0).count();
+            us[1] += std::chrono::duration<double, std::micro>(t2 - t1).count();
+            is_same = is_same && std::equal(ref, ref + NET_CLASS_NUM, out);
+        }
+        for (int s = 0; s < 2; s++) {
+            if ((t.cal_us[s] < 0) || (us[s] / img_num < t.cal_us[s])) t.cal_us[s] = us[s] / img_num;
+        }
+    }
+    t.cal_img = img_num;
+    t.run_num = 0;
+    const bool is_used = is_same && (t.cal_us[1] < t.cal_us[0]);
+    std::ios state(NULL);
+    state.copyfmt(cout);
+    cout << std::fixed << std::setprecision(1) << "team: " << t.thread_num << " threads " << t.cal_us[1]
+         << " us/image vs serial " << t.cal_us[0] << " us/image on " << img_num << " images, "
+         << (!is_same ? "differs from the serial plan, not used" : is_used ? "used" : "slower, not used") << endl;
+    cout.copyfmt(state);
+    return is_used;
+}
+
+void team_report (const net_team& t) {
+    cout << "team: " << t.thread_num << " threads, tasks";
+    for (int k = 0; k < NET_LAYER_NUM; k++) cout << " " << layer_name[k] << "=" << t.task[k].size();
+    cout << ", " << t.run_num << " images, " << t.busy_num << " run serially (busy), " << t.park_num << " parks" << endl;
+}
+
+//===========================================================================
+// LeNet5_core_ip latency <image_num> <thread_num>
+//===========================================================================
+int run_latency (int argc, char** argv, const lenet5_net& net, const img_cache* ic) {
+    if (argc != 4) {
+        printf("Usage : <executable> latency <image_num> <thread_num>\n");
+        return -1;
+    }
+    const int thread_num = atoi(argv[3]);
+    if ((thread_num < 1) || (thread_num > TEAM_MAX)) {
+        std::cerr << "latency: thread_num must be 1 .. " << TEAM_MAX << std::endl;
+        return -1;
+    }
+    vector<int8_t> img;
+    int img_num = atoi(argv[2]);
+    if ((ic != NULL) && (img_num <= ic->img_num)) {
+        img.assign(ic->img, ic->img + (size_t)img_num * NET_IMG_BYTE);
+    } else {
+        vector<uint8_t> pixel, label;
+        img_num = rd_idx_set(img_num, pixel, label);
+        img.resize((size_t)img_num * NET_IMG_BYTE);
+        for (int i = 0; i < img_num; i++) pad_image(&pixel[(size_t)i * 28 * 28], &img[(size_t)i * NET_IMG_BYTE]);
+    }
+    if (img_num <= 0) {
+        std::cerr << "latency: no images" << std::endl;
+        return -1;
+    }
+
+    std::shared_ptr<net_team> team = team_make(thread_num);
+    const layer_backend* const* be = (net.plan != NULL) ? net.plan->layer : backend_default;
+    vector<double> lat[2];
+    int mismatch = 0;
+    for (int i = -std::min(img_num, 16); i < img_num; i++) {   // negative: warm-up
+        const int8_t* p = &img[(size_t)((i + img_num) % img_num) * NET_IMG_BYTE];
+        int32_t ref[NET_CLASS_NUM], out[NET_CLASS_NUM];
+        int cls = 0;
+        const team_clock::time_point t0 = team_clock::now();
+        net_run_with(net, be, 0, p, NULL, ref, NULL);
+        const team_clock::time_point t1 = team_clock::now();
+        team_run_image(*team, net, p, out, cls);
+        const team_clock::time_point t2 = team_clock::now();
+        if (i < 0) continue;
+        lat[0].push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+        lat[1].push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
+        mismatch += !std::equal(ref, ref + NET_CLASS_NUM, out);
+    }
+
+    std::ios state(NULL);
+    state.copyfmt(cout);
+    cout << "latency: " << img_num << " single images, serial layers vs a team of " << thread_num << " threads (us)" << endl;
+    cout << "  path        p50      p90      p99    p99.9      max     mean" << endl;
+    const char* path[2] = {"serial", "team"};
+    cout << std::fixed << std::setprecision(1);
+    for (int s = 0; s < 2; s++) {
+        double sum = 0;
+        for (size_t i = 0; i < lat[s].size(); i++) sum += lat[s][i];
+        std::sort(lat[s].begin(), lat[s].end());
+        auto pct = [&](const double p) { return lat[s][std::min<size_t>(lat[s].size() - 1, p * lat[s].size())]; };
+        cout << "  " << std::left << std::setw(6) << path[s] << std::right << std::setw(9) << pct(0.50)
+             << std::setw(9) << pct(0.90) << std::setw(9) << pct(0.99) << std::setw(9) << pct(0.999)
+             << std::setw(9) << lat[s].back() << std::setw(9) << sum / lat[s].size() << endl;
+    }
+    cout.copyfmt(state);
+    team_report(*team);
+    cout << "latency: " << mismatch << " of " << img_num << " images differ from the serial path" << endl;
+    return (mismatch == 0) ? 0 : -1;
+}
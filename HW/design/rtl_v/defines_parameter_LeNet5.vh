@@ -191,3 +191,8 @@ parameter   DATA_IDX_BW   = 20  ;
 `define FP_IN_FC3_BIAS   "../design/ref_cpp/trace/in_fc3_bias.txt"
 
 `define FP_OT_OTFMAP "../design/ref_cpp/trace/ot_otfmap_rtl.txt"
+
+// packed bus beats, tb_dma_LeNet5.sv with -d USE_MEMH
+`define FP_MEM_PARAM  "../design/ref_cpp/trace/mem_param.memh"
+`define FP_MEM_INFMAP "../design/ref_cpp/trace/mem_infmap.memh"
+`define FP_MEM_RESULT "../design/ref_cpp/trace/mem_result.memh"
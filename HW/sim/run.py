@@ -80,6 +80,7 @@ def parse_args():
     parser.add_argument("-cwf"      ,dest="cwf"       ,action="store_true"    ,help="Core Module Vivado sim with waveform")
     parser.add_argument("-swf"      ,dest="swf"       ,action="store_true"    ,help="Submoule Vivado sim with waveform")
     parser.add_argument("-diff"     ,dest="diff"      ,action="store_true"    ,help="Diff ref vs rtl file")
+    parser.add_argument("-memh"     ,dest="memh"      ,action="store_true"    ,help="Load the packed .memh images instead of parsing the txt traces")
     args = parser.parse_args()
     return args
        
@@ -116,6 +117,8 @@ def run_rtl_v_sim(args):
     
     # cmd = "xvlog -i " + RTL_V_PATH + " ./tb_" + MODULE_NAME + ".v " + RTL_V_PATH + "*.v" + " -d TEST_NUM=100"
     cmd = "xvlog -i " + RTL_V_PATH + " --sv -L xilinx_vip -f ./" + RTL_V_LISTFILE +" -f ./" + AXI_TB_LISTFILE + " ./tb_" + TB_NAME + ".sv -d LOOP_NUM=" + RTL_LOOP_NUM
+    if(args.memh):
+        cmd = cmd + " -d USE_MEMH"
     run_cmd(cmd)
     
     # if use .vhd file
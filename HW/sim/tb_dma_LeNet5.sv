@@ -182,6 +182,18 @@ module tb_dma_LeNet5 ();
         fp_in_infmap <= $fopen(`FP_IN_INFAMP , "r");
         fp_ot_otfmap <= $fopen(`FP_OT_OTFMAP , "w");
     end
+    
+`ifdef USE_MEMH
+    // bus beats packed by the reference model (LeNet5_core_ip_memh.cpp)
+    bit [C_M00_AXI_DATA_WIDTH-1:0] mem_param  [0 : NUM_RD_PARAM-1];
+    bit [C_M00_AXI_DATA_WIDTH-1:0] mem_infmap [0 : `LOOP_NUM*NUM_RD_INFMAP-1];
+    bit [C_M00_AXI_DATA_WIDTH-1:0] mem_result [0 : `LOOP_NUM-1];
+    initial begin
+        $readmemh(`FP_MEM_PARAM , mem_param );
+        $readmemh(`FP_MEM_INFMAP, mem_infmap);
+        $readmemh(`FP_MEM_RESULT, mem_result);
+    end
+`endif
 
 //==============================================================================
 // TB register
@@ -503,6 +515,25 @@ module tb_dma_LeNet5 ();
         end
     endtask
     
+`ifdef USE_MEMH
+    task backdoor_memh_write (
+            input longint unsigned first,
+            input longint unsigned num,
+        	input int unsigned start_addr,
+            input bit is_param
+        );
+        longint unsigned addr_byte;
+	    bit [C_M00_AXI_DATA_WIDTH_BYTE-1:0] bus_strb;
+        addr_byte = (start_addr >> C_M00_AXI_DATA_WIDTH_BYTE_LOG);
+        bus_strb  = {C_M00_AXI_DATA_WIDTH_BYTE{1'b1}};
+        for(longint unsigned i = first; i < first + num; i = i + 1) begin
+            m00_axi.mem_model.backdoor_memory_write(
+                {addr_byte, {C_M00_AXI_DATA_WIDTH_BYTE_LOG{1'b0}}}, is_param ? mem_param[i] : mem_infmap[i], bus_strb);
+            addr_byte = addr_byte + 1;
+        end
+    endtask
+`endif
+    
     task backdoor_inference_read (
             input integer i_idx  ,
         	input int unsigned start_addr
@@ -523,6 +554,10 @@ module tb_dma_LeNet5 ();
 	    r_inference = bus_data[4-1 : 0];
         
         $display("(idx: %0d) Result: %0d", i_idx, r_inference); 
+`ifdef USE_MEMH
+        if(bus_data !== mem_result[i_idx])
+            $display("(idx: %0d) WDMA beat %016x, expected %016x", i_idx, bus_data, mem_result[i_idx]);
+`endif
     endtask
     
     /////////////////////////////////////////////////////////////////////////////////////////////////
@@ -583,7 +618,11 @@ module tb_dma_LeNet5 ();
       $display( "======================================================");
       start_vips();
       
+`ifdef USE_MEMH
+      backdoor_memh_write(0, NUM_RD_PARAM, USER_RDMA_PARAM_ADDR, 1'b1);
+`else
       backdoor_cnn_parameter_write(USER_RDMA_PARAM_ADDR);
+`endif
     
       blocking_write_register(ADDR_AXI00_PTR0_DATA_0, 32'd0); // baseaddr is 0.
       blocking_write_register(ADDR_RDMA_MEM_PTR_PARAM_0, USER_RDMA_PARAM_ADDR);
@@ -620,7 +659,11 @@ module tb_dma_LeNet5 ();
       while (1) begin
         
         if((~rd_loop_ready) && (rd_loop < `LOOP_NUM)) begin
+`ifdef USE_MEMH
+            backdoor_memh_write(rd_loop*NUM_RD_INFMAP, NUM_RD_INFMAP, USER_RDMA_INFMAP_ADDR, 1'b0);
+`else
             backdoor_cnn_infmap_write(rd_loop, USER_RDMA_INFMAP_ADDR);
+`endif
             blocking_write_register(ADDR_AP_CTRL, CTRL_START_INFMAP_MASK);
             rd_loop_ready = 1;
         end
@@ -0,0 +1,126 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.12
+// Design Name:
+// Module Name: dma_LeNet5_arena.cpp
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: DMA region arena and buffer pool
+// Dependencies:
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "xil_printf.h"
+#include "dma_LeNet5_arena.h"
+
+static u32 align_up (const u32 byte) {
+    return (byte + ARENA_ALIGN - 1) & ~(u32)(ARENA_ALIGN - 1);
+}
+
+void arena_init (
+    dma_arena* arena,
+    const UINTPTR base,
+    const u32 byte
+) {
+    arena->base = (base + ARENA_ALIGN - 1) & ~(UINTPTR)(ARENA_ALIGN - 1);
+    arena->end  = base + byte;
+    arena->top  = arena->base;
+    arena->region_num = 0;
+}
+
+void* arena_alloc (
+    dma_arena* arena,
+    const char* name,
+    const u32 byte
+) {
+    u32 size = align_up(byte);
+    if ((size > arena->end - arena->top) || (arena->region_num >= ARENA_REGION_NUM)) {
+        xil_printf("arena: %s (%u B) does not fit, %u B left in the window\n",
+                   name, byte, (u32)(arena->end - arena->top));
+        return NULL;
+    }
+    arena_region* r = &arena->region[arena->region_num++];
+    strncpy(r->name, name, ARENA_NAME_LEN - 1);
+    r->name[ARENA_NAME_LEN - 1] = '\0';
+    r->addr = arena->top;
+    r->byte = size;
+    arena->top += size;
+    return (void*)r->addr;
+}
+
+UINTPTR arena_mark (const dma_arena* arena) {
+    return arena->top;
+}
+
+void arena_release (
+    dma_arena* arena,
+    const UINTPTR mark
+) {
+    while ((arena->region_num > 0) && (arena->region[arena->region_num - 1].addr >= mark)) {
+        arena->region_num--;
+    }
+    arena->top = mark;
+}
+
+void arena_report (const dma_arena* arena) {
+    printf("------- DMA memory map -------\n");
+    for (int i = 0; i < arena->region_num; i++) {
+        const arena_region* r = &arena->region[i];
+        printf("0x%08x - 0x%08x %8u B  %s\n", (u32)r->addr, (u32)(r->addr + r->byte - 1), r->byte, r->name);
+    }
+    printf("free: 0x%08x - 0x%08x %8u B\n", (u32)arena->top, (u32)(arena->end - 1), (u32)(arena->end - arena->top));
+    printf("------------------------------\n");
+}
+
+bool pool_init (
+    dma_pool* pool,
+    dma_arena* arena,
+    const char* name,
+    const u32 buf_byte,
+    const int buf_num
+) {
+    if (buf_num > POOL_BUF_MAX) {
+        xil_printf("pool: %s needs %d buffers, at most %d\n", name, buf_num, POOL_BUF_MAX);
+        return false;
+    }
+    pool->buf_byte = align_up(buf_byte);
+    pool->base = (u8*)arena_alloc(arena, name, pool->buf_byte * buf_num);
+    if (pool->base == NULL) {
+        return false;
+    }
+    pool->buf_num  = buf_num;
+    pool->free_num = buf_num;
+    // lowest address on top, buffers are handed out in address order first
+    for (int i = 0; i < buf_num; i++) {
+        pool->free_idx[i] = (u16)(buf_num - 1 - i);
+    }
+    return true;
+}
+
+void* pool_get (dma_pool* pool) {
+    if (pool->free_num == 0) {
+        return NULL;
+    }
+    int idx = pool->free_idx[--pool->free_num];
+    return pool->base + idx * pool->buf_byte;
+}
+
+void pool_put (
+    dma_pool* pool,
+    void* buf
+) {
+    u32 ofs = ((u8*)buf >= pool->base) ? (u32)((u8*)buf - pool->base) : (u32)-1;
+    if ((ofs % pool->buf_byte != 0) || (ofs / pool->buf_byte >= (u32)pool->buf_num) ||
+        (pool->free_num >= pool->buf_num)) {
+        xil_printf("pool: bad buffer 0x%08x returned\n", (u32)(UINTPTR)buf);
+        return;
+    }
+    pool->free_idx[pool->free_num++] = (u16)(ofs / pool->buf_byte);
+}
@@ -0,0 +1,67 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.12
+// Design Name:
+// Module Name: dma_LeNet5_arena.h
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: DMA region arena. Every buffer that an instance reads or writes
+//              is carved from one DDR window, in allocation order, aligned to
+//              ARENA_ALIGN, and recorded with its name for the memory map.
+//              Fixed-size per-image buffers come from a dma_pool on top of it.
+// Dependencies: xil_types.h
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Regions are never freed one by one. arena_mark() / arena_release() drop
+//     everything allocated after the mark, for staging buffers of one call.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DMA_LENET5_ARENA_H
+#define DMA_LENET5_ARENA_H
+
+#include "xil_types.h"
+
+#define ARENA_ALIGN       64  // 2 x Cortex-A9 L1/L2 cache line, no line is shared by two regions
+#define ARENA_REGION_NUM  16
+#define ARENA_NAME_LEN    24
+
+struct arena_region {
+    char    name[ARENA_NAME_LEN];
+    UINTPTR addr;
+    u32     byte;
+};
+
+struct dma_arena {
+    UINTPTR base;
+    UINTPTR end;     // first address after the window
+    UINTPTR top;     // next free address
+    arena_region region[ARENA_REGION_NUM];
+    int     region_num;
+};
+
+void  arena_init (dma_arena* arena, const UINTPTR base, const u32 byte);
+void* arena_alloc (dma_arena* arena, const char* name, const u32 byte);  // NULL if the window is full
+UINTPTR arena_mark (const dma_arena* arena);
+void  arena_release (dma_arena* arena, const UINTPTR mark);
+void  arena_report (const dma_arena* arena);
+
+// pool of equal-size buffers, a free stack of buffer indexes
+#define POOL_BUF_MAX  256
+
+struct dma_pool {
+    u8* base;
+    u32 buf_byte;   // rounded up to ARENA_ALIGN
+    int buf_num;
+    int free_num;
+    u16 free_idx[POOL_BUF_MAX];
+};
+
+bool  pool_init (dma_pool* pool, dma_arena* arena, const char* name, const u32 buf_byte, const int buf_num);
+void* pool_get (dma_pool* pool);   // NULL if every buffer is in use
+void  pool_put (dma_pool* pool, void* buf);
+
+#endif
@@ -0,0 +1,178 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.14
+// Design Name:
+// Module Name: dma_LeNet5_cache.cpp
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: Per-image result cache
+// Dependencies:
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "dma_LeNet5_cache.h"
+#include "dma_LeNet5_dev.h"
+
+#define CACHE_MUL0  0x9e3779b97f4a7c15ULL
+#define CACHE_MUL1  0xc2b2ae3d27d4eb4fULL
+
+static u64 cache_mix (u64 h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void cache_init (result_cache* cache) {
+    for (int i = 0; i < CACHE_BUCKET_NUM; i++) {
+        cache->bucket[i] = CACHE_NIL;
+    }
+    cache->lru_head = CACHE_NIL;
+    cache->lru_tail = CACHE_NIL;
+    cache->used_num = 0;
+    cache->hit   = 0;
+    cache->miss  = 0;
+    cache->evict = 0;
+}
+
+void cache_set_param (
+    result_cache* cache,
+    const u64 param_hash
+) {
+    if (cache->param_hash != param_hash) {
+        u64 keep = param_hash;
+        cache_init(cache);
+        cache->param_hash = keep;
+    }
+}
+
+// one multiply per 8 pixels and lane
+cache_key cache_key_of (
+    const result_cache* cache,
+    const u64* infmap_bus
+) {
+    u64 h0 = cache->param_hash;
+    u64 h1 = ~cache->param_hash;
+    for (int i = 0; i < INFMAP_BUS_NUM; i++) {
+        h0 = (h0 ^ infmap_bus[i]) * CACHE_MUL0;
+        h1 = (h1 + infmap_bus[i]) * CACHE_MUL1;
+        h1 ^= h1 >> 29;
+    }
+    cache_key key = {cache_mix(h0), cache_mix(h1)};
+    return key;
+}
+
+static int cache_bucket_of (const cache_key& key) {
+    return (int)(key.h0 & (CACHE_BUCKET_NUM - 1));
+}
+
+static void lru_unlink (result_cache* cache, const int i) {
+    cache_entry* e = &cache->entry[i];
+    if (e->prev != CACHE_NIL) cache->entry[e->prev].next = e->next;
+    else                      cache->lru_head = e->next;
+    if (e->next != CACHE_NIL) cache->entry[e->next].prev = e->prev;
+    else                      cache->lru_tail = e->prev;
+}
+
+static void lru_push_head (result_cache* cache, const int i) {
+    cache_entry* e = &cache->entry[i];
+    e->prev = CACHE_NIL;
+    e->next = cache->lru_head;
+    if (cache->lru_head != CACHE_NIL) cache->entry[cache->lru_head].prev = (s16)i;
+    cache->lru_head = (s16)i;
+    if (cache->lru_tail == CACHE_NIL) cache->lru_tail = (s16)i;
+}
+
+static int cache_find (const result_cache* cache, const cache_key& key) {
+    for (int i = cache->bucket[cache_bucket_of(key)]; i != CACHE_NIL; i = cache->entry[i].chain) {
+        if ((cache->entry[i].key.h0 == key.h0) && (cache->entry[i].key.h1 == key.h1)) {
+            return i;
+        }
+    }
+    return CACHE_NIL;
+}
+
+bool cache_lookup (
+    result_cache* cache,
+    const cache_key& key,
+    int& cls,
+    int8_t* logit
+) {
+    int i = cache_find(cache, key);
+    if (i == CACHE_NIL) {
+        cache->miss++;
+        return false;
+    }
+    cache->hit++;
+    lru_unlink(cache, i);
+    lru_push_head(cache, i);
+    cls = cache->entry[i].cls;
+    if ((logit != NULL) && cache->entry[i].has_logit) {
+        memcpy(logit, cache->entry[i].logit, REF_CLASS_NUM);
+    }
+    return true;
+}
+
+void cache_insert (
+    result_cache* cache,
+    const cache_key& key,
+    const int cls,
+    const int8_t* logit
+) {
+    int i = cache_find(cache, key);
+    if (i == CACHE_NIL) {
+        if (cache->used_num < CACHE_ENTRY_NUM) {
+            i = cache->used_num++;
+        } else {
+            // evict the least recently used entry, unlink it from its bucket
+            i = cache->lru_tail;
+            s16* link = &cache->bucket[cache_bucket_of(cache->entry[i].key)];
+            while (*link != i) {
+                link = &cache->entry[*link].chain;
+            }
+            *link = cache->entry[i].chain;
+            lru_unlink(cache, i);
+            cache->evict++;
+        }
+        int b = cache_bucket_of(key);
+        cache->entry[i].key   = key;
+        cache->entry[i].chain = cache->bucket[b];
+        cache->bucket[b] = (s16)i;
+        cache->entry[i].has_logit = false;
+    } else {
+        lru_unlink(cache, i);
+    }
+    lru_push_head(cache, i);
+    cache->entry[i].cls = (u8)cls;
+    if (logit != NULL) {
+        memcpy(cache->entry[i].logit, logit, REF_CLASS_NUM);
+        cache->entry[i].has_logit = true;
+    }
+}
+
+void cache_set_logit (
+    result_cache* cache,
+    const cache_key& key,
+    const int8_t* logit
+) {
+    int i = cache_find(cache, key);
+    if (i == CACHE_NIL) {
+        return;
+    }
+    memcpy(cache->entry[i].logit, logit, REF_CLASS_NUM);
+    cache->entry[i].has_logit = true;
+}
+
+void cache_report (const result_cache* cache) {
+    unsigned long num = cache->hit + cache->miss;
+    printf("result cache: %d / %d entries, hit %lu, miss %lu (%.1f%% hit), evict %lu\n",
+           cache->used_num, CACHE_ENTRY_NUM, cache->hit, cache->miss,
+           (num == 0) ? 0.0 : 100.0 * cache->hit / num, cache->evict);
+}
@@ -0,0 +1,73 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.14
+// Design Name:
+// Module Name: dma_LeNet5_cache.h
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: Per-image result cache. The key is a 128-bit hash of the packed
+//              32x32 int8 infmap (INFMAP_BUS_NUM beats) seeded with the
+//              parameter image fingerprint, so a parameter reload never
+//              serves results of the old weights. Entries hold the class and,
+//              when the PS reference ran on the image, its fc3 logits.
+//              CACHE_ENTRY_NUM entries, least recently used is evicted.
+// Dependencies: xil_types.h
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     The key is not checked against the image itself. Two 64-bit hashes
+//     with independent multipliers make a false hit practically impossible
+//     at these table sizes.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DMA_LENET5_CACHE_H
+#define DMA_LENET5_CACHE_H
+
+#include "xil_types.h"
+#include "dma_LeNet5_ref.h"
+
+#define CACHE_ENTRY_NUM   256
+#define CACHE_BUCKET_NUM  512   // power of 2
+#define CACHE_NIL         (-1)
+
+struct cache_key {
+    u64 h0;
+    u64 h1;
+};
+
+struct cache_entry {
+    cache_key key;
+    u8     cls;
+    bool   has_logit;
+    int8_t logit[REF_CLASS_NUM];
+    s16    chain;       // next entry of the bucket
+    s16    prev;        // LRU list, head = most recent
+    s16    next;
+};
+
+struct result_cache {
+    u64         param_hash;
+    cache_entry entry [CACHE_ENTRY_NUM];
+    s16         bucket[CACHE_BUCKET_NUM];
+    s16         lru_head;
+    s16         lru_tail;
+    int         used_num;
+    unsigned long hit;
+    unsigned long miss;
+    unsigned long evict;
+};
+
+void cache_init (result_cache* cache);
+void cache_set_param (result_cache* cache, const u64 param_hash);  // flushes on change
+cache_key cache_key_of (const result_cache* cache, const u64* infmap_bus);
+
+// hit: fills cls (and logit if cached with logits, else leaves it) and returns true
+bool cache_lookup (result_cache* cache, const cache_key& key, int& cls, int8_t* logit);
+void cache_insert (result_cache* cache, const cache_key& key, const int cls, const int8_t* logit);  // logit may be NULL
+void cache_set_logit (result_cache* cache, const cache_key& key, const int8_t* logit);  // entry kept as is when absent, LRU untouched
+void cache_report (const result_cache* cache);
+
+#endif
@@ -0,0 +1,264 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.13
+// Design Name:
+// Module Name: dma_LeNet5_coro.cpp
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: C++20 coroutine client of dma_LeNet5_top
+// Dependencies: -std=gnu++20
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include "xil_io.h"
+#include "xil_cache.h"
+#include "xil_printf.h"
+#include "dma_LeNet5_coro.h"
+#include "dma_LeNet5_prof.h"
+
+#if defined(__cpp_impl_coroutine)
+
+#define CORO_WORKER_PER_CORE  2  // one image on the instance, one read ahead
+
+void coro_awaiter::await_suspend (std::coroutine_handle<> h) {
+    handle = h;
+    sched->wait[sched->wait_num++] = this;
+}
+
+void coro_sched::spawn (coro_task t) {
+    task[task_num++] = t.handle;
+    t.handle.resume();  // runs up to its first co_await
+}
+
+void coro_sched::run () {
+    while (task_num > 0) {
+        if (wait_num == 0) {
+            xil_printf("coro: %d coroutines suspended without an awaiter\n", task_num);
+            break;
+        }
+        for (int i = 0; i < wait_num; ) {
+            coro_awaiter* a = wait[i];
+            if (!a->poll()) {
+                i++;
+                continue;
+            }
+            wait[i] = wait[--wait_num];
+            a->handle.resume();  // may park a new awaiter at the end of the list
+        }
+        for (int i = 0; i < task_num; ) {
+            if (task[i].done()) {
+                task[i].destroy();
+                task[i] = task[--task_num];
+            } else {
+                i++;
+            }
+        }
+    }
+}
+
+void coro_core_init (
+    coro_core* core,
+    lenet5_dev* dev,
+    const int owner,
+    coro_sched* sched,
+    result_ring* ring,
+    u8* out_class
+) {
+    core->dev       = dev;
+    core->owner     = owner;
+    core->sched     = sched;
+    core->ring      = ring;
+    core->out_class = out_class;
+    core->is_busy   = false;
+    core->issue_num = 0;
+    core->start_num = 0;
+    core->done_num  = 0;
+}
+
+static bool coro_is_done (coro_core* core) {
+    return (dev_ctrl(core->dev) & CTRL_DONE_MASK) == CTRL_DONE_MASK;
+}
+
+coro_core::param_awaiter coro_core::load_params (const u64* rdma_param) {
+    param_awaiter a;
+    a.sched      = sched;
+    a.core       = this;
+    a.rdma_param = rdma_param;
+    a.state      = 0;
+    return a;
+}
+
+bool coro_core::param_awaiter::poll () {
+    if (state == 0) {
+        if (core->is_busy || ((dev_ctrl(core->dev) & CTRL_IDLE_MASK) != CTRL_IDLE_MASK)) {
+            return false;
+        }
+        core->is_busy  = true;
+        Xil_Out32(core->dev->base + ADDR_RDMA_MEM_PTR_PARAM_0, (u32)(UINTPTR)rdma_param);
+        Xil_Out32(core->dev->base + ADDR_AP_CTRL, (u32)(CTRL_START_PARAM_MASK));
+        state = 1;
+        return false;
+    }
+    if (!coro_is_done(core)) {
+        return false;
+    }
+    core->is_busy = false;
+    return true;
+}
+
+// the result slot is issued here, so seqs must reach infer() in order:
+// the tracker checks the n-th record of an instance against base + n
+coro_core::infer_awaiter coro_core::infer (const u64* infmap_bus, const u32 seq) {
+    infer_awaiter a;
+    a.sched      = sched;
+    a.core       = this;
+    a.infmap_bus = infmap_bus;
+    a.seq        = seq;
+    a.ticket     = issue_num++;
+    a.wdma_slot  = result_issue(ring, seq, owner);
+    a.state      = 0;
+    if (a.wdma_slot == NULL) {
+        xil_printf("coro: seq %u has no result slot\n", seq);
+        out_class[seq] = RESULT_DROP_CLASS;
+        a.state = 3;
+    }
+    return a;
+}
+
+// 0: wait for the instance and its turn, 1: wait for DONE,
+// 2: wait for the tracker to consume or drop the record, 3: done
+bool coro_core::infer_awaiter::poll () {
+    if (state == 0) {
+        if (core->is_busy || (core->start_num != ticket)) {
+            return false;
+        }
+        core->is_busy = true;
+        core->start_num++;
+        Xil_Out32(core->dev->base + ADDR_RDMA_MEM_PTR_INFMAP_0, (u32)(UINTPTR)infmap_bus);
+        Xil_Out32(core->dev->base + ADDR_WDMA_MEM_PTR_DATA_0, (u32)(UINTPTR)wdma_slot);
+        XTime_GetTime(&start_time);
+        Xil_Out32(core->dev->base + ADDR_AP_CTRL, (u32)(CTRL_START_INFMAP_MASK));
+        state = 1;
+        return false;
+    }
+    if (state == 1) {
+        if (!coro_is_done(core)) {
+            return false;
+        }
+        XTime t_done;
+        XTime_GetTime(&t_done);
+        prof_add(PROF_RUN, t_done - start_time);
+        prof_image(t_done - start_time);
+        // the beat follows DONE on the WDMA channel, the instance is free
+        result_done(core->ring, seq);
+        core->is_busy = false;
+        core->done_num++;
+        state = 2;
+    }
+    if (state == 2) {
+        result_poll(core->ring, core->out_class);
+        if (!result_is_consumed(core->ring, seq)) {
+            return false;
+        }
+        state = 3;
+    }
+    return true;
+}
+
+struct coro_drv {
+    dma_pool*    pool;
+    coro_load_fn load;
+    void*        load_ctx;
+    int          next;      // next image to take
+    int          loop_num;
+    u8*          hw_class;
+};
+
+static coro_task coro_load_param_all (coro_core* cores, const int core_num, const u64* rdma_param) {
+    for (int i = 0; i < core_num; i++) {
+        co_await cores[i].load_params(rdma_param);
+    }
+}
+
+// one image at a time: read, infer, store. workers interleave at co_await
+static coro_task coro_worker (coro_core* cores, const int core_num, coro_drv* drv) {
+    while (drv->next < drv->loop_num) {
+        int  img = drv->next++;
+        u64* buf = (u64*)pool_get(drv->pool);
+        prof_begin(PROF_PREPROC);
+        drv->load(drv->load_ctx, img, buf);
+        prof_end(PROF_PREPROC);
+        prof_begin(PROF_COPY);
+        Xil_DCacheFlushRange((UINTPTR)buf, INFMAP_BUS_NUM * AXI_DATA_BYTE);
+        prof_end(PROF_COPY);
+        // infer() issues the result slot before the next worker runs, in image order
+        int cls = co_await cores[img % core_num].infer(buf, img);
+        pool_put(drv->pool, buf);
+        drv->hw_class[img] = (u8)cls;
+    }
+}
+
+bool run_coro_lenet5_fatfs (
+    lenet5_dev* devs,
+    const int dev_num,
+    dma_pool* infmap_pool,
+    result_ring* ring,
+    const u64* rdma_param,
+    coro_load_fn load,
+    void* load_ctx,
+    const int loop_num,
+    u8* hw_class
+) {
+    xil_printf("Starting run_coro_lenet5_fatfs...\n");
+
+    coro_sched sched;
+    sched.wait_num = 0;
+    sched.task_num = 0;
+    coro_core cores[LENET5_DEV_NUM];
+    for (int i = 0; i < dev_num; i++) {
+        coro_core_init(&cores[i], &devs[i], i, &sched, ring, hw_class);
+    }
+
+    sched.spawn(coro_load_param_all(cores, dev_num, rdma_param));
+    sched.run();
+
+    coro_drv drv = {infmap_pool, load, load_ctx, 0, loop_num, hw_class};
+    int worker_num = dev_num * CORO_WORKER_PER_CORE;
+    for (int i = 0; (i < worker_num) && (i < infmap_pool->buf_num); i++) {
+        sched.spawn(coro_worker(cores, dev_num, &drv));
+    }
+    sched.run();
+
+    for (int i = 0; i < dev_num; i++) {
+        printf("instance %d (0x%08x): %lu images \n", i, (u32)devs[i].base, cores[i].done_num);
+    }
+    xil_printf("Coroutine Run Done!\n");
+    return true;
+}
+
+#else
+
+bool run_coro_lenet5_fatfs (
+    lenet5_dev* devs,
+    const int dev_num,
+    dma_pool* infmap_pool,
+    result_ring* ring,
+    const u64* rdma_param,
+    coro_load_fn load,
+    void* load_ctx,
+    const int loop_num,
+    u8* hw_class
+) {
+    (void)devs; (void)dev_num; (void)infmap_pool; (void)ring; (void)rdma_param;
+    (void)load; (void)load_ctx; (void)loop_num; (void)hw_class;
+    xil_printf("Coroutine client not built, compile with -std=gnu++20.\n");
+    return false;
+}
+
+#endif
@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.13
+// Design Name:
+// Module Name: dma_LeNet5_coro.h
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: C++20 coroutine client of dma_LeNet5_top.
+//                  co_await core.load_params(rdma_param);
+//                  int cls = co_await core.infer(infmap_bus);
+//              Awaiters do not block: a coroutine that waits for an instance
+//              is parked in the coro_sched wait list, and the single-threaded
+//              scheduler polls every parked awaiter in turn, so one loop keeps
+//              an image on every instance and the next ones read ahead.
+//              load_params completes on AP_CTRL DONE. infer frees the
+//              instance on DONE and completes when the result tracker has
+//              consumed its record, or declared it dropped RESULT_TIMEOUT_US
+//              after DONE (class RESULT_DROP_CLASS).
+// Dependencies: -std=gnu++20 (or -fcoroutines). Without coroutine support the
+//               header only declares run_coro_lenet5_fatfs(), which reports it.
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DMA_LENET5_CORO_H
+#define DMA_LENET5_CORO_H
+
+#include "xil_types.h"
+#include "dma_LeNet5_dev.h"
+#include "dma_LeNet5_result.h"
+
+// image loader of the driver loop: reads image img into infmap_bus (DMA buffer)
+typedef void (*coro_load_fn)(void* ctx, const int img, u64* infmap_bus);
+
+// runs loop_num images through every instance, hw_class[img] = class
+// (RESULT_DROP_CLASS if its result was lost), image img is seq img of ring.
+// returns false if the build has no coroutine support.
+bool run_coro_lenet5_fatfs (lenet5_dev* devs, const int dev_num, dma_pool* infmap_pool, result_ring* ring,
+                            const u64* rdma_param, coro_load_fn load, void* load_ctx,
+                            const int loop_num, u8* hw_class);
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+
+#define CORO_WAIT_MAX   16  // parked awaiters
+#define CORO_TASK_MAX   16  // root coroutines
+
+struct coro_sched;
+
+// fire-and-forget root coroutine, started and destroyed by coro_sched
+struct coro_task {
+    struct promise_type {
+        coro_task get_return_object () { return coro_task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend () noexcept { return {}; }
+        std::suspend_always final_suspend () noexcept { return {}; }
+        void return_void () {}
+        void unhandled_exception () {}
+    };
+    std::coroutine_handle<promise_type> handle;
+};
+
+// awaiter parked in the scheduler until poll() returns true
+struct coro_awaiter {
+    coro_sched* sched;
+    std::coroutine_handle<> handle;
+    virtual bool poll () = 0;
+    bool await_ready () { return poll(); }
+    void await_suspend (std::coroutine_handle<> h);
+};
+
+struct coro_sched {
+    coro_awaiter* wait[CORO_WAIT_MAX];
+    int           wait_num;
+    std::coroutine_handle<> task[CORO_TASK_MAX];
+    int           task_num;
+
+    void spawn (coro_task t);
+    void run ();   // until every spawned coroutine has returned
+};
+
+struct coro_core {
+    lenet5_dev*    dev;
+    int            owner;     // result tracker owner, the instance index
+    coro_sched*    sched;
+    result_ring*   ring;      // shared by every instance
+    u8*            out_class; // class per seq, written by the tracker
+    bool           is_busy;   // an awaiter owns the instance
+    u32            issue_num; // infer() calls, in seq order
+    u32            start_num; // images started, they start in issue order
+    unsigned long  done_num;
+
+    struct param_awaiter : coro_awaiter {
+        coro_core* core;
+        const u64* rdma_param;
+        int        state;
+        bool poll () override;
+        void await_resume () {}
+    };
+    struct infer_awaiter : coro_awaiter {
+        coro_core* core;
+        const u64* infmap_bus;
+        u32        seq;
+        u32        ticket;     // start order on the instance
+        u64*       wdma_slot;  // NULL: no result slot, the image fails
+        int        state;
+        XTime      start_time;
+        bool poll () override;
+        int  await_resume () { return core->out_class[seq]; }
+    };
+
+    param_awaiter load_params (const u64* rdma_param);
+    infer_awaiter infer (const u64* infmap_bus, const u32 seq);  // call in seq order
+};
+
+void coro_core_init (coro_core* core, lenet5_dev* dev, const int owner, coro_sched* sched,
+                     result_ring* ring, u8* out_class);
+#endif
+
+#endif
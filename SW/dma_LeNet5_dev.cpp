@@ -0,0 +1,189 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.09
+// Design Name:
+// Module Name: dma_LeNet5_dev.cpp
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: dma_LeNet5_top device table
+// Dependencies: xil_io.h
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "xil_io.h"
+#include "xil_printf.h"
+#include "dma_LeNet5_dev.h"
+
+void ewma_update (XTime& avg, const XTime sample, const unsigned long num) {
+    if (num < EWMA_COLD_NUM) {
+        return;
+    }
+    if (avg == 0) {
+        avg = sample;
+    } else {
+        avg = avg - avg / EWMA_DIV + sample / EWMA_DIV;
+    }
+}
+
+void dev_init (
+    lenet5_dev* dev,
+    const UINTPTR base,
+    dma_pool* infmap_pool
+) {
+    dev->base        = base;
+    dev->infmap_pool = infmap_pool;
+    dev->ring_done   = 0;
+    dev->ring_start  = 0;
+    dev->ring_tail   = 0;
+    dev->start_time  = 0;
+    dev->done_time   = 0;
+    dev->last_time   = 0;
+    dev->svc_time    = 0;
+    dev->done_num    = 0;
+}
+
+void dev_config (
+    lenet5_dev* dev,
+    const u64* rdma_param
+) {
+    Xil_Out32(dev->base + ADDR_AXI00_PTR0_DATA_0, (u32)(0x00000000)); // base addr no use now.
+    Xil_Out32(dev->base + ADDR_RDMA_MEM_PTR_PARAM_0, (u32)(UINTPTR)rdma_param);
+    Xil_Out32(dev->base + ADDR_RDMA_MEM_PTR_INFMAP_0, (u32)(UINTPTR)dev->infmap_pool->base);
+}
+
+u32 dev_ctrl (const lenet5_dev* dev) {
+    return Xil_In32(dev->base + ADDR_AP_CTRL);
+}
+
+void dev_load_param_all (
+    lenet5_dev* devs,
+    const int dev_num
+) {
+    for (int i = 0; i < dev_num; i++) {
+        while ((dev_ctrl(&devs[i]) & CTRL_IDLE_MASK) != CTRL_IDLE_MASK); // IDLE
+    }
+    // every instance reads the same packed image, their RDMA bursts overlap
+    for (int i = 0; i < dev_num; i++) {
+        Xil_Out32(devs[i].base + ADDR_AP_CTRL, (u32)(CTRL_START_PARAM_MASK));
+    }
+    for (int i = 0; i < dev_num; i++) {
+        while ((dev_ctrl(&devs[i]) & CTRL_DONE_MASK) != CTRL_DONE_MASK); // DONE
+    }
+}
+
+int dev_queue_num (const lenet5_dev* dev) {
+    return dev->ring_tail - dev->ring_done;
+}
+
+bool dev_has_room (const lenet5_dev* dev) {
+    return (dev_queue_num(dev) < INFMAP_RING_NUM) && (dev->infmap_pool->free_num > 0);
+}
+
+bool dev_enqueue (
+    lenet5_dev* dev,
+    const int img,
+    u64* infmap_buf,
+    u64* wdma_slot
+) {
+    if (dev_queue_num(dev) >= INFMAP_RING_NUM) {
+        return false;
+    }
+    int slot = dev->ring_tail % INFMAP_RING_NUM;
+    dev->ring_buf[slot]  = infmap_buf;
+    dev->ring_img[slot]  = img;
+    dev->ring_wdma[slot] = wdma_slot;
+    dev->ring_tail++;
+    return true;
+}
+
+bool dev_is_busy (const lenet5_dev* dev) {
+    return dev->ring_done != dev->ring_start;
+}
+
+int dev_start (lenet5_dev* dev) {
+    if (dev_is_busy(dev) || (dev->ring_start == dev->ring_tail)) {
+        return -1;
+    }
+    int slot = dev->ring_start % INFMAP_RING_NUM;
+    int img  = dev->ring_img[slot];
+    Xil_Out32(dev->base + ADDR_RDMA_MEM_PTR_INFMAP_0, (u32)(UINTPTR)dev->ring_buf[slot]);
+    // wdma.v writes the result beat at its base pointer, one slot per image
+    Xil_Out32(dev->base + ADDR_WDMA_MEM_PTR_DATA_0, (u32)(UINTPTR)dev->ring_wdma[slot]);
+    XTime_GetTime(&dev->start_time);
+    dev->done_time = 0;
+    Xil_Out32(dev->base + ADDR_AP_CTRL, (u32)(CTRL_START_INFMAP_MASK));
+    dev->ring_start++;
+    return img;
+}
+
+// reading AP_CTRL clears DONE, so a DONE seen here is kept in done_time
+static bool dev_is_done (lenet5_dev* dev) {
+    if (dev->done_time != 0) {
+        return true;
+    }
+    if ((dev_ctrl(dev) & CTRL_DONE_MASK) != CTRL_DONE_MASK) {
+        return false;
+    }
+    XTime_GetTime(&dev->done_time);
+    return true;
+}
+
+int dev_poll (lenet5_dev* dev) {
+    if (!dev_is_busy(dev) || !dev_is_done(dev)) {
+        return -1;
+    }
+    dev->last_time = dev->done_time - dev->start_time;
+    ewma_update(dev->svc_time, dev->last_time, dev->done_num);
+    dev->done_num++;
+    int slot = dev->ring_done % INFMAP_RING_NUM;
+    pool_put(dev->infmap_pool, dev->ring_buf[slot]);  // RDMA is done with it
+    dev->ring_done++;
+    return dev->ring_img[slot];
+}
+
+void dev_stamp_all (
+    lenet5_dev* devs,
+    const int dev_num
+) {
+    for (int i = 0; i < dev_num; i++) {
+        if (dev_is_busy(&devs[i])) {
+            dev_is_done(&devs[i]);
+        }
+    }
+}
+
+u64* dev_running_buf (const lenet5_dev* dev) {
+    return dev_is_busy(dev) ? dev->ring_buf[dev->ring_done % INFMAP_RING_NUM] : NULL;
+}
+
+int dev_pick (
+    lenet5_dev* devs,
+    const int dev_num,
+    const dev_policy policy,
+    const int img
+) {
+    if (policy == DEV_ROUND_ROBIN) {
+        int i = img % dev_num;
+        return dev_has_room(&devs[i]) ? i : -1;
+    }
+    // unmeasured instances count as 1 tick per image, so they fill evenly
+    int pick = -1;
+    XTime pick_load = 0;
+    for (int i = 0; i < dev_num; i++) {
+        if (!dev_has_room(&devs[i])) {
+            continue;
+        }
+        XTime svc  = (devs[i].svc_time == 0) ? 1 : devs[i].svc_time;
+        XTime load = (XTime)(dev_queue_num(&devs[i]) + 1) * svc;
+        if ((pick < 0) || (load < pick_load)) {
+            pick = i;
+            pick_load = load;
+        }
+    }
+    return pick;
+}
@@ -0,0 +1,121 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.09
+// Design Name:
+// Module Name: dma_LeNet5_dev.h
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: dma_LeNet5_top device table. One entry per instance found in
+//              xparameters.h, each with its own register base, infmap queue
+//              and per-instance completion state. Infmap buffers come from a
+//              pool shared by every instance and go back to it at DONE.
+// Dependencies: xparameters.h, xil_io.h
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     An instance holds one image at a time: RDMA latches the infmap pointer
+//     at START_INFMAP and WDMA writes one result beat at its base pointer.
+//     The result slot of each queued image is assigned by the caller at
+//     enqueue time (see dma_LeNet5_result.h).
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DMA_LENET5_DEV_H
+#define DMA_LENET5_DEV_H
+
+#include "xparameters.h"
+#include "xil_types.h"
+#include "xtime_l.h"
+#include "dma_LeNet5_main.h"
+#include "dma_LeNet5_arena.h"
+
+#define AXI_DATA_BYTE    8 // 64 / 8
+#define IMG_CHUNK_NUM    16     // images read from SD per chunk
+#define INFMAP_RING_NUM  (2 * IMG_CHUNK_NUM)  // queue depth per instance: chunk k on HW, chunk k+1 on SD read
+#define INFMAP_BUS_NUM   (CONV1_ICH * CONV1_IY * (CONV1_IX / (B_COL_NUM)))  // 256 beats per image
+
+// REG MAP
+#define ADDR_AP_CTRL                    0x00
+#define ADDR_GIE                        0x04
+#define ADDR_IER                        0x08
+#define ADDR_ISR                        0x0c
+// #define ADDR_RDMA_TRANSFER_BYTE_DATA_0  0x10
+#define ADDR_RDMA_MEM_PTR_PARAM_0       0x14
+#define ADDR_RDMA_MEM_PTR_INFMAP_0      0x18
+#define ADDR_WDMA_MEM_PTR_DATA_0        0x1c
+#define ADDR_AXI00_PTR0_DATA_0          0x20
+
+#define CTRL_START_PARAM_MASK  1 << 0
+#define CTRL_DONE_MASK         1 << 1
+#define CTRL_IDLE_MASK         1 << 2
+#define CTRL_READY_MASK        1 << 3
+#define CTRL_START_INFMAP_MASK 1 << 4
+#define CTRL_DONE_WDMA_MASK    1 << 5
+#define CTRL_AUTO_RESTART_MASK 1 << 7
+
+// instances present in the hardware design
+static const UINTPTR lenet5_dev_base[] = {
+    XPAR_DMA_LENET5_TOP_0_BASEADDR,
+#ifdef XPAR_DMA_LENET5_TOP_1_BASEADDR
+    XPAR_DMA_LENET5_TOP_1_BASEADDR,
+#endif
+#ifdef XPAR_DMA_LENET5_TOP_2_BASEADDR
+    XPAR_DMA_LENET5_TOP_2_BASEADDR,
+#endif
+#ifdef XPAR_DMA_LENET5_TOP_3_BASEADDR
+    XPAR_DMA_LENET5_TOP_3_BASEADDR,
+#endif
+};
+#define LENET5_DEV_NUM  ((int)(sizeof(lenet5_dev_base) / sizeof(lenet5_dev_base[0])))
+
+enum dev_policy {
+    DEV_ROUND_ROBIN ,  // image i -> instance i % LENET5_DEV_NUM
+    DEV_LEAST_LOADED   // instance with the least queued work (queue length x service time)
+};
+
+// per-image service time estimate, EWMA with weight 1/EWMA_DIV.
+// the first EWMA_COLD_NUM samples (cold caches, first DMA) are left out and
+// the next one seeds the average; 0 means no estimate yet
+#define EWMA_DIV       8
+#define EWMA_COLD_NUM  1
+
+void ewma_update (XTime& avg, const XTime sample, const unsigned long num);
+
+struct lenet5_dev {
+    UINTPTR base;
+    dma_pool* infmap_pool;   // shared infmap buffers
+    u64*    ring_buf [INFMAP_RING_NUM];  // infmap buffer per ring slot
+    int     ring_img [INFMAP_RING_NUM];  // image index per ring slot
+    u64*    ring_wdma[INFMAP_RING_NUM];  // result slot per ring slot
+    int     ring_done;       // ring entries [ring_done, ring_start) are in flight (0 or 1)
+    int     ring_start;      // ring entries [ring_start, ring_tail) are queued
+    int     ring_tail;
+    XTime   start_time;      // START_INFMAP of the image in flight
+    XTime   done_time;       // DONE first seen of the image in flight, 0: not yet
+    XTime   last_time;       // start -> DONE of the last completed image
+    XTime   svc_time;        // EWMA of start -> DONE, 0: not measured
+    unsigned long done_num;
+};
+
+void dev_init (lenet5_dev* dev, const UINTPTR base, dma_pool* infmap_pool);
+void dev_config (lenet5_dev* dev, const u64* rdma_param);
+u32  dev_ctrl (const lenet5_dev* dev);  // AP_CTRL, reading clears DONE
+
+// parameter load, broadcast to every instance
+void dev_load_param_all (lenet5_dev* devs, const int dev_num);
+
+// infmap ring of one instance
+int  dev_queue_num (const lenet5_dev* dev);  // in flight + queued
+bool dev_has_room (const lenet5_dev* dev);  // queue slot and pool buffer free
+bool dev_enqueue (lenet5_dev* dev, const int img, u64* infmap_buf, u64* wdma_slot);  // infmap_buf from infmap_pool
+bool dev_is_busy (const lenet5_dev* dev);
+int  dev_start (lenet5_dev* dev);  // starts the oldest queued image, result to its wdma_slot
+int  dev_poll (lenet5_dev* dev);  // completed image index or -1, its buffer is released
+void dev_stamp_all (lenet5_dev* devs, const int dev_num);  // DONE time only, dev_poll consumes it
+u64* dev_running_buf (const lenet5_dev* dev);  // infmap buffer of the image in flight
+
+int  dev_pick (lenet5_dev* devs, const int dev_num, const dev_policy policy, const int img);
+
+#endif
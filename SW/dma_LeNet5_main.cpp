@@ -18,48 +18,95 @@
 #include <stdio.h>
 #include "xparameters.h"
 #include "xil_io.h"
+#include "xil_cache.h"
 #include "xtime_l.h"  // To measure of processing time
 #include <stdlib.h>	  // To generate rand value
+#include <string.h>
 #include <assert.h>
 #include "dma_LeNet5_main.h"
+#include "dma_LeNet5_sdio.h"
+#include "dma_LeNet5_prof.h"
+#include "dma_LeNet5_ref.h"
+#include "dma_LeNet5_dev.h"
+#include "dma_LeNet5_result.h"
+#include "dma_LeNet5_arena.h"
+#include "dma_LeNet5_coro.h"
+#include "dma_LeNet5_cache.h"
 
 // input data
 #define PARAM_READ 1
 #define HW_RUN 2
 #define CHECK 3
 #define TEST_MEM 4
+#define HETERO_RUN 5
+#define CORO_RUN 6
+#define CACHE_MODE 7
+#define SW_REF_MODE 8
 
-#define AXI_DATA_BYTE 8 // 64 / 8
-
-// REG MAP
-#define ADDR_AP_CTRL                    0x00
-#define ADDR_GIE                        0x04
-#define ADDR_IER                        0x08
-#define ADDR_ISR                        0x0c
-// #define ADDR_RDMA_TRANSFER_BYTE_DATA_0  0x10
-#define ADDR_RDMA_MEM_PTR_PARAM_0       0x14
-#define ADDR_RDMA_MEM_PTR_INFMAP_0      0x18
-#define ADDR_WDMA_MEM_PTR_DATA_0        0x1c
-#define ADDR_AXI00_PTR0_DATA_0          0x20
-
-#define CTRL_START_PARAM_MASK  1 << 0
-#define CTRL_DONE_MASK         1 << 1
-#define CTRL_IDLE_MASK         1 << 2
-#define CTRL_READY_MASK        1 << 3
-#define CTRL_START_INFMAP_MASK 1 << 4
-#define CTRL_DONE_WDMA_MASK    1 << 5
-#define CTRL_AUTO_RESTART_MASK 1 << 7
-
-#define LOOP_NUM  30
-
-#define USER_RDMA_INFMAP_ADDR  0x10000000
-#define USER_WDMA_MEM_ADDR     (USER_RDMA_INFMAP_ADDR + 2048)
-#define USER_RDMA_PARAM_ADDR   (USER_WDMA_MEM_ADDR + LOOP_NUM*8)
+#define MAX_LOOP_NUM     10000  // MNIST test set size
+
+// DDR window of every DMA region, carved by the arena at startup:
+// param header, param image, result ring, infmap pool (see the memory map print)
+#define USER_DMA_WINDOW_ADDR   0x10000000
+#define USER_DMA_WINDOW_BYTE   0x01000000  // 16 MB
+
+// packed parameter image header, placed right before the RDMA param region
+#define PARAM_HDR_BYTE        64
+#define PARAM_HDR_MAGIC       0x4c35504d  // "L5PM"
+#define PARAM_FORMAT_VERSION  2           // bump when the rd_param_fatfs packing or src_hash changes
+#define PARAM_FILE_NUM        10
+
+struct param_header {
+    u32 magic    ;
+    u32 version  ;
+    u32 beat_num ;  // NUM_RD_PARAM
+    u32 reserved ;
+    u64 src_hash ;  // contents of the SD param files
+    u64 data_hash;  // packed payload
+};
+
+// packed image file from the reference 'prep' tool (LeNet5_core_ip_prep.cpp):
+// header, img_num x u64 image hashes, then each image as INFMAP_BUS_NUM RDMA beats
+#define IMAGE_HDR_BYTE        64
+#define IMAGE_HDR_MAGIC       0x4c35494d  // "L5IM"
+#define IMAGE_FORMAT_VERSION  1
+#define IMAGE_TABLE_CHUNK     4096        // hash table bytes per SD view
+
+struct image_header {
+    u32 magic     ;
+    u32 version   ;
+    u32 img_num   ;
+    u32 beat_num  ;  // INFMAP_BUS_NUM
+    u32 beat_byte ;  // AXI_DATA_BYTE
+    u32 col_num   ;  // B_COL_NUM
+    u32 data_ofs  ;  // first image, sector aligned
+    u32 reserved  ;
+    u64 src_hash  ;  // IDX pixels
+    u64 table_hash;  // image hash table
+};
 
 #define FPGA_FREQ     100000000
 
+static dma_arena dma_mem;
+static dma_pool  infmap_pool;  // LENET5_DEV_NUM x INFMAP_RING_NUM image buffers
+
+// PS reference engine for the SW vs HW cross-check
+static ref_model sw_ref;
+static u8        sw_class[MAX_LOOP_NUM];   // SW_CLASS_NONE: not cross-checked
+static unsigned long sw_ref_every = 1;     // HW_RUN images per SW reference, 0: off
+// classes consumed from the WDMA result ring
+static result_ring wdma_ring;
+static u8          hw_class[MAX_LOOP_NUM];
+// HW_RUN result cache, off until enabled from the menu
+static result_cache img_cache;
+static bool         is_cache_on = false;
+// packed image file, NULL: images are preprocessed from the IDX file
+static sd_file*     fp_img_rdma = NULL;
+static image_header img_hdr;
+static u64          img_hash[MAX_LOOP_NUM];  // FNV-1a of the RDMA beats of each image
+
 void read_mnist_labels_fatfs (
-    FIL* fp_in_label,
+    sd_file* fp_in_label,
     int& label,
     const int image_index
 ) {
@@ -72,11 +119,14 @@ void read_mnist_labels_fatfs (
     }
 
     if (first_call) {
+        const u8* header = sd_view(fp_in_label, 0, 8);
+        if (header == NULL) {
+            xil_printf("Error: MNIST label header read failed.\n");
+            return;
+        }
         uint32_t magic;
-        UINT bytes_read;
-        f_lseek(fp_in_label, 0);
-        f_read(fp_in_label, &magic, 4, &bytes_read);
-        f_read(fp_in_label, &num_labels, 4, &bytes_read);
+        memcpy(&magic, header, 4);
+        memcpy(&num_labels, header + 4, 4);
 
         magic = __builtin_bswap32(magic);
         num_labels = __builtin_bswap32(num_labels);
@@ -96,18 +146,19 @@ void read_mnist_labels_fatfs (
     const int header_size = 8;
     const int offset = header_size + (image_index - 1);
 
-    f_lseek(fp_in_label, offset);
-
-    unsigned char label_byte;
-    UINT bytes_read;
-    f_read(fp_in_label, &label_byte, 1, &bytes_read);
-    label = static_cast<int>(label_byte);
+    // served from the read-ahead window, no per-label seek
+    const u8* label_byte = sd_view(fp_in_label, offset, 1);
+    if (label_byte == NULL) {
+        xil_printf("Label read error: idx %d\n", image_index);
+        return;
+    }
+    label = static_cast<int>(*label_byte);
 }
 
 void read_mnist_images_fatfs (
-    FIL* fp_in_infmap,
-    int8_t* infmap_qnt,
-    u64* infmap_bus
+    sd_file* fp_in_infmap,
+    u64* infmap_bus,
+    const int image_index
 ) {
     
     static bool first_call = true;
@@ -119,13 +170,16 @@ void read_mnist_images_fatfs (
     }
 
     if (first_call) {
+        const u8* header = sd_view(fp_in_infmap, 0, 16);
+        if (header == NULL) {
+            xil_printf("Error: MNIST image header read failed.\n");
+            return;
+        }
         uint32_t magic;
-        UINT bytes_read;
-        f_lseek(fp_in_infmap, 0);
-        f_read(fp_in_infmap, &magic, 4, &bytes_read);
-        f_read(fp_in_infmap, &num_images, 4, &bytes_read);
-        f_read(fp_in_infmap, &rows, 4, &bytes_read);
-        f_read(fp_in_infmap, &cols, 4, &bytes_read);
+        memcpy(&magic, header, 4);
+        memcpy(&num_images, header + 4, 4);
+        memcpy(&rows, header + 8, 4);
+        memcpy(&cols, header + 12, 4);
 
         magic = __builtin_bswap32(magic);
         num_images = __builtin_bswap32(num_images);
@@ -143,259 +197,422 @@ void read_mnist_images_fatfs (
         first_call = false;
     }
 
-    if (LOOP_NUM < 1 || LOOP_NUM > static_cast<int>(num_images)) {
-        xil_printf("Image index out of range: %d (valid range: 1 to %u)\n", LOOP_NUM, num_images);
+    if (image_index < 1 || image_index > static_cast<int>(num_images)) {
+        xil_printf("Image index out of range: %d (valid range: 1 to %u)\n", image_index, num_images);
         return;
     }
 
     const int image_size = 28 * 28;
     const int header_size = 16;
-    const int offset = header_size + (1 - 1) * image_size;
+    const unsigned long offset = header_size + (image_index - 1) * image_size;
 
-    f_lseek(fp_in_infmap, offset);
+    // view into the read-ahead window, ~20 images per SD transfer
+    const u8* pixel = sd_view(fp_in_infmap, offset, image_size);
+    if (pixel == NULL) {
+        xil_printf("Image read error: idx %d\n", image_index);
+        return;
+    }
 
     float normalized_pad = (0.0f - 0.1307f) / 0.3081f;
     int pad_value = static_cast<int>(std::round(normalized_pad * 32.0f));
     pad_value = std::max(-128, std::min(127, pad_value));
     
-    for (int loop = 0; loop < LOOP_NUM; ++loop) {
-        for (int iy = 0; iy < 32; ++iy) {
-            for (int ix = 0; ix < 32; ++ix) {
-                unsigned long index = (loop * CONV1_IY + iy) * CONV1_IX + ix;
+    int8_t infmap_qnt[CONV1_IY * CONV1_IX];
+    for (int iy = 0; iy < 32; ++iy) {
+        for (int ix = 0; ix < 32; ++ix) {
+            unsigned long index = iy * CONV1_IX + ix;
+            
+            if((ix >= 2) && (ix < 30) && (iy >= 2) && (iy < 30)) {
+                float normalized = (static_cast<float>(pixel[(iy-2)*28 + (ix-2)]) / 255.0f - 0.1307f) / 0.3081f;
                 
-                if((ix >= 2) && (ix < 30) && (iy >= 2) && (iy < 30)) {
-                    unsigned char pixel;
-                    UINT bytes_read;
-                    f_read(fp_in_infmap, &pixel, 1, &bytes_read);
-                    
-                    float normalized = (static_cast<float>(pixel) / 255.0f - 0.1307f) / 0.3081f;
-                    
-                    int quantized = static_cast<int>(std::round(normalized * 32.0f));
-                    
-                    quantized = std::max(-128, std::min(127, quantized));
-                    
-                    infmap_qnt[index] = static_cast<int8_t>(quantized);
-                } else {
-                    infmap_qnt[index] = static_cast<int8_t>(pad_value);
-                }
-                // xil_printf("index: %d, infmap_qnt: %02x ", index, (int8_t)(infmap_qnt[index] & 0xff));
+                int quantized = static_cast<int>(std::round(normalized * 32.0f));
+                
+                quantized = std::max(-128, std::min(127, quantized));
+                
+                infmap_qnt[index] = static_cast<int8_t>(quantized);
+            } else {
+                infmap_qnt[index] = static_cast<int8_t>(pad_value);
             }
-            // xil_printf("n");
         }
     }
     
     unsigned long addr_byte = 0;
-    for (int loop = 0; loop < LOOP_NUM; ++loop) {
-        for (int iy = 0; iy < CONV1_IY; iy++) {
-            for (int ix = 0; ix < CONV1_IX; ix += B_COL_NUM) {
-                u64 bus_data = 0;
-                for (int col = 0; col < B_COL_NUM; col++) {
-                    unsigned long index = (loop * CONV1_IY + iy) * CONV1_IX + (ix + col);
-                    bus_data |= ((u64)(infmap_qnt[index] & 0xff) << (col * 8));
-                    // xil_printf("index: %d, infmap_qnt: %02x ", index, (int8_t)(infmap_qnt[index] & 0xff));
-                }
-                infmap_bus[addr_byte] = bus_data;
-                // xil_printf("addr_byte: %08x infmap_baseaddr: %08x%08x \n", addr_byte, (u32)(infmap_bus[addr_byte] >> 32), (u32)infmap_bus[addr_byte]);
-                addr_byte++;
+    for (int iy = 0; iy < CONV1_IY; iy++) {
+        for (int ix = 0; ix < CONV1_IX; ix += B_COL_NUM) {
+            u64 bus_data = 0;
+            for (int col = 0; col < B_COL_NUM; col++) {
+                unsigned long index = iy * CONV1_IX + (ix + col);
+                bus_data |= ((u64)(infmap_qnt[index] & 0xff) << (col * 8));
             }
+            infmap_bus[addr_byte] = bus_data;
+            addr_byte++;
         }
-        // if(loop%100 == 0) {
-            // xil_printf("loop:%4d Write infmap_bus done! \n\n", loop);
-        // } 
     }
     
 }
 
-void rd_conv_weight_fatfs(
-    FIL* fp_in_weight,
+// parse the "0x.." field of one "(idx) 0x.., float" parameter line
+bool parse_hex_line (
+    const char* line,
+    const int len,
+    const int digits,
+    int& val
+) {
+    int pos = 0;
+    while ((pos + 1 < len) && !((line[pos] == '0') && (line[pos+1] == 'x'))) {
+        pos++;
+    }
+    if (pos + 2 + digits > len) {
+        return false;
+    }
+    val = 0;
+    for (int i = pos + 2; i < pos + 2 + digits; i++) {
+        char c = line[i];
+        int nibble;
+        if      ((c >= '0') && (c <= '9')) nibble = c - '0';
+        else if ((c >= 'a') && (c <= 'f')) nibble = c - 'a' + 10;
+        else if ((c >= 'A') && (c <= 'F')) nibble = c - 'A' + 10;
+        else return false;
+        val = (val << 4) | nibble;
+    }
+    return true;
+}
+
+bool rd_conv_weight_fatfs(
+    sd_file* fp_in_weight,
     int8_t* weight_qnt,  // Pointer to 1D array for quantized weights
     const int OCH,       // Output channels
     const int ICH,       // Input channels
     const int KY,        // Kernel height
     const int KX         // Kernel width
 ) {
-    char line[64];
     for (int och = 0; och < OCH; och++) {
         for (int ich = 0; ich < ICH; ich++) {
             for (int ky = 0; ky < KY; ky++) {
                 for (int kx = 0; kx < KX; kx++) {
-                    if (f_gets(line, sizeof(line), fp_in_weight) == NULL) {
+                    int len;
+                    const char* line = sd_gets(fp_in_weight, &len);
+                    if (line == NULL) {
                         xil_printf("weight: Unable to read line.\n");
+                        return false;
                     }
-                    char* pos = strstr(line, "0x");
-                    if (pos == NULL) {
+                    int val;
+                    if (!parse_hex_line(line, len, (WEIGHT_QNT_BW/4), val)) {
                         xil_printf("weight: Format error: '0x' not found.\n");
+                        return false;
                     }
-                    char* hex_str = pos + 2;
-                    if (strlen(hex_str) < 2) {
-                        xil_printf("weight: Hex string length error.\n");
-                    }
-                    int val = strtol(hex_str, NULL, 16);
                     int index = ((och * ICH + ich) * KY + ky) * KX + kx;
                     weight_qnt[index] = static_cast<int8_t>(val);
                 }
             }
         }
     }
+    return true;
 }
 
-void rd_fc_weight_fatfs(
-    FIL* fp_in_weight,
+bool rd_fc_weight_fatfs(
+    sd_file* fp_in_weight,
     int8_t* weight_qnt,  // Pointer to 1D array for quantized weights
     const int OCH,       // Output channels
     const int ICH        // Input channels
 ) {
-    char line[64];
     for (int och = 0; och < OCH; och++) {
         for (int ich = 0; ich < ICH; ich++) {
-            if (f_gets(line, sizeof(line), fp_in_weight) == NULL) {
+            int len;
+            const char* line = sd_gets(fp_in_weight, &len);
+            if (line == NULL) {
                 xil_printf("fc_weight: Unable to read line.\n");
+                return false;
             }
-            char* pos = strstr(line, "0x");
-            if (pos == NULL) {
+            int val;
+            if (!parse_hex_line(line, len, (WEIGHT_QNT_BW/4), val)) {
                 xil_printf("fc_weight: Format error: '0x' not found.\n");
+                return false;
             }
-            char* hex_str = pos + 2;
-            if (strlen(hex_str) < 2) {
-                xil_printf("fc_weight: Hex string length error.\n");
-            }
-            int val = strtol(hex_str, NULL, 16);
             unsigned long index = och * ICH + ich;
             weight_qnt[index] = static_cast<int8_t>(val);
         }
     }
+    return true;
 }
 
-void rd_bias_fatfs(
-    FIL* fp_in_bias,
+bool rd_bias_fatfs(
+    sd_file* fp_in_bias,
     int16_t* bias_qnt,  // Pointer to 1D array for quantized biases
     const int OCH       // Output channels
 ) {
-    char line[64];
     for (int och = 0; och < OCH; och++) {
-        if (f_gets(line, sizeof(line), fp_in_bias) == NULL) {
+        int len;
+        const char* line = sd_gets(fp_in_bias, &len);
+        if (line == NULL) {
             xil_printf("bias: Unable to read line.\n");
+            return false;
         }
-        char* pos = strstr(line, "0x");
-        if (pos == NULL) {
+        int val;
+        if (!parse_hex_line(line, len, (BIAS_QNT_BW/4), val)) {
             xil_printf("bias: Format error: '0x' not found.\n");
+            return false;
         }
-        char* hex_str = pos + 2;
-        if (strlen(hex_str) < 4) {
-            xil_printf("bias: Hex string length error.\n");
-        }
-        int val = strtol(hex_str, NULL, 16);
         bias_qnt[och] = static_cast<int16_t>(val);
     }
+    return true;
 }
 
-void rd_param_fatfs(
-    u64* rdma_baseaddr
-) {
-    xil_printf("Starting rd_param_fatfs...\n");
+static const char* param_path[PARAM_FILE_NUM] = {
+    FP_IN_CONV1_WEIGHT, FP_IN_CONV1_BIAS, FP_IN_CONV2_WEIGHT, FP_IN_CONV2_BIAS,
+    FP_IN_FC1_WEIGHT  , FP_IN_FC1_BIAS  , FP_IN_FC2_WEIGHT  , FP_IN_FC2_BIAS  ,
+    FP_IN_FC3_WEIGHT  , FP_IN_FC3_BIAS
+};
 
-    FATFS fatfs;
-    FIL fp_conv1_weight, fp_conv1_bias, fp_conv2_weight, fp_conv2_bias,
-        fp_fc1_weight, fp_fc1_bias, fp_fc2_weight, fp_fc2_bias,
-        fp_fc3_weight, fp_fc3_bias;
-    FRESULT res;
+// 64-bit FNV-1a
+#define FNV_OFFSET  0xcbf29ce484222325ULL
+#define FNV_PRIME   0x100000001b3ULL
 
-    // Mount the file system
-    res = f_mount(&fatfs, "0:/", 1);
-    if (res != FR_OK) {
-        xil_printf("Failed to mount SD card: %d\n", res);
-        return;
+u64 fnv1a_64 (
+    u64 hash,
+    const void* data,
+    const unsigned long len
+) {
+    const u8* byte = (const u8*)data;
+    for (unsigned long i = 0; i < len; i++) {
+        hash ^= byte[i];
+        hash *= FNV_PRIME;
     }
-    xil_printf("SD card mounted successfully.\n");
+    return hash;
+}
 
-    // Open all parameter files with error checking
-    res = f_open(&fp_conv1_weight, FP_IN_CONV1_WEIGHT, FA_READ);
-    if (res != FR_OK) {
-        xil_printf("Failed to open %s: %d\n", FP_IN_CONV1_WEIGHT, res);
-        return;
+// FNV-1a over 64-bit words, the image check costs one step per beat
+u64 fnv1a_64w (
+    u64 hash,
+    const u64* word,
+    const unsigned long num
+) {
+    for (unsigned long i = 0; i < num; i++) {
+        hash ^= word[i];
+        hash *= FNV_PRIME;
     }
-    res = f_open(&fp_conv1_bias, FP_IN_CONV1_BIAS, FA_READ);
-    if (res != FR_OK) {
-        xil_printf("Failed to open %s: %d\n", FP_IN_CONV1_BIAS, res);
-        return;
+    return hash;
+}
+
+// header and hash table of the packed image file
+bool rd_image_header_fatfs (
+    sd_file* fp
+) {
+    const u8* header = sd_view(fp, 0, sizeof(image_header));
+    if (header == NULL) {
+        return false;
     }
-    res = f_open(&fp_conv2_weight, FP_IN_CONV2_WEIGHT, FA_READ);
-    if (res != FR_OK) {
-        xil_printf("Failed to open %s: %d\n", FP_IN_CONV2_WEIGHT, res);
-        return;
+    memcpy(&img_hdr, header, sizeof(image_header));
+    const FSIZE_t table_byte = (FSIZE_t)img_hdr.img_num * sizeof(u64);
+    const FSIZE_t image_byte = (FSIZE_t)img_hdr.img_num * INFMAP_BUS_NUM * AXI_DATA_BYTE;
+    if ((img_hdr.magic != IMAGE_HDR_MAGIC) || (img_hdr.version != IMAGE_FORMAT_VERSION) ||
+        (img_hdr.beat_num != INFMAP_BUS_NUM) || (img_hdr.beat_byte != AXI_DATA_BYTE) || (img_hdr.col_num != B_COL_NUM) ||
+        (img_hdr.img_num == 0) || (img_hdr.img_num > MAX_LOOP_NUM) ||
+        (img_hdr.data_ofs < IMAGE_HDR_BYTE + table_byte) || (fp->size < img_hdr.data_ofs + image_byte)) {
+        xil_printf("Image file header mismatch: magic 0x%08x, version %u, %u beats x %u B \n",
+                   img_hdr.magic, img_hdr.version, img_hdr.beat_num, img_hdr.beat_byte);
+        return false;
     }
-    res = f_open(&fp_conv2_bias, FP_IN_CONV2_BIAS, FA_READ);
-    if (res != FR_OK) {
-        xil_printf("Failed to open %s: %d\n", FP_IN_CONV2_BIAS, res);
-        return;
+    for (FSIZE_t ofs = 0; ofs < table_byte; ofs += IMAGE_TABLE_CHUNK) {
+        const UINT len = (UINT)std::min<FSIZE_t>(IMAGE_TABLE_CHUNK, table_byte - ofs);
+        const u8* chunk = sd_view(fp, IMAGE_HDR_BYTE + ofs, len);
+        if (chunk == NULL) {
+            return false;
+        }
+        memcpy((u8*)img_hash + ofs, chunk, len);
     }
-    res = f_open(&fp_fc1_weight, FP_IN_FC1_WEIGHT, FA_READ);
-    if (res != FR_OK) {
-        xil_printf("Failed to open %s: %d\n", FP_IN_FC1_WEIGHT, res);
-        return;
+    if (fnv1a_64w(FNV_OFFSET, img_hash, img_hdr.img_num) != img_hdr.table_hash) {
+        xil_printf("Image file hash table mismatch \n");
+        return false;
     }
-    res = f_open(&fp_fc1_bias, FP_IN_FC1_BIAS, FA_READ);
-    if (res != FR_OK) {
-        xil_printf("Failed to open %s: %d\n", FP_IN_FC1_BIAS, res);
-        return;
+    return true;
+}
+
+// the packed image file when the SD card has a valid one, the IDX file otherwise
+sd_file* open_images_fatfs () {
+    FILINFO fno;
+    if (sd_stat(FP_IN_INFMAP_RDMA, &fno) == FR_OK) {
+        sd_file* fp = sd_open(FP_IN_INFMAP_RDMA);
+        if ((fp != NULL) && ((fp == fp_img_rdma) || rd_image_header_fatfs(fp))) {
+            fp_img_rdma = fp;
+            xil_printf("images: %s (%u packed images) \n", FP_IN_INFMAP_RDMA, img_hdr.img_num);
+            return fp;
+        }
+        xil_printf("%s is not usable, preprocessing %s \n", FP_IN_INFMAP_RDMA, FP_IN_INFMAP_BIN);
     }
-    res = f_open(&fp_fc2_weight, FP_IN_FC2_WEIGHT, FA_READ);
-    if (res != FR_OK) {
-        xil_printf("Failed to open %s: %d\n", FP_IN_FC2_WEIGHT, res);
+    fp_img_rdma = NULL;
+    return sd_open(FP_IN_INFMAP_BIN);
+}
+
+// one image into an infmap DMA buffer. a packed image is copied as is and
+// checked against its hash; images it does not hold, or fail the check, are
+// preprocessed from the IDX file
+void read_images_fatfs (
+    sd_file* fp_in_infmap,
+    u64* infmap_bus,
+    const int image_index
+) {
+    if ((fp_in_infmap == NULL) || (fp_in_infmap != fp_img_rdma)) {
+        read_mnist_images_fatfs(fp_in_infmap, infmap_bus, image_index);
         return;
     }
-    res = f_open(&fp_fc2_bias, FP_IN_FC2_BIAS, FA_READ);
-    if (res != FR_OK) {
-        xil_printf("Failed to open %s: %d\n", FP_IN_FC2_BIAS, res);
-        return;
+    if ((image_index >= 1) && (image_index <= (int)img_hdr.img_num)) {
+        const UINT image_byte = INFMAP_BUS_NUM * AXI_DATA_BYTE;
+        const u8* beat = sd_view(fp_in_infmap, img_hdr.data_ofs + (FSIZE_t)(image_index - 1) * image_byte, image_byte);
+        if (beat != NULL) {
+            memcpy(infmap_bus, beat, image_byte);
+            if (fnv1a_64w(FNV_OFFSET, infmap_bus, INFMAP_BUS_NUM) == img_hash[image_index - 1]) {
+                return;
+            }
+        }
+        xil_printf("Packed image %d is corrupt, preprocessing it \n", image_index);
     }
-    res = f_open(&fp_fc3_weight, FP_IN_FC3_WEIGHT, FA_READ);
-    if (res != FR_OK) {
-        xil_printf("Failed to open %s: %d\n", FP_IN_FC3_WEIGHT, res);
-        return;
+    read_mnist_images_fatfs(sd_open(FP_IN_INFMAP_BIN), infmap_bus, image_index);
+}
+
+// hash of the SD param file contents. size and FAT date / time (2 s) miss a
+// same-size edit or a copy that keeps the stamp, so the bytes are hashed; the
+// block reads cost far less than the text parse and pack they can skip
+bool param_src_hash (
+    u64& src_hash
+) {
+    const UINT chunk_byte = SD_BLOCK_BYTE - SD_SECTOR_BYTE;
+    src_hash = FNV_OFFSET;
+    for (int i = 0; i < PARAM_FILE_NUM; i++) {
+        sd_file* fp = sd_open(param_path[i]);
+        if ((fp == NULL) || !sd_invalidate(fp)) {
+            return false;
+        }
+        src_hash = fnv1a_64(src_hash, param_path[i], strlen(param_path[i]));
+        src_hash = fnv1a_64(src_hash, &fp->size, sizeof(fp->size));
+        for (FSIZE_t ofs = 0; ofs < fp->size; ofs += chunk_byte) {
+            const UINT len = (UINT)std::min<FSIZE_t>(chunk_byte, fp->size - ofs);
+            const u8* chunk = sd_view(fp, ofs, len);
+            if (chunk == NULL) {
+                return false;
+            }
+            src_hash = fnv1a_64(src_hash, chunk, len);
+        }
     }
-    res = f_open(&fp_fc3_bias, FP_IN_FC3_BIAS, FA_READ);
-    if (res != FR_OK) {
-        xil_printf("Failed to open %s: %d\n", FP_IN_FC3_BIAS, res);
-        return;
+    return true;
+}
+
+bool is_param_image_valid (
+    const param_header* header,
+    const u64* rdma_baseaddr,
+    const u64 src_hash
+) {
+    if ((header->magic != PARAM_HDR_MAGIC) || (header->version != PARAM_FORMAT_VERSION) ||
+        (header->beat_num != (NUM_RD_PARAM)) || (header->src_hash != src_hash)) {
+        return false;
+    }
+    // the payload may have been overwritten since the header was stamped
+    return header->data_hash == fnv1a_64(FNV_OFFSET, rdma_baseaddr, (NUM_RD_PARAM) * AXI_DATA_BYTE);
+}
+
+void wr_param_header (
+    param_header* header,
+    const u64* rdma_baseaddr,
+    const u64 src_hash
+) {
+    header->magic     = PARAM_HDR_MAGIC;
+    header->version   = PARAM_FORMAT_VERSION;
+    header->beat_num  = (NUM_RD_PARAM);
+    header->reserved  = 0;
+    header->src_hash  = src_hash;
+    header->data_hash = fnv1a_64(FNV_OFFSET, rdma_baseaddr, (NUM_RD_PARAM) * AXI_DATA_BYTE);
+}
+
+// parsed parameters before packing, staged in the DMA arena for one call
+struct param_staging {
+    int8_t  conv1_weight[CONV1_OCH * CONV1_ICH * CONV_KY * CONV_KX];
+    int16_t conv1_bias  [CONV1_OCH];
+    int8_t  conv2_weight[CONV2_OCH * CONV2_ICH * CONV_KY * CONV_KX];
+    int16_t conv2_bias  [CONV2_OCH];
+    int8_t  fc1_weight  [FC1_OCH * FC1_ICH];
+    int16_t fc1_bias    [FC1_OCH];
+    int8_t  fc2_weight  [FC2_OCH * FC2_ICH];
+    int16_t fc2_bias    [FC2_OCH];
+    int8_t  fc3_weight  [FC3_OCH * FC3_ICH];
+    int16_t fc3_bias    [FC3_OCH];
+};
+
+bool rd_param_fatfs(
+    u64* rdma_baseaddr,
+    dma_arena* arena
+) {
+    xil_printf("Starting rd_param_fatfs...\n");
+
+    // files stay open in the SD session; a re-read follows a source change,
+    // so the cached size and window are dropped first
+    sd_file* fp_param[PARAM_FILE_NUM];
+    for (int i = 0; i < PARAM_FILE_NUM; i++) {
+        fp_param[i] = sd_open(param_path[i]);
+        if ((fp_param[i] == NULL) || !sd_invalidate(fp_param[i])) {
+            return false;
+        }
     }
+    sd_file* fp_conv1_weight = fp_param[0];
+    sd_file* fp_conv1_bias   = fp_param[1];
+    sd_file* fp_conv2_weight = fp_param[2];
+    sd_file* fp_conv2_bias   = fp_param[3];
+    sd_file* fp_fc1_weight   = fp_param[4];
+    sd_file* fp_fc1_bias     = fp_param[5];
+    sd_file* fp_fc2_weight   = fp_param[6];
+    sd_file* fp_fc2_bias     = fp_param[7];
+    sd_file* fp_fc3_weight   = fp_param[8];
+    sd_file* fp_fc3_bias     = fp_param[9];
     xil_printf("All files opened successfully.\n");
 
-    // Define fixed-size 1D arrays for weights and biases
-    std::vector<int8_t> conv1_weight_qnt(CONV1_OCH * CONV1_ICH * CONV_KY * CONV_KX);
-    std::vector<int16_t> conv1_bias_qnt(CONV1_OCH);
-    std::vector<int8_t> conv2_weight_qnt(CONV2_OCH * CONV2_ICH * CONV_KY * CONV_KX);
-    std::vector<int16_t> conv2_bias_qnt(CONV2_OCH);
-    std::vector<int8_t> fc1_weight_qnt(FC1_OCH * FC1_ICH);
-    std::vector<int16_t> fc1_bias_qnt(FC1_OCH);
-    std::vector<int8_t> fc2_weight_qnt(FC2_OCH * FC2_ICH);
-    std::vector<int16_t> fc2_bias_qnt(FC2_OCH);
-    std::vector<int8_t> fc3_weight_qnt(FC3_OCH * FC3_ICH);
-    std::vector<int16_t> fc3_bias_qnt(FC3_OCH);
+    // fixed-size 1D arrays for weights and biases, released on return
+    UINTPTR arena_top = arena_mark(arena);
+    param_staging* stage = (param_staging*)arena_alloc(arena, "param staging", sizeof(param_staging));
+    if (stage == NULL) {
+        return false;
+    }
+    int8_t*  conv1_weight_qnt = stage->conv1_weight;
+    int16_t* conv1_bias_qnt   = stage->conv1_bias;
+    int8_t*  conv2_weight_qnt = stage->conv2_weight;
+    int16_t* conv2_bias_qnt   = stage->conv2_bias;
+    int8_t*  fc1_weight_qnt   = stage->fc1_weight;
+    int16_t* fc1_bias_qnt     = stage->fc1_bias;
+    int8_t*  fc2_weight_qnt   = stage->fc2_weight;
+    int16_t* fc2_bias_qnt     = stage->fc2_bias;
+    int8_t*  fc3_weight_qnt   = stage->fc3_weight;
+    int16_t* fc3_bias_qnt     = stage->fc3_bias;
 
     // Read data from files using FatFs functions
+    bool is_ok = true;
+    prof_begin(PROF_PARSE);
     xil_printf("Reading conv1 weights...\n");
-    rd_conv_weight_fatfs(&fp_conv1_weight, &conv1_weight_qnt[0], CONV1_OCH, CONV1_ICH, CONV_KY, CONV_KX);
+    is_ok &= rd_conv_weight_fatfs(fp_conv1_weight, conv1_weight_qnt, CONV1_OCH, CONV1_ICH, CONV_KY, CONV_KX);
     xil_printf("Reading conv1 biases...\n");
-    rd_bias_fatfs(&fp_conv1_bias, &conv1_bias_qnt[0], CONV1_OCH);
+    is_ok &= rd_bias_fatfs(fp_conv1_bias, conv1_bias_qnt, CONV1_OCH);
     xil_printf("Reading conv2 weights...\n");
-    rd_conv_weight_fatfs(&fp_conv2_weight, &conv2_weight_qnt[0], CONV2_OCH, CONV2_ICH, CONV_KY, CONV_KX);
+    is_ok &= rd_conv_weight_fatfs(fp_conv2_weight, conv2_weight_qnt, CONV2_OCH, CONV2_ICH, CONV_KY, CONV_KX);
     xil_printf("Reading conv2 biases...\n");
-    rd_bias_fatfs(&fp_conv2_bias, &conv2_bias_qnt[0], CONV2_OCH);
+    is_ok &= rd_bias_fatfs(fp_conv2_bias, conv2_bias_qnt, CONV2_OCH);
     xil_printf("Reading fc1 weights...\n");
-    rd_fc_weight_fatfs(&fp_fc1_weight, &fc1_weight_qnt[0], FC1_OCH, FC1_ICH);
+    is_ok &= rd_fc_weight_fatfs(fp_fc1_weight, fc1_weight_qnt, FC1_OCH, FC1_ICH);
     xil_printf("Reading fc1 biases...\n");
-    rd_bias_fatfs(&fp_fc1_bias, &fc1_bias_qnt[0], FC1_OCH);
+    is_ok &= rd_bias_fatfs(fp_fc1_bias, fc1_bias_qnt, FC1_OCH);
     xil_printf("Reading fc2 weights...\n");
-    rd_fc_weight_fatfs(&fp_fc2_weight, &fc2_weight_qnt[0], FC2_OCH, FC2_ICH);
+    is_ok &= rd_fc_weight_fatfs(fp_fc2_weight, fc2_weight_qnt, FC2_OCH, FC2_ICH);
     xil_printf("Reading fc2 biases...\n");
-    rd_bias_fatfs(&fp_fc2_bias, &fc2_bias_qnt[0], FC2_OCH);
+    is_ok &= rd_bias_fatfs(fp_fc2_bias, fc2_bias_qnt, FC2_OCH);
     xil_printf("Reading fc3 weights...\n");
-    rd_fc_weight_fatfs(&fp_fc3_weight, &fc3_weight_qnt[0], FC3_OCH, FC3_ICH);
+    is_ok &= rd_fc_weight_fatfs(fp_fc3_weight, fc3_weight_qnt, FC3_OCH, FC3_ICH);
     xil_printf("Reading fc3 biases...\n");
-    rd_bias_fatfs(&fp_fc3_bias, &fc3_bias_qnt[0], FC3_OCH);
+    is_ok &= rd_bias_fatfs(fp_fc3_bias, fc3_bias_qnt, FC3_OCH);
+    prof_end(PROF_PARSE);
+    if (!is_ok) {
+        xil_printf("Read Param Failed\n");
+        arena_release(arena, arena_top);
+        return false;
+    }
     xil_printf("Read Param Done\n");
 
+    prof_begin(PROF_PACK);
     unsigned long addr_byte = 0;
 
     // Store conv1 weights and biases
@@ -493,217 +710,652 @@ void rd_param_fatfs(
         addr_byte++;
     }
     xil_printf("FC3 Param Write Done \n");
+    prof_end(PROF_PACK);
 
-    // Close all files
-    f_close(&fp_conv1_weight);
-    f_close(&fp_conv1_bias);
-    f_close(&fp_conv2_weight);
-    f_close(&fp_conv2_bias);
-    f_close(&fp_fc1_weight);
-    f_close(&fp_fc1_bias);
-    f_close(&fp_fc2_weight);
-    f_close(&fp_fc2_bias);
-    f_close(&fp_fc3_weight);
-    f_close(&fp_fc3_bias);
-
-    // Unmount the file system
-    f_mount(NULL, "0:/", 1);
+    arena_release(arena, arena_top);
+    return true;
 }
 
-void run_hw_lenet5_fatfs(u64* wdma_baseaddr, u64* infmap_baseaddr, u64* infmap_bus) {
-    xil_printf("Starting run_hw_lenet5_fatfs...\n");
+// SW reference of HW_RUN. It runs after the timed HW loop, so the loop only
+// polls, restarts and reads ahead, and start->done is the core's time. Every
+// sw_ref_every-th image is read again and inferred on the PS; the misses the
+// run put in the result cache get its FC3 outputs.
+#define SW_CLASS_NONE  0xfe
+
+static bool      is_img_miss[MAX_LOOP_NUM];  // HW_RUN image went to HW with the cache on
+static cache_key img_key    [MAX_LOOP_NUM];
+
+unsigned long run_sw_ref_fatfs(
+    sd_file* fp_in_infmap,
+    const int loop_num,
+    const unsigned long every,
+    const ref_model* ref,
+    u8* sw_class,
+    result_cache* cache     // NULL: the run had the cache off
+) {
+    static u64 infmap_bus[INFMAP_BUS_NUM];
+    int8_t logit[REF_CLASS_NUM];
+    unsigned long ref_num = 0;
+    for (int img = 0; img < loop_num; img++) {
+        sw_class[img] = SW_CLASS_NONE;
+        if ((every == 0) || (img % every != 0)) {
+            continue;
+        }
+        read_images_fatfs(fp_in_infmap, infmap_bus, img+1);
+        sw_class[img] = (u8)ref_infer(ref, infmap_bus, logit);
+        if ((cache != NULL) && is_img_miss[img]) {
+            cache_set_logit(cache, img_key[img], logit);
+        }
+        ref_num++;
+    }
+    return ref_num;
+}
 
-    u32 read_data;
+void run_hw_lenet5_fatfs(
+    lenet5_dev* devs,
+    const int dev_num,
+    const dev_policy policy,
+    result_ring* ring,
+    sd_file* fp_in_infmap,
+    const int loop_num,
+    u8* hw_class,
+    result_cache* cache     // NULL: every image runs on HW
+) {
+    xil_printf("Starting run_hw_lenet5_fatfs...\n");
 
-    int rd_loop = 0;
-    // int wr_loop = 0;
-    int rd_loop_ready = 0;
-    unsigned long addr_loop = 0;
+    int sd_loop  = 0; // images read from SD into an instance ring
+    int done_num = 0; // images completed by their instance or the cache
+    int fill_seq = 0; // results before fill_seq are in the cache
+    bool is_wait = false;
     
-    // read wait
-    while (1) {
+    // results are consumed as their beats land, in any order across instances
+    while ((int)ring->head < loop_num) {
+        
+        // completion per instance
+        for (int i = 0; i < dev_num; i++) {
+            int img = dev_poll(&devs[i]);
+            if (img >= 0) {
+                result_done(ring, img);
+                prof_add(PROF_RUN, devs[i].last_time);
+                prof_image(devs[i].last_time);
+                done_num++;
+            }
+        }
+        result_poll(ring, hw_class);
+        // remember the consumed misses before their slots are issued again
+        for (; (cache != NULL) && (fill_seq < (int)ring->head); fill_seq++) {
+            if (is_img_miss[fill_seq] && (hw_class[fill_seq] != RESULT_DROP_CLASS)) {
+                cache_insert(cache, img_key[fill_seq], hw_class[fill_seq], NULL);
+            }
+        }
+        if ((done_num == loop_num) && !is_wait) {
+            // write wait, the result beat follows DONE on each WDMA channel
+            prof_begin(PROF_RESULT_WAIT);
+            is_wait = true;
+        }
+        
+        // restart every idle instance with its next queued image
+        for (int i = 0; i < dev_num; i++) {
+            dev_start(&devs[i]);
+        }
+        
+        // read ahead one image into the ring of the instance picked by the policy,
+        // as long as its result slot is free and its cache fill is done.
+        // a cached image never reaches HW
+        if ((sd_loop < loop_num) && !result_ring_full(ring) &&
+            ((cache == NULL) || (sd_loop < fill_seq + RESULT_RING_NUM))) {
+            int pick = dev_pick(devs, dev_num, policy, sd_loop);
+            if (pick >= 0) {
+                u64* sd_slot = (u64*)pool_get(devs[pick].infmap_pool);
+                prof_begin(PROF_PREPROC);
+                read_images_fatfs(fp_in_infmap, sd_slot, sd_loop+1);
+                prof_end(PROF_PREPROC);
+                // the SD read is the longest step of a pass, keep the DONE times of it
+                dev_stamp_all(devs, dev_num);
 
-        if(rd_loop_ready == 0) {
-            
-            unsigned long addr_byte = 0;
-            for (int iy = 0; iy < CONV1_IY; iy++) {
-                for (int ixt = 0; ixt < 8; ixt++) {
-                    infmap_baseaddr[addr_byte] = infmap_bus[addr_loop + addr_byte];
-                    // xil_printf("addr:%08x infmap_baseaddr: %08x%08x \n", &infmap_baseaddr[addr_byte], (u32)(infmap_baseaddr[addr_byte] >> 32), (u32)infmap_baseaddr[addr_byte]);
-                    addr_byte++;
+                int cls;
+                bool is_hit = false;
+                is_img_miss[sd_loop] = false;
+                if (cache != NULL) {
+                    img_key[sd_loop]     = cache_key_of(cache, sd_slot);
+                    is_hit               = cache_lookup(cache, img_key[sd_loop], cls, NULL);
+                    is_img_miss[sd_loop] = !is_hit;
                 }
+                if (is_hit) {
+                    // the SW reference still checks the image after the run, not the cached class
+                    pool_put(devs[pick].infmap_pool, sd_slot);
+                    result_issue(ring, sd_loop, RESULT_OWNER_PS);
+                    result_put(ring, sd_loop, cls);
+                    done_num++;
+                } else {
+                    prof_begin(PROF_COPY);
+                    Xil_DCacheFlushRange((UINTPTR)sd_slot, INFMAP_BUS_NUM * AXI_DATA_BYTE);
+                    prof_end(PROF_COPY);
+                    dev_enqueue(&devs[pick], sd_loop, sd_slot, result_issue(ring, sd_loop, pick));
+                }
+                sd_loop++;
             }
-            addr_loop += CONV1_IY * 8;
-            rd_loop_ready = 1;
-            Xil_Out32((XPAR_DMA_LENET5_TOP_0_BASEADDR) + ADDR_AP_CTRL, (u32)(CTRL_START_INFMAP_MASK));
-            rd_loop++;
-            // xil_printf("(idx: %0d) Write Test Image done! \n", rd_loop);
         }
-        
-        while (1) {
-            read_data = Xil_In32((XPAR_DMA_LENET5_TOP_0_BASEADDR) + ADDR_AP_CTRL);
-            // xil_printf("read_data:  %08x\n", read_data);
-            if((read_data & CTRL_DONE_MASK) == CTRL_DONE_MASK) {
-                // xil_printf("(idx: %0d) Start Test Image! \n", rd_loop + 1);
-                rd_loop_ready = 0;
-                break;
+    }
+    if (is_wait) {
+        prof_end(PROF_RESULT_WAIT);
+    }
+    for (; (cache != NULL) && (fill_seq < loop_num); fill_seq++) {
+        if (is_img_miss[fill_seq] && (hw_class[fill_seq] != RESULT_DROP_CLASS)) {
+            cache_insert(cache, img_key[fill_seq], hw_class[fill_seq], NULL);
+        }
+    }
+    xil_printf("(idx: %0d) Hardware execution Done! \n", loop_num);
+
+    xil_printf("HW Run Done!");
+}
+
+struct hetero_stat {
+    XTime         pl_time[LENET5_DEV_NUM];  // PL start -> DONE, per instance
+    XTime         ps_time;                  // PS ref_infer
+    unsigned long pl_num [LENET5_DEV_NUM];
+    unsigned long ps_num;
+};
+
+// Splits an image stream between every PL instance and the PS reference engine.
+// Each instance holds at most one image and an idle one is always fed. While
+// all of them run, the PS takes the next image when it would finish it no later
+// than the earliest instance could (its remaining time plus its service time,
+// earliest finish time on the measured service times), otherwise it reads ahead
+// from SD. All engines write into the same result ring, the PS with its image
+// index as record seq.
+void run_hetero_lenet5_fatfs(
+    lenet5_dev* devs,
+    const int dev_num,
+    result_ring* ring,
+    sd_file* fp_in_infmap,
+    const int loop_num,
+    const ref_model* ref,
+    hetero_stat& stat,
+    u8* hw_class
+) {
+    xil_printf("Starting run_hetero_lenet5_fatfs...\n");
+
+    dma_pool* pool = devs[0].infmap_pool;  // shared by every instance
+    u64* img_buf[INFMAP_RING_NUM];  // pool buffer of image i at i % INFMAP_RING_NUM
+    int  sd_loop   = 0;     // images read into a pool buffer
+    int  next      = 0;     // next image to assign
+    int  pl_img      [LENET5_DEV_NUM];  // image on instance i, -1: idle
+    bool is_pl_shared[LENET5_DEV_NUM];  // the PS ran an image during the current image of i
+
+    for (int i = 0; i < dev_num; i++) {
+        pl_img[i] = -1;
+        is_pl_shared[i] = false;
+        stat.pl_time[i] = 0;
+        stat.pl_num[i] = 0;
+    }
+    stat.ps_num = 0;
+    stat.ps_time = 0;
+
+    while ((int)ring->head < loop_num) {
+        XTime now;
+
+        // PL completion: dev_poll() releases the image buffer, the result beat
+        // follows DONE on the WDMA channel and the tracker picks it up
+        int oldest = next;
+        for (int i = 0; i < dev_num; i++) {
+            int img = dev_poll(&devs[i]);
+            if (img >= 0) {
+                prof_add(PROF_RUN, devs[i].last_time);
+                prof_image(devs[i].last_time);
+                // DONE is seen late when the PS ran meanwhile, keep only polled samples
+                if (!is_pl_shared[i] || (stat.pl_time[i] == 0)) {
+                    ewma_update(stat.pl_time[i], devs[i].last_time, stat.pl_num[i]);
+                }
+                stat.pl_num[i]++;
+                result_done(ring, img);
+                pl_img[i] = -1;
+            }
+            if ((pl_img[i] >= 0) && (pl_img[i] < oldest)) {
+                oldest = pl_img[i];
+            }
+        }
+        result_poll(ring, hw_class);
+
+        // keep the read-ahead ahead of the dispatcher. a buffer is free once its image is done
+        bool is_slot_free = (sd_loop < loop_num) && (sd_loop < oldest + INFMAP_RING_NUM) && (pool->free_num > 0);
+        bool is_next_ready = (next < sd_loop);
+
+        if (!is_next_ready && is_slot_free) {
+            u64* sd_slot = (u64*)pool_get(pool);
+            img_buf[sd_loop % INFMAP_RING_NUM] = sd_slot;
+            prof_begin(PROF_PREPROC);
+            read_images_fatfs(fp_in_infmap, sd_slot, sd_loop+1);
+            prof_end(PROF_PREPROC);
+            prof_begin(PROF_COPY);
+            Xil_DCacheFlushRange((UINTPTR)sd_slot, INFMAP_BUS_NUM * AXI_DATA_BYTE);
+            prof_end(PROF_COPY);
+            sd_loop++;
+            continue;
+        }
+        if (!is_next_ready || result_ring_full(ring)) {
+            continue;  // only PL images are left, or every result slot is pending
+        }
+
+        u64* slot = img_buf[next % INFMAP_RING_NUM];
+
+        // an idle instance: always feed it
+        int idle = -1;
+        for (int i = 0; (i < dev_num) && (idle < 0); i++) {
+            if (pl_img[i] < 0) {
+                idle = i;
             }
         }
-        if(rd_loop >= LOOP_NUM) {
-            break;
+        if (idle >= 0) {
+            dev_enqueue(&devs[idle], next, slot, result_issue(ring, next, idle));
+            dev_start(&devs[idle]);
+            pl_img[idle] = next;
+            is_pl_shared[idle] = false;
+            next++;
+            continue;
         }
 
+        // every instance busy: PS takes the next image if it finishes first.
+        // instances without a sample yet are skipped, the first PS image is a calibration sample.
+        XTime_GetTime(&now);
+        bool  is_pl_known = false;
+        XTime pl_finish   = 0;
+        for (int i = 0; i < dev_num; i++) {
+            if (stat.pl_time[i] == 0) {
+                continue;
+            }
+            XTime pl_elapsed = now - devs[i].start_time;
+            XTime pl_remain  = (stat.pl_time[i] > pl_elapsed) ? (stat.pl_time[i] - pl_elapsed) : 0;
+            if (!is_pl_known || (pl_remain + stat.pl_time[i] < pl_finish)) {
+                pl_finish   = pl_remain + stat.pl_time[i];
+                is_pl_known = true;
+            }
+        }
+        bool is_ps_first = is_pl_known && ((stat.ps_time == 0) || (stat.ps_time <= pl_finish));
+        if (is_ps_first) {
+            prof_begin(PROF_SW_REF);
+            int cls = ref_infer(ref, slot, NULL);
+            prof_end(PROF_SW_REF);
+            XTime t_end;
+            XTime_GetTime(&t_end);
+            ewma_update(stat.ps_time, t_end - now, stat.ps_num);
+            stat.ps_num++;
+            for (int i = 0; i < dev_num; i++) {
+                is_pl_shared[i] = true;
+            }
+            result_issue(ring, next, RESULT_OWNER_PS);
+            result_put(ring, next, cls);
+            pool_put(pool, slot);
+            next++;
+        } else if (is_slot_free) {
+            u64* sd_slot = (u64*)pool_get(pool);
+            img_buf[sd_loop % INFMAP_RING_NUM] = sd_slot;
+            prof_begin(PROF_PREPROC);
+            read_images_fatfs(fp_in_infmap, sd_slot, sd_loop+1);
+            prof_end(PROF_PREPROC);
+            prof_begin(PROF_COPY);
+            Xil_DCacheFlushRange((UINTPTR)sd_slot, INFMAP_BUS_NUM * AXI_DATA_BYTE);
+            prof_end(PROF_COPY);
+            sd_loop++;
+        }
     }
-    
-    // write wait
-    while (1) {
-        if ((wdma_baseaddr[LOOP_NUM-1] & 0xffff0) == ((LOOP_NUM-1) << 4)) {
-            xil_printf("(idx: %0d) Hardware execution Done! \n", LOOP_NUM);
-            break;
-        } 
+
+    unsigned long pl_sum = 0;
+    for (int i = 0; i < dev_num; i++) {
+        pl_sum += stat.pl_num[i];
     }
-    
+    xil_printf("Hetero Run Done! PL: %lu images, PS: %lu images \n", pl_sum, stat.ps_num);
+}
 
-    xil_printf("HW Run Done!");
+// image loader of the coroutine client
+static void coro_load_image (
+    void* ctx,
+    const int img,
+    u64* infmap_bus
+) {
+    read_images_fatfs((sd_file*)ctx, infmap_bus, img+1);
+}
+
+// menu number in [lo, hi], other tokens are skipped. false: end of input
+static bool rd_menu_num (
+    unsigned long* num,
+    const unsigned long lo,
+    const unsigned long hi
+) {
+    while (1) {
+        const int ret = scanf("%lu", num);
+        if (ret == EOF) {
+            return false;
+        }
+        if (ret == 0) {
+            if (scanf("%*s") == EOF) {  // not a number, drop the token
+                return false;
+            }
+            continue;
+        }
+        if ((lo <= *num) && (*num <= hi)) {
+            return true;
+        }
+    }
 }
 
 int main() {
     XTime tStart, tEnd;
     
-    u64* rdma_param_baseaddr = (u64*) USER_RDMA_PARAM_ADDR;
-    u64* rdma_infmap_baseaddr = (u64*) USER_RDMA_INFMAP_ADDR;
-    u64* wdma_mam_baseaddr = (u64*) USER_WDMA_MEM_ADDR;
+    // the param image comes first, its address does not depend on the instance count
+    arena_init(&dma_mem, USER_DMA_WINDOW_ADDR, USER_DMA_WINDOW_BYTE);
+    param_header* param_hdr = (param_header*)arena_alloc(&dma_mem, "param header", PARAM_HDR_BYTE);
+    u64* rdma_param_baseaddr = (u64*)arena_alloc(&dma_mem, "param (RDMA)", (NUM_RD_PARAM) * AXI_DATA_BYTE);
+    u64* wdma_mam_baseaddr = (u64*)arena_alloc(&dma_mem, "result ring (WDMA)", RESULT_RING_NUM * AXI_DATA_BYTE);
+    bool is_pool_ok = pool_init(&infmap_pool, &dma_mem, "infmap pool (RDMA)",
+                                INFMAP_BUS_NUM * AXI_DATA_BYTE, LENET5_DEV_NUM * INFMAP_RING_NUM);
+    if ((param_hdr == NULL) || (rdma_param_baseaddr == NULL) || (wdma_mam_baseaddr == NULL) || !is_pool_ok) {
+        xil_printf("DMA window 0x%08x (%u B) is too small.\n", USER_DMA_WINDOW_ADDR, USER_DMA_WINDOW_BYTE);
+        return 1;
+    }
+    u64* rdma_infmap_baseaddr = (u64*)infmap_pool.base;
+    arena_report(&dma_mem);
+    unsigned long loop_num = 0;
+    lenet5_dev devs[LENET5_DEV_NUM];
+    for (int i = 0; i < LENET5_DEV_NUM; i++) {
+        dev_init(&devs[i], lenet5_dev_base[i], &infmap_pool);
+    }
+    cache_init(&img_cache);
+    bool is_sw_ref_ready = false;  // sw_ref holds the loaded parameters
+    bool is_sw_valid = false;      // sw_class holds the last HW_RUN
+    u32  last_run = 0;             // mode whose classes hw_class holds, 0: none
+    
+    // one SD session for every mode, files are opened on first use
+    prof_reset();
+    XTime_GetTime(&tStart);
+    sd_mount();
+    XTime_GetTime(&tEnd);
+    prof_report("startup", 0, tEnd - tStart);
             
     while (1) {
-        u32 case_num;
+        unsigned long case_num;
     	printf("======= LeNet-5 HW Accelerator ======\n");
     	printf("plz input run mode\n");
     	printf("1. READ Quantized LeNet-5 Parameter \n");
     	printf("2. HW RUN \n");
     	printf("3. CHECK SW vs HW result\n");
+    	printf("5. HETERO RUN (PL + PS) \n");
+    	printf("6. CORO RUN (coroutine client) \n");
+    	printf("7. RESULT CACHE on/off (%s) \n", is_cache_on ? "on" : "off");
+    	printf("8. SW REFERENCE of HW RUN (every %lu-th image, 0: off) \n", sw_ref_every);
     	printf("=====================================\n");
-        do{
-    		scanf("%lu",&case_num);
-    	}while( !( (0 < case_num) && (case_num <= 4) ) );
+        if (!rd_menu_num(&case_num, 1, 8)) {
+            return 0; // host stand-in: end of scripted input
+        }
 		
 		std::string s;
         // MODE: PARAM_READ
     	if (case_num == PARAM_READ){
-    	    printf("rdma_param_baseaddr : 0x%x\n", USER_RDMA_PARAM_ADDR);
+    	    printf("rdma_param_baseaddr : 0x%x\n", (u32)(UINTPTR)rdma_param_baseaddr);
             
     	    Xil_DCacheDisable(); // flush to external mem.
             
-            u32 read_data;
-    	    Xil_Out32((XPAR_DMA_LENET5_TOP_0_BASEADDR) + ADDR_AXI00_PTR0_DATA_0, (u32)(0x00000000)); // base addr no use now.
-	        Xil_Out32((XPAR_DMA_LENET5_TOP_0_BASEADDR) + ADDR_RDMA_MEM_PTR_PARAM_0, (u32) rdma_param_baseaddr );
-            Xil_Out32((XPAR_DMA_LENET5_TOP_0_BASEADDR) + ADDR_RDMA_MEM_PTR_INFMAP_0, (u32)rdma_infmap_baseaddr);
-            Xil_Out32((XPAR_DMA_LENET5_TOP_0_BASEADDR) + ADDR_WDMA_MEM_PTR_DATA_0, (u32)wdma_mam_baseaddr);
+            for (int i = 0; i < LENET5_DEV_NUM; i++) {
+                dev_config(&devs[i], rdma_param_baseaddr);
+            }
             xil_printf("Hardware registers configured.\n");
 
-            rd_param_fatfs(rdma_param_baseaddr);
+            prof_reset();
+            XTime tParam;
+            XTime_GetTime(&tParam);
             
-            while(1) {
-        		read_data = Xil_In32((XPAR_DMA_LENET5_TOP_0_BASEADDR) + ADDR_AP_CTRL);
-        	    if( (read_data & CTRL_IDLE_MASK) == CTRL_IDLE_MASK ) // IDLE
-        	    	break;
-        	}
+            // warm start: reuse the packed image in DDR if the SD files are unchanged
+            u64 src_hash;
+            bool is_src_ok = param_src_hash(src_hash);
+            if (is_src_ok && is_param_image_valid(param_hdr, rdma_param_baseaddr, src_hash)) {
+                printf("Parameter image in DDR is valid (v%d), skip SD parse. \n", PARAM_FORMAT_VERSION);
+            } else {
+                param_hdr->magic = 0; // invalid until packing completes
+                if (!rd_param_fatfs(rdma_param_baseaddr, &dma_mem)) {
+                    continue;
+                }
+                if (is_src_ok) {
+                    wr_param_header(param_hdr, rdma_param_baseaddr, src_hash);
+                }
+            }
+            ref_load_param(&sw_ref, rdma_param_baseaddr);
+            is_sw_ref_ready = true;
+            // cached results belong to one parameter image
+            cache_set_param(&img_cache, fnv1a_64(FNV_OFFSET, rdma_param_baseaddr, (NUM_RD_PARAM) * AXI_DATA_BYTE));
             
     	    XTime_GetTime(&tStart);
-        	Xil_Out32((XPAR_DMA_LENET5_TOP_0_BASEADDR) + ADDR_AP_CTRL, (u32)(CTRL_START_PARAM_MASK)); // Start !!
-         	while(1) {
-        		read_data = Xil_In32((XPAR_DMA_LENET5_TOP_0_BASEADDR) + ADDR_AP_CTRL);
-        	    if( (read_data & CTRL_DONE_MASK) == CTRL_DONE_MASK ) // DONE
-        	    	break;
-        	}
+            prof_begin(PROF_PARAM_DMA);
+            dev_load_param_all(devs, LENET5_DEV_NUM); // Start !!
     	    XTime_GetTime(&tEnd);
+            prof_end(PROF_PARAM_DMA);
         
 		    printf("HW Mem Copy function Time %.2f us.\n",
 		           1.0 * (tEnd - tStart) / (COUNTS_PER_SECOND/1000000));
+            prof_report("PARAM_READ", 0, tEnd - tParam);
     		printf("Parameter Data Read Success. \n");
     		printf("\n");
     	} 
         // MODE: HW_RUN
 		else if(case_num == HW_RUN){
-    	    printf("LOOP_NUM : 0%d\n", LOOP_NUM);
-    	    printf("rdma_infmap_baseaddr : 0x%x\n", USER_RDMA_INFMAP_ADDR);
-    	    printf("wdma_mem_baseaddr : 0x%x\n", USER_WDMA_MEM_ADDR);
-            
-            for (int loop = 0; loop < LOOP_NUM; loop++) {
-                wdma_mam_baseaddr[loop] = 0;
+    	    printf("plz input test image num (1 ~ %d)\n", MAX_LOOP_NUM);
+            if (!rd_menu_num(&loop_num, 1, MAX_LOOP_NUM)) {
+                return 0;
             }
+    	    printf("loop_num : %lu\n", loop_num);
+    	    printf("rdma_infmap_baseaddr : 0x%x (%d buffer pool)\n", (u32)(UINTPTR)rdma_infmap_baseaddr, infmap_pool.buf_num);
+    	    printf("wdma_mem_baseaddr : 0x%x (%d slot result ring)\n", (u32)(UINTPTR)wdma_mam_baseaddr, RESULT_RING_NUM);
             
-            // infmap file open
-            FATFS fatfs;
-            FIL fp_in_infmap;
-            FRESULT res;
+            result_ring_init(&wdma_ring, wdma_mam_baseaddr, RESULT_RING_NUM);
             
-            res = f_mount(&fatfs, "0:/", 1);
-            if (res != FR_OK) {
-                xil_printf("SD card mount failed: %d\n", res);
+            dev_policy policy = DEV_ROUND_ROBIN;
+            if (LENET5_DEV_NUM > 1) {
+                unsigned long policy_num;
+                printf("plz input dispatch policy (0: round-robin, 1: least-loaded)\n");
+                if (!rd_menu_num(&policy_num, 0, 1)) {
+                    return 0;
+                }
+                policy = (policy_num == 0) ? DEV_ROUND_ROBIN : DEV_LEAST_LOADED;
             }
-            xil_printf("SD card mounted successfully.\n");
-
-            res = f_open(&fp_in_infmap, FP_IN_INFMAP_BIN, FA_READ);
-            if (res != FR_OK) {
-                xil_printf("%s file open failed: %d\n", FP_IN_INFMAP_BIN, res);
-                f_mount(NULL, "0:/", 1);
+            for (int i = 0; i < LENET5_DEV_NUM; i++) {
+                devs[i].done_num = 0;
             }
-            xil_printf("MNIST image file opened successfully.\n");
             
-            // read infmap 
-            std::vector<int8_t>  infmap_qnt(LOOP_NUM * CONV1_IY * CONV1_IX);
-            std::vector<u64>  infmap_bus(LOOP_NUM * CONV1_IY * 8);
-            read_mnist_images_fatfs(&fp_in_infmap, &infmap_qnt[0], &infmap_bus[0]);
-            xil_printf("Read image file successfully.\n");
+            // infmap file open (cached in the SD session)
+            prof_reset();
+            sd_file* fp_in_infmap = open_images_fatfs();
+            if (fp_in_infmap == NULL) {
+                continue;
+            }
             
-            // run HW
+            // run HW, images are streamed from SD into the infmap ring
     	    XTime_GetTime(&tStart);
-    	    run_hw_lenet5_fatfs(wdma_mam_baseaddr, rdma_infmap_baseaddr, &infmap_bus[0]);
+    	    run_hw_lenet5_fatfs(devs, LENET5_DEV_NUM, policy, &wdma_ring, fp_in_infmap, loop_num,
+    	                        hw_class, is_cache_on ? &img_cache : NULL);
     	    XTime_GetTime(&tEnd);
 
 		    printf("HW Mem Copy function Time %.3f ms.\n",
 		           1.0 * (tEnd - tStart) / (COUNTS_PER_SECOND/1000));
+            for (int i = 0; i < LENET5_DEV_NUM; i++) {
+                printf("instance %d (0x%08x): %lu images, %.2f us/image \n", i, (u32)devs[i].base,
+                       devs[i].done_num, 1.0 * devs[i].svc_time / (COUNTS_PER_SECOND/1000000));
+            }
+            result_report(&wdma_ring);
+            if (is_cache_on) {
+                cache_report(&img_cache);
+            }
+            prof_report("HW_RUN", loop_num, tEnd - tStart);
             
-            f_close(&fp_in_infmap);
-            f_mount(NULL, "0:/", 1);
+            // SW cross-check, outside the timed run
+            last_run = HW_RUN;
+            is_sw_valid = is_sw_ref_ready && (sw_ref_every > 0);
+            if (is_sw_valid) {
+                XTime tRef0, tRef1;
+                XTime_GetTime(&tRef0);
+                unsigned long ref_num = run_sw_ref_fatfs(fp_in_infmap, loop_num, sw_ref_every, &sw_ref, sw_class,
+                                                         is_cache_on ? &img_cache : NULL);
+                XTime_GetTime(&tRef1);
+                printf("SW reference: %lu of %lu images (every %lu), %.2f us/image \n", ref_num, loop_num, sw_ref_every,
+                       1.0 * (tRef1 - tRef0) / ref_num / (COUNTS_PER_SECOND/1000000));
+            }
             
     		printf("HW Run Success. \n");
     		printf("\n");
     	} 
-        // MODE: CHECK
-		else if(case_num == CHECK){
+        // MODE: HETERO_RUN
+        else if(case_num == HETERO_RUN){
+            if (!is_sw_ref_ready) {
+                printf("Run PARAM_READ first. \n");
+                continue;
+            }
+    	    printf("plz input test image num (1 ~ %d)\n", MAX_LOOP_NUM);
+            if (!rd_menu_num(&loop_num, 1, MAX_LOOP_NUM)) {
+                return 0;
+            }
+    	    printf("loop_num : %lu\n", loop_num);
+
+            result_ring_init(&wdma_ring, wdma_mam_baseaddr, RESULT_RING_NUM);
+
+            prof_reset();
+            sd_file* fp_in_infmap = open_images_fatfs();
+            if (fp_in_infmap == NULL) {
+                continue;
+            }
+
+            hetero_stat stat;
+    	    XTime_GetTime(&tStart);
+            run_hetero_lenet5_fatfs(devs, LENET5_DEV_NUM, &wdma_ring, fp_in_infmap, loop_num, &sw_ref, stat, hw_class);
+    	    XTime_GetTime(&tEnd);
+            is_sw_valid = false;  // PS images have no independent SW result
+            last_run = HETERO_RUN;
 
-            FATFS fatfs;
-	        FIL fp_in_label;
-            FRESULT res;
+            for (int i = 0; i < LENET5_DEV_NUM; i++) {
+                printf("instance %d (0x%08x): %lu images (%.1f%%), %.2f us/image \n", i, (u32)devs[i].base,
+                       stat.pl_num[i], 100.0 * stat.pl_num[i] / loop_num, 1.0 * stat.pl_time[i] / (COUNTS_PER_SECOND/1000000));
+            }
+            printf("PS: %lu images (%.1f%%), %.2f us/image \n",
+                   stat.ps_num, 100.0 * stat.ps_num / loop_num, 1.0 * stat.ps_time / (COUNTS_PER_SECOND/1000000));
+            result_report(&wdma_ring);
+            prof_report("HETERO_RUN", loop_num, tEnd - tStart);
+    		printf("Hetero Run Success. \n");
+    		printf("\n");
+        }
+        // MODE: CORO_RUN
+        else if(case_num == CORO_RUN){
+            if (!is_sw_ref_ready) {
+                printf("Run PARAM_READ first. \n");
+                continue;
+            }
+    	    printf("plz input test image num (1 ~ %d)\n", MAX_LOOP_NUM);
+            if (!rd_menu_num(&loop_num, 1, MAX_LOOP_NUM)) {
+                return 0;
+            }
+    	    printf("loop_num : %lu\n", loop_num);
+
+            prof_reset();
+            sd_file* fp_in_infmap = open_images_fatfs();
+            if (fp_in_infmap == NULL) {
+                continue;
+            }
 
-            res = f_mount(&fatfs, "0:/", 1);
-            if (res != FR_OK) {
-                xil_printf("SD card mount failed: %d\n", res);
+            result_ring_init(&wdma_ring, wdma_mam_baseaddr, RESULT_RING_NUM);
+    	    XTime_GetTime(&tStart);
+            bool is_ok = run_coro_lenet5_fatfs(devs, LENET5_DEV_NUM, &infmap_pool, &wdma_ring, rdma_param_baseaddr,
+                                               coro_load_image, fp_in_infmap, loop_num, hw_class);
+    	    XTime_GetTime(&tEnd);
+            is_sw_valid = false;
+            last_run = CORO_RUN;
+            if (!is_ok) {
+                loop_num = 0;
+                continue;
+            }
+            result_report(&wdma_ring);
+            prof_report("CORO_RUN", loop_num, tEnd - tStart);
+    		printf("Coroutine Run Success. \n");
+    		printf("\n");
+        }
+        // MODE: CACHE_MODE
+        else if(case_num == CACHE_MODE){
+            is_cache_on = !is_cache_on;
+            printf("result cache %s \n", is_cache_on ? "on" : "off");
+            cache_report(&img_cache);
+    		printf("\n");
+        }
+        // MODE: SW_REF_MODE
+        else if(case_num == SW_REF_MODE){
+    	    printf("plz input SW reference interval of HW RUN (0: off, 1: every image ~ %d)\n", MAX_LOOP_NUM);
+            if (!rd_menu_num(&sw_ref_every, 0, MAX_LOOP_NUM)) {
+                return 0;
+            }
+            if (sw_ref_every == 0) printf("SW reference off \n");
+            else                   printf("SW reference every %lu-th image \n", sw_ref_every);
+    		printf("\n");
+        }
+        // MODE: CHECK
+		else if(case_num == CHECK){
+            if (loop_num == 0) {
+                printf("Run HW first. \n");
+                continue;
             }
-            xil_printf("SD card mounted successfully.\n");
 
-            res = f_open(&fp_in_label, FP_IN_LABEL_BIN, FA_READ);
-            if (res != FR_OK) {
-                xil_printf("%s file open failed: %d\n", FP_IN_LABEL_BIN, res);
-                f_mount(NULL, "0:/", 1);
+            sd_file* fp_in_label = sd_open(FP_IN_LABEL_BIN);
+            if (fp_in_label == NULL) {
+                continue;
             }
-            xil_printf("MNIST label file opened successfully.\n");
 
             double wrong = 0;
-            for(int loop = 0; loop < LOOP_NUM; loop++) {
+            double sw_wrong = 0;
+            unsigned long sw_num = 0;
+            unsigned long mismatch = 0;
+            unsigned long confusion[REF_CLASS_NUM+1][REF_CLASS_NUM+1] = {}; // [HW][SW], last row/col: invalid class
+            for(unsigned long loop = 0; loop < loop_num; loop++) {
                 int label;
-               read_mnist_labels_fatfs(&fp_in_label, label, loop+1);
-                int infer = (wdma_mam_baseaddr[loop] & 0xf);
+                read_mnist_labels_fatfs(fp_in_label, label, loop+1);
+                int infer = hw_class[loop];  // RESULT_DROP_CLASS if its result was dropped
                 if(label != infer){
-                    printf("loop:%d, label:%d, inference:%d \n", loop+1, label, infer);
+                    printf("loop:%lu, label:%d, inference:%d \n", loop+1, label, infer);
                     wrong++;
     		    }
+                if (is_sw_valid && (sw_class[loop] != SW_CLASS_NONE)) {
+                    int sw_infer = sw_class[loop];
+                    sw_num++;
+                    if (sw_infer != label) {
+                        sw_wrong++;
+                    }
+                    if (sw_infer != infer) {
+                        printf("loop:%lu, HW/SW mismatch, HW:%d SW:%d label:%d \n", loop+1, infer, sw_infer, label);
+                        mismatch++;
+                    }
+                    confusion[std::min(infer, REF_CLASS_NUM)][std::min(sw_infer, REF_CLASS_NUM)]++;
+                }
             }
-            f_close(&fp_in_label);
-            f_mount(NULL, "0:/", 1);
 
-    		printf("Test: %d, Accuracy: %f%% \n", LOOP_NUM, (LOOP_NUM*1.0 - wrong) / (LOOP_NUM*1.0) * 100);
+    		printf("Test: %lu, Accuracy: %f%% \n", loop_num, (loop_num*1.0 - wrong) / (loop_num*1.0) * 100);
+            if (is_sw_valid) {
+                printf("HW vs SW confusion matrix (row: HW class, col: SW class, x: invalid)\n");
+                printf("     ");
+                for (int sw = 0; sw <= REF_CLASS_NUM; sw++) {
+                    if (sw == REF_CLASS_NUM) printf("     x");
+                    else                     printf("%6d", sw);
+                }
+                printf("\n");
+                for (int hw = 0; hw <= REF_CLASS_NUM; hw++) {
+                    if (hw == REF_CLASS_NUM) printf("   x ");
+                    else                     printf("%4d ", hw);
+                    for (int sw = 0; sw <= REF_CLASS_NUM; sw++) {
+                        printf("%6lu", confusion[hw][sw]);
+                    }
+                    printf("\n");
+                }
+                printf("Accuracy  HW: %f%%  SW: %f%% (%lu cross-checked)  HW/SW mismatch: %lu \n",
+                       (loop_num*1.0 - wrong) / (loop_num*1.0) * 100,
+                       (sw_num*1.0 - sw_wrong) / (sw_num*1.0) * 100, sw_num, mismatch);
+            } else if ((last_run == HETERO_RUN) || (last_run == CORO_RUN)) {
+                // their results are only checked against the labels
+                printf("%s has no SW cross-check, only the label accuracy above is checked. \n",
+                       (last_run == HETERO_RUN) ? "HETERO_RUN" : "CORO_RUN");
+            } else {
+                printf("No SW reference results, run PARAM_READ before HW_RUN with SW REFERENCE on. \n");
+            }
     		printf("Check Inference Accuracy Success. \n");
     		printf("\n");
     	} 
@@ -713,17 +1365,17 @@ int main() {
             for (int loop = 0; loop < 5; loop++)
             {
                 printf("infmap[%3d]: %08x%08x \n", loop+1, (u32)(rdma_infmap_baseaddr[loop] >> 32), (u32)rdma_infmap_baseaddr[loop]);
-                printf("infmap_addr: %08x \n", &(rdma_infmap_baseaddr[loop]));
+                printf("infmap_addr: %08x \n", (u32)(UINTPTR)&(rdma_infmap_baseaddr[loop]));
             }
-            for (int loop = 0; loop < 100; loop++)
+            for (int loop = 0; loop < RESULT_RING_NUM; loop++)
             {
                 printf("wdma[%3d]: %08x%08x\n", loop+1, (u32)(wdma_mam_baseaddr[loop] >> 32), (u32)wdma_mam_baseaddr[loop]);
-                printf("wdma_addr: %08x \n", &(wdma_mam_baseaddr[loop]));
+                printf("wdma_addr: %08x \n", (u32)(UINTPTR)&(wdma_mam_baseaddr[loop]));
             }
             for (int loop = 0; loop < 5; loop++)
             {
                 printf("rdma[%3d]: %08x%08x\n", loop+1, (u32)(rdma_param_baseaddr[loop] >> 32), (u32)rdma_param_baseaddr[loop]);
-                printf("rdma_addr: %08x \n", &(rdma_param_baseaddr[loop]));
+                printf("rdma_addr: %08x \n", (u32)(UINTPTR)&(rdma_param_baseaddr[loop]));
             }
 
         }
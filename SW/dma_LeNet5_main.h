@@ -18,11 +18,11 @@
 #ifndef DMA_LENET5_MAIN_H
 #define DMA_LENET5_MAIN_H
 
-#include <c++/11.2.0/random>
-#include <c++/11.2.0/string>
-#include <c++/11.2.0/fstream>
-#include <c++/11.2.0/iostream>
-#include <c++/11.2.0/vector>
+#include <random>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <vector>
 #include "ff.h"
 #include "xil_printf.h"
 #include "ffconf.h"
@@ -262,6 +262,7 @@ struct layer_scale {
     
 // read file
 #define FP_IN_INFMAP_BIN    "0:/LeNet5/images"
+#define FP_IN_INFMAP_RDMA   "0:/LeNet5/img_rdma.bin"  // written by LeNet5_core_ip prep, optional
 #define FP_IN_LABEL_BIN     "0:/LeNet5/labels"
 
 #define FP_IN_CONV1_WEIGHT  "0:/LeNet5/c1_w.txt"
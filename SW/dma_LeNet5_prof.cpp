@@ -0,0 +1,131 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.05
+// Design Name:
+// Module Name: dma_LeNet5_prof.cpp
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: Firmware phase profiler
+// Dependencies: xtime_l.h
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Phases are inclusive and may overlap: PROF_RUN of image k contains the
+//     PROF_PREPROC of an image of the next chunk that is read while HW runs.
+//     PROF_SW_REF is only used by HETERO_RUN; the HW_RUN cross-check runs
+//     after the timed loop.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include "dma_LeNet5_prof.h"
+
+static const char* prof_phase_name[PROF_PHASE_NUM] = {
+    "mount", "file open", "parse", "pack", "param DMA",
+    "preprocess", "copy", "start->done", "result wait", "sw reference"
+};
+
+static XTime         prof_start [PROF_PHASE_NUM];
+static XTime         prof_total [PROF_PHASE_NUM];
+static unsigned long prof_count [PROF_PHASE_NUM];
+
+static unsigned long img_hist [PROF_HIST_BIN_NUM];
+static unsigned long img_count;
+static XTime         img_min;
+static XTime         img_max;
+static XTime         img_sum;
+
+static double ticks_to_us (const XTime ticks) {
+    return 1.0 * ticks / (COUNTS_PER_SECOND / 1000000);
+}
+
+void prof_reset () {
+    for (int i = 0; i < PROF_PHASE_NUM; i++) {
+        prof_total[i] = 0;
+        prof_count[i] = 0;
+    }
+    for (int i = 0; i < PROF_HIST_BIN_NUM; i++) {
+        img_hist[i] = 0;
+    }
+    img_count = 0;
+    img_min   = (XTime)-1;
+    img_max   = 0;
+    img_sum   = 0;
+}
+
+void prof_begin (const prof_phase phase) {
+    XTime_GetTime(&prof_start[phase]);
+}
+
+void prof_end (const prof_phase phase) {
+    XTime t_end;
+    XTime_GetTime(&t_end);
+    prof_total[phase] += t_end - prof_start[phase];
+    prof_count[phase]++;
+}
+
+void prof_add (const prof_phase phase, const XTime ticks) {
+    prof_total[phase] += ticks;
+    prof_count[phase]++;
+}
+
+void prof_image (const XTime latency) {
+    unsigned long bin = (unsigned long)(ticks_to_us(latency) / PROF_HIST_BIN_US);
+    if (bin >= PROF_HIST_BIN_NUM) {
+        bin = PROF_HIST_BIN_NUM - 1;
+    }
+    img_hist[bin]++;
+    img_count++;
+    img_sum += latency;
+    if (latency < img_min) img_min = latency;
+    if (latency > img_max) img_max = latency;
+}
+
+// upper edge of the bin holding the p-th percentile sample
+static double hist_percentile_us (const double p) {
+    unsigned long target = (unsigned long)(p * img_count + 0.999999);
+    unsigned long acc = 0;
+    for (int i = 0; i < PROF_HIST_BIN_NUM - 1; i++) {
+        acc += img_hist[i];
+        if (acc >= target) {
+            return 1.0 * (i + 1) * PROF_HIST_BIN_US;
+        }
+    }
+    return ticks_to_us(img_max);
+}
+
+void prof_report (const char* title, const unsigned long image_num, const XTime wall) {
+    printf("------- profile: %s -------\n", title);
+    printf("%-12s %8s %12s %10s\n", "phase", "count", "total(us)", "avg(us)");
+    for (int i = 0; i < PROF_PHASE_NUM; i++) {
+        if (prof_count[i] == 0) {
+            continue;
+        }
+        printf("%-12s %8lu %12.1f %10.2f\n", prof_phase_name[i], prof_count[i],
+               ticks_to_us(prof_total[i]), ticks_to_us(prof_total[i]) / prof_count[i]);
+    }
+    printf("wall: %.3f ms\n", ticks_to_us(wall) / 1000);
+
+    if (img_count != 0) {
+        printf("per-image latency (start->done): min %.2f us, avg %.2f us, p99 <= %.0f us, max %.2f us\n",
+               ticks_to_us(img_min), ticks_to_us(img_sum) / img_count,
+               hist_percentile_us(0.99), ticks_to_us(img_max));
+        if (wall != 0) {
+            printf("throughput: %.1f images/s\n", image_num / (ticks_to_us(wall) / 1000000));
+        }
+        printf("histogram (%d us bins):\n", PROF_HIST_BIN_US);
+        for (int i = 0; i < PROF_HIST_BIN_NUM; i++) {
+            if (img_hist[i] == 0) {
+                continue;
+            }
+            if (i == PROF_HIST_BIN_NUM - 1) {
+                printf("  >=%4d us : %lu\n", i * PROF_HIST_BIN_US, img_hist[i]);
+            } else {
+                printf("  %4d ~%4d us : %lu\n", i * PROF_HIST_BIN_US, (i + 1) * PROF_HIST_BIN_US, img_hist[i]);
+            }
+        }
+    }
+    printf("-------------------------------------\n");
+}
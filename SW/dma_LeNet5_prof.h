@@ -0,0 +1,49 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.05
+// Design Name:
+// Module Name: dma_LeNet5_prof.h
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: Firmware phase profiler. Each phase accumulates its time and
+//              call count; per-image latency is kept in a fixed histogram so
+//              a 10,000 image run needs no sample buffer.
+// Dependencies: xtime_l.h (global timer, or clock_gettime in the host stand-in)
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DMA_LENET5_PROF_H
+#define DMA_LENET5_PROF_H
+
+#include "xtime_l.h"
+
+enum prof_phase {
+    PROF_MOUNT       , // f_mount
+    PROF_OPEN        , // f_open
+    PROF_PARSE       , // text param file parse
+    PROF_PACK        , // param packing into the RDMA region
+    PROF_PARAM_DMA   , // START_PARAM -> DONE
+    PROF_PREPROC     , // image read, quantize, bus packing
+    PROF_COPY        , // infmap slot flush to DDR
+    PROF_RUN         , // START_INFMAP -> DONE
+    PROF_RESULT_WAIT , // last WDMA result
+    PROF_SW_REF      , // PS reference inference of HETERO_RUN
+    PROF_PHASE_NUM
+};
+
+#define PROF_HIST_BIN_NUM  128  // last bin is the overflow bin
+#define PROF_HIST_BIN_US   4    // 0 ~ 508 us in 4 us bins
+
+void prof_reset ();
+void prof_begin (const prof_phase phase);
+void prof_end (const prof_phase phase);
+void prof_add (const prof_phase phase, const XTime ticks);  // phase timed by the caller
+void prof_image (const XTime latency);   // one per-image latency sample
+void prof_report (const char* title, const unsigned long image_num, const XTime wall);
+
+#endif
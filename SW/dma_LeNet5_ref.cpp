@@ -0,0 +1,213 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.07
+// Design Name:
+// Module Name: dma_LeNet5_ref.cpp
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: Bit-exact reference engine for the PS
+// Dependencies: dma_LeNet5_main.h
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     Scale handling follows ref_cpp: int32 accumulation, bias << B_SHIFT,
+//     (acc + M_INV/2) >> log2(M_INV), ReLU, clamp to 127. The FC3 output is
+//     stored as int8 like fc3_otfmap_qnt before the argmax.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "dma_LeNet5_ref.h"
+
+#define REF_QMAX  127
+
+static int ref_log2 (int val) {
+    int shift = 0;
+    while ((1 << (shift + 1)) <= val) {
+        shift++;
+    }
+    return shift;
+}
+
+static void ref_unpack_conv (
+    const u64* rdma_param,
+    unsigned long& addr_byte,
+    int8_t* weight,
+    int16_t* bias,
+    const int OCH,
+    const int ICH
+) {
+    for (int och = 0; och < OCH; och++) {
+        for (int ich = 0; ich < ICH; ich++) {
+            for (int ky = 0; ky < CONV_KY; ky++) {
+                u64 bus_data = rdma_param[addr_byte];
+                for (int kx = 0; kx < CONV_KX; kx++) {
+                    weight[((och * ICH + ich) * CONV_KY + ky) * CONV_KX + kx] = (int8_t)(bus_data >> (kx * 8));
+                }
+                addr_byte++;
+            }
+        }
+    }
+    for (int och = 0; och < OCH; och++) {
+        bias[och] = (int16_t)rdma_param[addr_byte];
+        addr_byte++;
+    }
+}
+
+static void ref_unpack_fc (
+    const u64* rdma_param,
+    unsigned long& addr_byte,
+    int8_t* weight,
+    int16_t* bias,
+    const int OCH,
+    const int ICH,
+    const int ICH_T
+) {
+    for (int och = 0; och < OCH; och++) {
+        for (int ichb = 0; ichb < ICH; ichb += ICH_T) {
+            u64 bus_data = rdma_param[addr_byte];
+            for (int icht = 0; icht < ICH_T && (ichb + icht) < ICH; icht++) {
+                weight[och * ICH + (ichb + icht)] = (int8_t)(bus_data >> (icht * 8));
+            }
+            addr_byte++;
+        }
+    }
+    for (int och = 0; och < OCH; och++) {
+        bias[och] = (int16_t)rdma_param[addr_byte];
+        addr_byte++;
+    }
+}
+
+void ref_load_param (
+    ref_model* model,
+    const u64* rdma_param
+) {
+    unsigned long addr_byte = 0;
+    ref_unpack_conv(rdma_param, addr_byte, model->conv1_w, model->conv1_b, CONV1_OCH, CONV1_ICH);
+    ref_unpack_conv(rdma_param, addr_byte, model->conv2_w, model->conv2_b, CONV2_OCH, CONV2_ICH);
+    ref_unpack_fc(rdma_param, addr_byte, model->fc1_w, model->fc1_b, FC1_OCH, FC1_ICH, FC1_ICH_T);
+    ref_unpack_fc(rdma_param, addr_byte, model->fc2_w, model->fc2_b, FC2_OCH, FC2_ICH, FC2_ICH_T);
+    ref_unpack_fc(rdma_param, addr_byte, model->fc3_w, model->fc3_b, FC3_OCH, FC3_ICH, FC3_ICH_T);
+}
+
+// conv + ReLU + 2x2 max pooling, [ICH][IY][IX] -> [OCH][OY/2][OX/2]
+static void ref_conv_pool (
+    const int8_t* infmap,
+    const int8_t* weight,
+    const int16_t* bias,
+    int8_t* pool_otfmap,
+    const int OCH,
+    const int OY,
+    const int OX,
+    const int ICH,
+    const int M_INV,
+    const int B_SHIFT
+) {
+    const int IY = OY + CONV_KY - 1;
+    const int IX = OX + CONV_KX - 1;
+    const int SHIFT = ref_log2(M_INV);
+    int8_t conv_otfmap[CONV1_OY * CONV1_OX];  // one output channel, largest layer
+
+    for (int och = 0; och < OCH; och++) {
+        for (int oy = 0; oy < OY; oy++) {
+            for (int ox = 0; ox < OX; ox++) {
+                int32_t acc = 0;
+                for (int ich = 0; ich < ICH; ich++) {
+                    const int8_t* in_row = infmap + (ich * IY + oy) * IX + ox;
+                    const int8_t* w_row  = weight + (och * ICH + ich) * CONV_KY * CONV_KX;
+                    for (int ky = 0; ky < CONV_KY; ky++) {
+                        for (int kx = 0; kx < CONV_KX; kx++) {
+                            acc += (int32_t)in_row[ky * IX + kx] * w_row[ky * CONV_KX + kx];
+                        }
+                    }
+                }
+                acc += (int32_t)bias[och] << B_SHIFT;
+                int32_t scaled = (acc + (M_INV / 2)) >> SHIFT;
+                if (scaled < 0) scaled = 0; // ReLU
+                if (scaled > REF_QMAX) scaled = REF_QMAX;
+                conv_otfmap[oy * OX + ox] = (int8_t)scaled;
+            }
+        }
+        for (int py = 0; py < OY / POOL_KY; py++) {
+            for (int px = 0; px < OX / POOL_KX; px++) {
+                int max_pool = 0;
+                for (int ky = 0; ky < POOL_KY; ky++) {
+                    for (int kx = 0; kx < POOL_KX; kx++) {
+                        int val = conv_otfmap[(py * POOL_KY + ky) * OX + (px * POOL_KX + kx)];
+                        max_pool = (val > max_pool) ? val : max_pool;
+                    }
+                }
+                pool_otfmap[(och * (OY / POOL_KY) + py) * (OX / POOL_KX) + px] = (int8_t)max_pool;
+            }
+        }
+    }
+}
+
+static void ref_fc (
+    const int8_t* infmap,
+    const int8_t* weight,
+    const int16_t* bias,
+    int8_t* otfmap,
+    const int OCH,
+    const int ICH,
+    const int M_INV,
+    const int B_SHIFT,
+    const bool relu
+) {
+    const int SHIFT = ref_log2(M_INV);
+    for (int och = 0; och < OCH; och++) {
+        const int8_t* w_row = weight + och * ICH;
+        int32_t acc = 0;
+        for (int ich = 0; ich < ICH; ich++) {
+            acc += (int32_t)infmap[ich] * w_row[ich];
+        }
+        acc += (int32_t)bias[och] << B_SHIFT;
+        int32_t scaled = (acc + (M_INV / 2)) >> SHIFT;
+        if ((scaled < 0) && relu) scaled = 0;
+        if (scaled > REF_QMAX) scaled = REF_QMAX;
+        otfmap[och] = (int8_t)scaled;
+    }
+}
+
+int ref_infer (
+    const ref_model* model,
+    const u64* infmap_bus,
+    int8_t* fc3_otfmap
+) {
+    int8_t infmap   [CONV1_ICH * CONV1_IY * CONV1_IX];
+    int8_t pool1    [POOL1_OCH * (POOL1_IY / POOL_KY) * (POOL1_IX / POOL_KX)];
+    int8_t pool2    [POOL2_OCH * (POOL2_IY / POOL_KY) * (POOL2_IX / POOL_KX)];  // = flatten
+    int8_t fc1_ot   [FC1_OCH];
+    int8_t fc2_ot   [FC2_OCH];
+    int8_t fc3_ot   [FC3_OCH];
+
+    // bus beat = B_COL_NUM pixels of one row
+    for (int beat = 0; beat < (CONV1_ICH * CONV1_IY * CONV1_IX) / (B_COL_NUM); beat++) {
+        for (int col = 0; col < (B_COL_NUM); col++) {
+            infmap[beat * (B_COL_NUM) + col] = (int8_t)(infmap_bus[beat] >> (col * 8));
+        }
+    }
+
+    ref_conv_pool(infmap, model->conv1_w, model->conv1_b, pool1,
+        CONV1_OCH, CONV1_OY, CONV1_OX, CONV1_ICH, CONV1_M_INV, CONV1_B_SHIFT);
+    ref_conv_pool(pool1, model->conv2_w, model->conv2_b, pool2,
+        CONV2_OCH, CONV2_OY, CONV2_OX, CONV2_ICH, CONV2_M_INV, CONV2_B_SHIFT);
+    ref_fc(pool2 , model->fc1_w, model->fc1_b, fc1_ot, FC1_OCH, FC1_ICH, FC1_M_INV, ref_log2(FC1_B_SCALE), FC1_RELU);
+    ref_fc(fc1_ot, model->fc2_w, model->fc2_b, fc2_ot, FC2_OCH, FC2_ICH, FC2_M_INV, ref_log2(FC2_B_SCALE), FC2_RELU);
+    ref_fc(fc2_ot, model->fc3_w, model->fc3_b, fc3_ot, FC3_OCH, FC3_ICH, FC3_M_INV, ref_log2(FC3_B_SCALE), FC3_RELU);
+
+    // wr_result: first maximum, class FC3_OCH if every output is -128
+    int otfmap = -128;
+    int result = FC3_OCH;
+    for (int och = 0; och < FC3_OCH; och++) {
+        if (fc3_otfmap != NULL) {
+            fc3_otfmap[och] = fc3_ot[och];
+        }
+        if (fc3_ot[och] > otfmap) {
+            otfmap = fc3_ot[och];
+            result = och;
+        }
+    }
+    return result;
+}
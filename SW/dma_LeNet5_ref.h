@@ -0,0 +1,50 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.07
+// Design Name:
+// Module Name: dma_LeNet5_ref.h
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: Bit-exact reference engine for the PS, ported from
+//              HW/design/ref_cpp (conv_layer / max_pooling / fc_layer) onto
+//              flat arrays. Parameters are unpacked from the packed RDMA param
+//              image and images are read in infmap bus layout, so the engine
+//              sees exactly the bits the accelerator sees.
+// Dependencies: dma_LeNet5_main.h
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DMA_LENET5_REF_H
+#define DMA_LENET5_REF_H
+
+#include "xil_types.h"
+#include "dma_LeNet5_main.h"
+
+#define REF_CLASS_NUM  FC3_OCH
+
+struct ref_model {
+    int8_t  conv1_w [CONV1_OCH * CONV1_ICH * CONV_KY * CONV_KX];
+    int16_t conv1_b [CONV1_OCH];
+    int8_t  conv2_w [CONV2_OCH * CONV2_ICH * CONV_KY * CONV_KX];
+    int16_t conv2_b [CONV2_OCH];
+    int8_t  fc1_w   [FC1_OCH * FC1_ICH];
+    int16_t fc1_b   [FC1_OCH];
+    int8_t  fc2_w   [FC2_OCH * FC2_ICH];
+    int16_t fc2_b   [FC2_OCH];
+    int8_t  fc3_w   [FC3_OCH * FC3_ICH];
+    int16_t fc3_b   [FC3_OCH];
+};
+
+// unpack the RDMA param image written by rd_param_fatfs
+void ref_load_param (ref_model* model, const u64* rdma_param);
+
+// class of one image in infmap bus layout (INFMAP_BUS_NUM beats).
+// fc3_otfmap receives the FC3 outputs when not NULL.
+int ref_infer (const ref_model* model, const u64* infmap_bus, int8_t* fc3_otfmap);
+
+#endif
@@ -0,0 +1,179 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.11
+// Design Name:
+// Module Name: dma_LeNet5_result.cpp
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: WDMA result ring and completion tracker
+// Dependencies: xil_cache.h
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include "xil_cache.h"
+#include "xil_printf.h"
+#include "dma_LeNet5_result.h"
+
+void result_ring_init (
+    result_ring* ring,
+    u64* slot_base,
+    const int slot_num
+) {
+    ring->slot     = slot_base;
+    ring->slot_num = slot_num;
+    for (int i = 0; i < slot_num; i++) {
+        ring->slot[i]    = RESULT_EMPTY;
+        ring->is_done[i] = false;
+        ring->is_used[i] = false;
+    }
+    Xil_DCacheFlushRange((UINTPTR)slot_base, slot_num * sizeof(u64));
+    for (int i = 0; i < RESULT_OWNER_NUM; i++) {
+        ring->owner_num[i]    = 0;
+        ring->is_idx_known[i] = false;
+    }
+    ring->head         = 0;
+    ring->issued       = 0;
+    ring->consumed     = 0;
+    ring->out_of_order = 0;
+    ring->dropped      = 0;
+    ring->stale        = 0;
+}
+
+bool result_ring_full (const result_ring* ring) {
+    return (ring->issued - ring->head) >= (u32)ring->slot_num;
+}
+
+u64* result_issue (
+    result_ring* ring,
+    const u32 seq,
+    const int owner
+) {
+    if ((seq != ring->issued) || result_ring_full(ring)) {
+        return NULL;
+    }
+    int i = seq % ring->slot_num;
+    ring->owner[i]   = owner;
+    ring->ordinal[i] = ring->owner_num[owner]++;
+    ring->stale_rec[i] = RESULT_EMPTY;
+    ring->is_done[i] = false;
+    ring->is_used[i] = false;
+    // invalid until the new owner writes it, the old record stays readable till then
+    ring->slot[i]    = RESULT_EMPTY;
+    Xil_DCacheFlushRange((UINTPTR)&ring->slot[i], sizeof(u64));
+    ring->issued++;
+    return (u64*)&ring->slot[i];
+}
+
+void result_put (
+    result_ring* ring,
+    const u32 seq,
+    const int cls
+) {
+    int i = seq % ring->slot_num;
+    ring->put_rec[i] = RESULT_REC(seq, cls);
+    ring->slot[i]    = ring->put_rec[i];
+}
+
+void result_done (
+    result_ring* ring,
+    const u32 seq
+) {
+    int i = seq % ring->slot_num;
+    ring->is_done[i] = true;
+    XTime_GetTime(&ring->done_at[i]);
+}
+
+// record of seq: a PS record carries seq, the n-th image of an instance
+// writes its index base + n. the first record of an instance sets the base
+static bool result_is_own (
+    result_ring* ring,
+    const u32 seq,
+    const u64 rec
+) {
+    int i     = seq % ring->slot_num;
+    int owner = ring->owner[i];
+    u32 idx   = RESULT_IDX(rec);
+    if (owner == RESULT_OWNER_PS) {
+        return idx == (seq & RESULT_IDX_MASK);
+    }
+    if (!ring->is_idx_known[owner]) {
+        ring->is_idx_known[owner] = true;
+        ring->idx_base[owner] = idx - ring->ordinal[i];
+    }
+    return idx == ((ring->idx_base[owner] + ring->ordinal[i]) & RESULT_IDX_MASK);
+}
+
+int result_poll (
+    result_ring* ring,
+    u8* out_class
+) {
+    int num = 0;
+    XTime now;
+    XTime_GetTime(&now);
+
+    for (u32 seq = ring->head; seq != ring->issued; seq++) {
+        int i = seq % ring->slot_num;
+        if (ring->is_used[i]) {
+            continue;
+        }
+        Xil_DCacheInvalidateRange((UINTPTR)&ring->slot[i], sizeof(u64));
+        u64 rec = ring->slot[i];
+        if ((rec != RESULT_EMPTY) && (rec != ring->stale_rec[i]) && !result_is_own(ring, seq, rec)) {
+            // late beat of an image dropped before this slot was issued again
+            xil_printf("result: seq %u stale record (data index %u) rejected\n", seq, RESULT_IDX(rec));
+            ring->stale_rec[i] = rec;
+            ring->stale++;
+        }
+        if (ring->owner[i] == RESULT_OWNER_PS) {
+            rec = ring->put_rec[i];
+        } else if (rec == ring->stale_rec[i]) {
+            rec = RESULT_EMPTY;  // wait for the own beat
+        }
+        if (rec != RESULT_EMPTY) {
+            out_class[seq] = (u8)RESULT_CLASS(rec);
+            ring->is_used[i] = true;
+            ring->consumed++;
+            if (seq != ring->head) {
+                ring->out_of_order++;
+            }
+            num++;
+        } else if (ring->is_done[i] &&
+                   (now - ring->done_at[i] > (XTime)RESULT_TIMEOUT_US * (COUNTS_PER_SECOND / 1000000))) {
+            xil_printf("result: seq %u dropped (no WDMA beat %d us after DONE)\n", seq, RESULT_TIMEOUT_US);
+            out_class[seq] = RESULT_DROP_CLASS;
+            ring->is_used[i] = true;
+            ring->dropped++;
+            if (ring->stale_rec[i] != RESULT_EMPTY) {
+                ring->is_idx_known[ring->owner[i]] = false;  // the base may be off, learn it again
+            }
+            num++;
+        }
+    }
+
+    // release the consumed prefix, result_issue() reuses the slots
+    while ((ring->head != ring->issued) && ring->is_used[ring->head % ring->slot_num]) {
+        ring->head++;
+    }
+    return num;
+}
+
+bool result_is_consumed (
+    const result_ring* ring,
+    const u32 seq
+) {
+    if ((seq - ring->head) >= (ring->issued - ring->head)) {
+        return true;  // below head
+    }
+    return ring->is_used[seq % ring->slot_num];
+}
+
+void result_report (const result_ring* ring) {
+    printf("result ring: %d slots, consumed %lu (out of order %lu), dropped %lu, stale records %lu\n",
+           ring->slot_num, ring->consumed, ring->out_of_order, ring->dropped, ring->stale);
+}
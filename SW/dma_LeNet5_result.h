@@ -0,0 +1,84 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.11
+// Design Name:
+// Module Name: dma_LeNet5_result.h
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: WDMA result ring and completion tracker.
+//              Image seq s owns ring slot s % slot_num. A slot holds one
+//              64-bit result record in the WDMA beat format, or
+//              RESULT_EMPTY while it is not written:
+//                [63:24] 0, [23:4] seq / HW data index, [3:0] class
+//              The tracker consumes records in any arrival order, delivers
+//              them per seq, frees their slots and advances over a gap only
+//              when the slot is consumed or declared dropped.
+// Dependencies:
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     The HW data index counts results per instance since reset. The n-th
+//     image issued to an instance writes index base + n, the base is learnt
+//     from its first record. A record with any other index is a late beat of
+//     an image dropped before the slot was issued again: it is counted as
+//     stale and not consumed.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DMA_LENET5_RESULT_H
+#define DMA_LENET5_RESULT_H
+
+#include "xil_types.h"
+#include "xtime_l.h"
+
+#define RESULT_EMPTY        0xffffffffffffffffULL  // valid flag: slot != RESULT_EMPTY
+#define RESULT_IDX_MASK     0xfffff                // DATA_IDX_BW = 20
+#define RESULT_CLASS(rec)   ((int)((rec) & 0xf))
+#define RESULT_IDX(rec)     ((u32)(((rec) >> 4) & RESULT_IDX_MASK))
+#define RESULT_REC(idx, cls) ((((u64)(idx) & RESULT_IDX_MASK) << 4) | ((u64)(cls) & 0xf))
+
+#define RESULT_RING_NUM     64     // slots, power of 2
+#define RESULT_OWNER_NUM    5      // 4 PL instances + PS
+#define RESULT_OWNER_PS     (RESULT_OWNER_NUM - 1)
+#define RESULT_DROP_CLASS   0xff   // delivered class of a dropped result
+#define RESULT_TIMEOUT_US   1000   // DONE -> beat, longer is a drop
+
+struct result_ring {
+    volatile u64* slot;
+    int   slot_num;
+    // per slot state of the seq that owns it
+    int   owner   [RESULT_RING_NUM];  // instance index or RESULT_OWNER_PS
+    u32   ordinal [RESULT_RING_NUM];  // images issued to the owner before this seq
+    u64   put_rec [RESULT_RING_NUM];  // PS record, a stale beat may overwrite the slot
+    u64   stale_rec[RESULT_RING_NUM]; // last rejected record, RESULT_EMPTY: none
+    bool  is_done [RESULT_RING_NUM];  // DONE seen, the beat must follow
+    XTime done_at [RESULT_RING_NUM];
+    bool  is_used [RESULT_RING_NUM];  // consumed out of order, waiting for head
+    u32   head;       // every seq < head is consumed
+    u32   issued;     // every seq < issued owns its slot
+    // HW data index per owner
+    u32   owner_num    [RESULT_OWNER_NUM];  // images issued
+    bool  is_idx_known [RESULT_OWNER_NUM];
+    u32   idx_base     [RESULT_OWNER_NUM];  // index of the first issued image
+    // statistics
+    unsigned long consumed;
+    unsigned long out_of_order;  // consumed ahead of head
+    unsigned long dropped;       // timed out after DONE
+    unsigned long stale;         // records of another image, rejected
+};
+
+void  result_ring_init (result_ring* ring, u64* slot_base, const int slot_num);
+bool  result_ring_full (const result_ring* ring);
+u64*  result_issue (result_ring* ring, const u32 seq, const int owner);  // slot for seq, NULL if out of order or full
+void  result_put (result_ring* ring, const u32 seq, const int cls);     // PS result
+void  result_done (result_ring* ring, const u32 seq);                   // DONE of its instance
+
+// consume every arrived record, out_class[seq] = class (RESULT_DROP_CLASS on drop).
+// returns the number of records consumed.
+int   result_poll (result_ring* ring, u8* out_class);
+bool  result_is_consumed (const result_ring* ring, const u32 seq);     // delivered or dropped, seq < issued
+void  result_report (const result_ring* ring);
+
+#endif
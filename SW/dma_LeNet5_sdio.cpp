@@ -0,0 +1,178 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.02
+// Design Name:
+// Module Name: dma_LeNet5_sdio.cpp
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: SD card I/O layer
+// Dependencies: FatFs (xilffs)
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     f_read() of whole sectors at a sector-aligned file offset is transferred
+//     by FatFs directly into the caller buffer, bypassing its own sector
+//     buffer, so every window refill is one multi-sector SD transfer.
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "xil_printf.h"
+#include "dma_LeNet5_sdio.h"
+#include "dma_LeNet5_prof.h"
+
+static FATFS   sd_fatfs;
+static bool    sd_is_mounted = false;
+static sd_file sd_files[SD_FILE_NUM];
+
+FRESULT sd_mount () {
+    if (sd_is_mounted) {
+        return FR_OK;
+    }
+    prof_begin(PROF_MOUNT);
+    FRESULT res = f_mount(&sd_fatfs, "0:/", 1);
+    prof_end(PROF_MOUNT);
+    if (res != FR_OK) {
+        xil_printf("SD card mount failed: %d\n", res);
+        return res;
+    }
+    sd_is_mounted = true;
+    xil_printf("SD card mounted successfully.\n");
+    return FR_OK;
+}
+
+void sd_unmount () {
+    for (int i = 0; i < SD_FILE_NUM; i++) {
+        if (sd_files[i].is_open) {
+            f_close(&sd_files[i].fil);
+            sd_files[i].is_open = false;
+        }
+    }
+    if (sd_is_mounted) {
+        f_mount(NULL, "0:/", 1);
+        sd_is_mounted = false;
+    }
+}
+
+FRESULT sd_stat (const char* path, FILINFO* fno) {
+    FRESULT res = sd_mount();
+    if (res != FR_OK) {
+        return res;
+    }
+    return f_stat(path, fno);
+}
+
+sd_file* sd_open (const char* path) {
+    sd_file* empty = NULL;
+    for (int i = 0; i < SD_FILE_NUM; i++) {
+        if (sd_files[i].is_open && (strncmp(sd_files[i].path, path, SD_PATH_LEN) == 0)) {
+            return &sd_files[i];
+        }
+        if (!sd_files[i].is_open && (empty == NULL)) {
+            empty = &sd_files[i];
+        }
+    }
+    if (empty == NULL) {
+        xil_printf("sd_open: file cache full (%s)\n", path);
+        return NULL;
+    }
+    if (sd_mount() != FR_OK) {
+        return NULL;
+    }
+
+    prof_begin(PROF_OPEN);
+    FRESULT res = f_open(&empty->fil, path, FA_READ);
+    prof_end(PROF_OPEN);
+    if (res != FR_OK) {
+        xil_printf("%s file open failed: %d\n", path, res);
+        return NULL;
+    }
+    strncpy(empty->path, path, SD_PATH_LEN - 1);
+    empty->path[SD_PATH_LEN - 1] = '\0';
+    empty->is_open = true;
+    empty->size    = f_size(&empty->fil);
+    empty->win_ofs = 0;
+    empty->win_len = 0;
+    empty->pos     = 0;
+    return empty;
+}
+
+void sd_rewind (sd_file* fp) {
+    fp->pos = 0;
+}
+
+// a cached handle keeps the size and window of its first open; re-open it
+// when the file may have changed on the card since then
+bool sd_invalidate (sd_file* fp) {
+    f_close(&fp->fil);
+    prof_begin(PROF_OPEN);
+    FRESULT res = f_open(&fp->fil, fp->path, FA_READ);
+    prof_end(PROF_OPEN);
+    if (res != FR_OK) {
+        xil_printf("%s file re-open failed: %d\n", fp->path, res);
+        fp->is_open = false;
+        return false;
+    }
+    fp->size    = f_size(&fp->fil);
+    fp->win_ofs = 0;
+    fp->win_len = 0;
+    fp->pos     = 0;
+    return true;
+}
+
+// load the sector-aligned block that starts at or before offset
+static bool sd_fill (sd_file* fp, FSIZE_t offset) {
+    FSIZE_t win_ofs = offset & ~((FSIZE_t)SD_SECTOR_BYTE - 1);
+    UINT bytes_read = 0;
+
+    if (f_tell(&fp->fil) != win_ofs) {
+        if (f_lseek(&fp->fil, win_ofs) != FR_OK) {
+            xil_printf("%s: seek error at %lu\n", fp->path, (unsigned long)win_ofs);
+            return false;
+        }
+    }
+    if (f_read(&fp->fil, fp->win, SD_BLOCK_BYTE, &bytes_read) != FR_OK) {
+        xil_printf("%s: read error at %lu\n", fp->path, (unsigned long)win_ofs);
+        return false;
+    }
+    fp->win_ofs = win_ofs;
+    fp->win_len = bytes_read;
+    return true;
+}
+
+const u8* sd_view (sd_file* fp, FSIZE_t offset, UINT len) {
+    if ((fp == NULL) || (offset + len > fp->size)) {
+        return NULL;
+    }
+    bool is_hit = (offset >= fp->win_ofs) && (offset + len <= fp->win_ofs + fp->win_len);
+    if (!is_hit) {
+        if (!sd_fill(fp, offset) || (offset + len > fp->win_ofs + fp->win_len)) {
+            return NULL;
+        }
+    }
+    return fp->win + (offset - fp->win_ofs);
+}
+
+const char* sd_gets (sd_file* fp, int* len) {
+    if ((fp == NULL) || (fp->pos >= fp->size)) {
+        return NULL;
+    }
+    UINT view_len = SD_LINE_MAX;
+    if (fp->pos + view_len > fp->size) {
+        view_len = fp->size - fp->pos;
+    }
+    const char* line = (const char*)sd_view(fp, fp->pos, view_len);
+    if (line == NULL) {
+        return NULL;
+    }
+
+    int line_len = 0;
+    while ((line_len < (int)view_len) && (line[line_len] != '\n')) {
+        line_len++;
+    }
+    *len = line_len;
+    fp->pos += (line_len < (int)view_len) ? (line_len + 1) : line_len;
+    return line;
+}
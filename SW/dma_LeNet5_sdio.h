@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.02
+// Design Name:
+// Module Name: dma_LeNet5_sdio.h
+// Project Name: CNN_FPGA
+// Target Devices: TE0729
+// Tool Versions: Vitis_2022.2
+// Description: SD card I/O layer. The volume is mounted once, opened files are
+//              cached by path, and data is read in sector-aligned blocks into a
+//              per-file window. Callers get read-only views into that window.
+// Dependencies: FatFs (xilffs)
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DMA_LENET5_SDIO_H
+#define DMA_LENET5_SDIO_H
+
+#include "xil_types.h"
+#include "ff.h"
+
+#define SD_SECTOR_BYTE   512
+#define SD_BLOCK_BYTE    (32 * SD_SECTOR_BYTE)  // 16 KB read-ahead window per file
+#define SD_FILE_NUM      13                     // 10 param files + images (IDX, packed) + labels
+#define SD_PATH_LEN      32
+#define SD_LINE_MAX      64                     // longest text line of the param files
+
+struct sd_file {
+    FIL     fil;
+    char    path[SD_PATH_LEN];
+    bool    is_open;
+    FSIZE_t size;
+    FSIZE_t win_ofs;   // file offset of win[0], sector aligned
+    UINT    win_len;   // valid bytes in win
+    FSIZE_t pos;       // cursor of sd_gets()
+    u8      win[SD_BLOCK_BYTE] __attribute__((aligned(64))); // SDIO DMA needs cache line alignment
+};
+
+// session
+FRESULT sd_mount ();
+void    sd_unmount ();   // closes every cached file
+
+// files
+FRESULT  sd_stat (const char* path, FILINFO* fno);
+sd_file* sd_open (const char* path);  // returns the cached handle if already open
+void     sd_rewind (sd_file* fp);
+bool     sd_invalidate (sd_file* fp);   // re-open: fresh size, window dropped, cursor at 0
+
+// views
+const u8*   sd_view (sd_file* fp, FSIZE_t offset, UINT len); // len <= SD_BLOCK_BYTE - SD_SECTOR_BYTE
+const char* sd_gets (sd_file* fp, int* len);                 // next line, not NUL terminated
+
+#endif
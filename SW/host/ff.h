@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.05
+// Design Name:
+// Module Name: ff.h
+// Project Name: CNN_FPGA
+// Target Devices: Linux host
+// Tool Versions: g++ (gnu++17)
+// Description: Host stand-in for the FatFs API subset used by the firmware.
+//              "0:/LeNet5/..." is mapped onto $LENET5_SD_ROOT (default SW/SDcard).
+// Dependencies:
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FF_H
+#define FF_H
+
+#include <stdio.h>
+#include "xil_types.h"
+
+typedef unsigned int UINT;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef char TCHAR;
+typedef u32 FSIZE_t;
+
+typedef enum {
+    FR_OK = 0,
+    FR_DISK_ERR,
+    FR_INT_ERR,
+    FR_NOT_READY,
+    FR_NO_FILE,
+    FR_NO_PATH,
+    FR_INVALID_NAME,
+    FR_DENIED,
+    FR_EXIST,
+    FR_INVALID_OBJECT,
+    FR_WRITE_PROTECTED,
+    FR_INVALID_DRIVE,
+    FR_NOT_ENABLED,
+    FR_NO_FILESYSTEM
+} FRESULT;
+
+#define FA_READ           0x01
+#define FA_WRITE          0x02
+#define FA_OPEN_EXISTING  0x00
+#define FA_CREATE_ALWAYS  0x08
+
+typedef struct {
+    BYTE fs_type;
+} FATFS;
+
+typedef struct {
+    FSIZE_t objsize;
+} FFOBJID;
+
+typedef struct {
+    FFOBJID obj;
+    FSIZE_t fptr;
+    FILE*   fp;
+} FIL;
+
+typedef struct {
+    FSIZE_t fsize;
+    WORD    fdate;
+    WORD    ftime;
+    BYTE    fattrib;
+    TCHAR   fname[256];
+} FILINFO;
+
+#define f_size(fp) ((fp)->obj.objsize)
+#define f_tell(fp) ((fp)->fptr)
+
+FRESULT f_mount (FATFS* fs, const TCHAR* path, BYTE opt);
+FRESULT f_open (FIL* fp, const TCHAR* path, BYTE mode);
+FRESULT f_close (FIL* fp);
+FRESULT f_read (FIL* fp, void* buff, UINT btr, UINT* br);
+FRESULT f_write (FIL* fp, const void* buff, UINT btw, UINT* bw);
+FRESULT f_lseek (FIL* fp, FSIZE_t ofs);
+FRESULT f_stat (const TCHAR* path, FILINFO* fno);
+TCHAR*  f_gets (TCHAR* buff, int len, FIL* fp);
+
+#endif
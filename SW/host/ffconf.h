@@ -0,0 +1,21 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.05
+// Design Name:
+// Module Name: ffconf.h
+// Project Name: CNN_FPGA
+// Target Devices: Linux host
+// Tool Versions: g++ (gnu++17)
+// Description: Host stand-in for the FatFs configuration (nothing to configure)
+// Dependencies:
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FFCONF_H
+#define FFCONF_H
+
+#endif
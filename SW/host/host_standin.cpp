@@ -0,0 +1,323 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.05
+// Design Name:
+// Module Name: host_standin.cpp
+// Project Name: CNN_FPGA
+// Target Devices: Linux host
+// Tool Versions: g++ (gnu++17)
+// Description: Linux host stand-in for the Zynq board. Runs the unmodified
+//              firmware in SW/ as a host process:
+//                - the DDR window carved by the DMA arena is mapped
+//                  at its physical address,
+//                - FatFs calls are served from $LENET5_SD_ROOT,
+//                - each dma_LeNet5_top register map is served by a simulated
+//                  core that follows the AP_CTRL handshake of the RTL
+//                  (LENET5_SIM_CORE_NUM instances, 64 KB apart).
+//              Build (from the repo root):
+//                g++ -std=gnu++17 -O2 -I SW/host -I SW SW/*.cpp SW/host/*.cpp -o lenet5_host
+// Dependencies: POSIX (mmap, clock_gettime)
+// Revision: 0.01 - File Created
+// Additional Comments:
+//     LENET5_SIM_PARAM_US / LENET5_SIM_IMAGE_US set the simulated service time
+//     of a parameter load / one image (default 0 us).
+//     LENET5_SIM_DROP_EVERY=n loses the result beat of every n-th image, with
+//     LENET5_SIM_LATE_US it lands that many us late instead (stale beat).
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "xparameters.h"
+#include "xil_io.h"
+#include "xtime_l.h"
+#include "ff.h"
+#include "dma_LeNet5_ref.h"
+
+// dma_LeNet5_top register map (same offsets as the firmware)
+#define SIM_AP_CTRL            0x00
+#define SIM_RDMA_PTR_PARAM     0x14
+#define SIM_RDMA_PTR_INFMAP    0x18
+#define SIM_WDMA_PTR           0x1c
+#define SIM_AXI00_PTR0         0x20
+#define SIM_REG_NUM            16
+
+#define SIM_START_PARAM   (1 << 0)
+#define SIM_DONE          (1 << 1)
+#define SIM_IDLE          (1 << 2)
+#define SIM_READY         (1 << 3)
+#define SIM_START_INFMAP  (1 << 4)
+#define SIM_DONE_WDMA     (1 << 5)
+
+#define SIM_DATA_IDX_MASK 0xfffff  // DATA_IDX_BW = 20
+#define SIM_CORE_SPAN     0x10000
+
+//==============================================================================
+// DDR window
+//==============================================================================
+__attribute__((constructor))
+static void ddr_map () {
+    size_t len = XPAR_PS7_DDR_0_S_AXI_HIGHADDR - XPAR_PS7_DDR_0_S_AXI_BASEADDR + 1;
+    void* ddr = mmap((void*)XPAR_PS7_DDR_0_S_AXI_BASEADDR, len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (ddr != (void*)XPAR_PS7_DDR_0_S_AXI_BASEADDR) {
+        fprintf(stderr, "host stand-in: DDR window 0x%x map failed\n", XPAR_PS7_DDR_0_S_AXI_BASEADDR);
+        exit(1);
+    }
+}
+
+//==============================================================================
+// simulated core
+//==============================================================================
+enum sim_job {
+    SIM_JOB_NONE,
+    SIM_JOB_PARAM,
+    SIM_JOB_INFMAP
+};
+
+struct sim_core {
+    u32     reg[SIM_REG_NUM];
+    sim_job job;
+    XTime   done_at;
+    u32     job_infmap;   // RDMA latches the infmap pointer at start
+    u32     job_wdma;     // WDMA latches its pointer once per result beat
+    u32     data_idx;     // WDMA result index, counts since reset
+    bool    is_late;      // a lost beat still to land at late_addr
+    u32     late_addr;
+    u64     late_rec;
+    XTime   late_at;
+    bool    is_done;      // ap_done, clear on read
+    bool    is_wdma_done; // clear on read
+};
+
+static sim_core sim_cores[LENET5_SIM_CORE_NUM];
+
+static bool is_ddr_addr (const u32 addr, const u32 len) {
+    return (addr >= XPAR_PS7_DDR_0_S_AXI_BASEADDR) && (addr + len - 1 <= XPAR_PS7_DDR_0_S_AXI_HIGHADDR);
+}
+
+static XTime sim_env_us (const char* name) {
+    const char* val = getenv(name);
+    return (val == NULL) ? 0 : (XTime)strtoul(val, NULL, 10) * (COUNTS_PER_SECOND / 1000000);
+}
+
+static ref_model sim_model[LENET5_SIM_CORE_NUM];
+
+static u32 sim_infer (sim_core& core, const u64* infmap) {
+    u32 cls = ref_infer(&sim_model[&core - sim_cores], infmap, NULL);
+    const char* fault = getenv("LENET5_SIM_FAULT_EVERY");
+    if ((fault != NULL) && (atoi(fault) > 0) && ((core.data_idx + 1) % atoi(fault) == 0)) {
+        cls = (cls + 1) % REF_CLASS_NUM;
+    }
+    return cls;
+}
+
+static void sim_update (sim_core& core) {
+    XTime now;
+    XTime_GetTime(&now);
+    if (core.is_late && (now >= core.late_at)) {
+        *(u64*)(UINTPTR)core.late_addr = core.late_rec;
+        core.is_late = false;
+    }
+    if (core.job == SIM_JOB_NONE) {
+        return;
+    }
+    if (now < core.done_at) {
+        return;
+    }
+    if (core.job == SIM_JOB_INFMAP) {
+        u32 wdma_addr = core.job_wdma;  // one beat at the latched pointer (wdma.v)
+        if (is_ddr_addr(core.job_infmap, 8) && is_ddr_addr(wdma_addr, 8)) {
+            u32 cls = sim_infer(core, (const u64*)(UINTPTR)core.job_infmap);
+            const char* drop = getenv("LENET5_SIM_DROP_EVERY");  // lost beat: DONE without a write
+            u64 rec = ((u64)(core.data_idx & SIM_DATA_IDX_MASK) << 4) | (cls & 0xf);
+            if ((drop == NULL) || (atoi(drop) <= 0) || ((core.data_idx + 1) % atoi(drop) != 0)) {
+                *(u64*)(UINTPTR)wdma_addr = rec;
+            } else if (!core.is_late && (sim_env_us("LENET5_SIM_LATE_US") > 0)) {
+                core.is_late   = true;
+                core.late_addr = wdma_addr;
+                core.late_rec  = rec;
+                core.late_at   = now + sim_env_us("LENET5_SIM_LATE_US");
+            }
+        } else {
+            fprintf(stderr, "host stand-in: DMA outside DDR (infmap 0x%08x, wdma 0x%08x) dropped\n",
+                    core.job_infmap, wdma_addr);
+        }
+        core.data_idx = (core.data_idx + 1) & SIM_DATA_IDX_MASK;
+        core.is_wdma_done = true;
+    }
+    core.job     = SIM_JOB_NONE;
+    core.is_done = true;
+}
+
+static void sim_start (sim_core& core, const sim_job job) {
+    if (core.job != SIM_JOB_NONE) {
+        return; // ap_start is ignored while busy
+    }
+    XTime now;
+    XTime_GetTime(&now);
+    core.job = job;
+    if (job == SIM_JOB_PARAM) {
+        u32 param_ptr = core.reg[SIM_RDMA_PTR_PARAM >> 2];
+        if (is_ddr_addr(param_ptr, (NUM_RD_PARAM) * 8)) {
+            ref_load_param(&sim_model[&core - sim_cores], (const u64*)(UINTPTR)param_ptr);
+        }
+        core.done_at = now + sim_env_us("LENET5_SIM_PARAM_US");
+    } else {
+        core.job_infmap = core.reg[SIM_RDMA_PTR_INFMAP >> 2];
+        core.job_wdma   = core.reg[SIM_WDMA_PTR >> 2];
+        core.done_at    = now + sim_env_us("LENET5_SIM_IMAGE_US");
+    }
+    sim_update(core);
+}
+
+static bool is_core_addr (const UINTPTR addr) {
+    return (addr >= XPAR_DMA_LENET5_TOP_0_BASEADDR) &&
+           (addr < XPAR_DMA_LENET5_TOP_0_BASEADDR + LENET5_SIM_CORE_NUM * SIM_CORE_SPAN);
+}
+
+static sim_core& sim_core_of (const UINTPTR addr) {
+    return sim_cores[(addr - XPAR_DMA_LENET5_TOP_0_BASEADDR) / SIM_CORE_SPAN];
+}
+
+u32 Xil_In32 (UINTPTR addr) {
+    if (!is_core_addr(addr)) {
+        return *(volatile u32*)addr;
+    }
+    sim_core& core = sim_core_of(addr);
+    u32 ofs = ((addr - XPAR_DMA_LENET5_TOP_0_BASEADDR) % SIM_CORE_SPAN) >> 2;
+    if (ofs >= SIM_REG_NUM) {
+        return 0;
+    }
+    if (ofs != (SIM_AP_CTRL >> 2)) {
+        return core.reg[ofs];
+    }
+    sim_update(core);
+    u32 ctrl = 0;
+    if (core.job == SIM_JOB_NONE) ctrl |= SIM_IDLE | SIM_READY;
+    if (core.is_done)             ctrl |= SIM_DONE;
+    if (core.is_wdma_done)        ctrl |= SIM_DONE_WDMA;
+    core.is_done      = false;
+    core.is_wdma_done = false;
+    return ctrl;
+}
+
+void Xil_Out32 (UINTPTR addr, u32 value) {
+    if (!is_core_addr(addr)) {
+        *(volatile u32*)addr = value;
+        return;
+    }
+    sim_core& core = sim_core_of(addr);
+    u32 ofs = ((addr - XPAR_DMA_LENET5_TOP_0_BASEADDR) % SIM_CORE_SPAN) >> 2;
+    if (ofs >= SIM_REG_NUM) {
+        return;
+    }
+    if (ofs != (SIM_AP_CTRL >> 2)) {
+        core.reg[ofs] = value;
+        return;
+    }
+    if (value & SIM_START_PARAM) {
+        sim_start(core, SIM_JOB_PARAM);
+    } else if (value & SIM_START_INFMAP) {
+        sim_start(core, SIM_JOB_INFMAP);
+    }
+}
+
+//==============================================================================
+// FatFs over stdio
+//==============================================================================
+static std::string sd_host_path (const TCHAR* path) {
+    const char* root = getenv("LENET5_SD_ROOT");
+    std::string host = (root == NULL) ? "SW/SDcard" : root;
+    std::string p = path;
+    if (p.compare(0, 10, "0:/LeNet5/") == 0) {
+        p = p.substr(10);
+    } else if (p.compare(0, 3, "0:/") == 0) {
+        p = p.substr(3);
+    }
+    return host + "/" + p;
+}
+
+FRESULT f_mount (FATFS* fs, const TCHAR* path, BYTE opt) {
+    (void)path; (void)opt;
+    if (fs != NULL) {
+        fs->fs_type = 1;
+    }
+    return FR_OK;
+}
+
+FRESULT f_open (FIL* fp, const TCHAR* path, BYTE mode) {
+    std::string host = sd_host_path(path);
+    fp->fp = fopen(host.c_str(), (mode & FA_WRITE) ? "wb" : "rb");
+    if (fp->fp == NULL) {
+        return FR_NO_FILE;
+    }
+    fseek(fp->fp, 0, SEEK_END);
+    fp->obj.objsize = (FSIZE_t)ftell(fp->fp);
+    fseek(fp->fp, 0, SEEK_SET);
+    fp->fptr = 0;
+    return FR_OK;
+}
+
+FRESULT f_close (FIL* fp) {
+    if (fp->fp == NULL) {
+        return FR_INVALID_OBJECT;
+    }
+    fclose(fp->fp);
+    fp->fp = NULL;
+    return FR_OK;
+}
+
+FRESULT f_read (FIL* fp, void* buff, UINT btr, UINT* br) {
+    *br = (UINT)fread(buff, 1, btr, fp->fp);
+    fp->fptr += *br;
+    return ferror(fp->fp) ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_write (FIL* fp, const void* buff, UINT btw, UINT* bw) {
+    *bw = (UINT)fwrite(buff, 1, btw, fp->fp);
+    fp->fptr += *bw;
+    if (fp->fptr > fp->obj.objsize) {
+        fp->obj.objsize = fp->fptr;
+    }
+    return ferror(fp->fp) ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_lseek (FIL* fp, FSIZE_t ofs) {
+    if (fseek(fp->fp, ofs, SEEK_SET) != 0) {
+        return FR_INT_ERR;
+    }
+    fp->fptr = ofs;
+    return FR_OK;
+}
+
+FRESULT f_stat (const TCHAR* path, FILINFO* fno) {
+    std::string host = sd_host_path(path);
+    struct stat st;
+    if (stat(host.c_str(), &st) != 0) {
+        return FR_NO_FILE;
+    }
+    struct tm tm;
+    localtime_r(&st.st_mtime, &tm);
+    fno->fsize   = (FSIZE_t)st.st_size;
+    fno->fdate   = (WORD)(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+    fno->ftime   = (WORD)((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+    fno->fattrib = 0;
+    snprintf(fno->fname, sizeof(fno->fname), "%s", host.c_str());
+    return FR_OK;
+}
+
+TCHAR* f_gets (TCHAR* buff, int len, FIL* fp) {
+    TCHAR* line = fgets(buff, len, fp->fp);
+    if (line != NULL) {
+        fp->fptr += strlen(line);
+    }
+    return line;
+}
@@ -0,0 +1,28 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.05
+// Design Name:
+// Module Name: xil_cache.h
+// Project Name: CNN_FPGA
+// Target Devices: Linux host
+// Tool Versions: g++ (gnu++17)
+// Description: Host stand-in for the cache maintenance API (coherent, no-op)
+// Dependencies:
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef XIL_CACHE_H
+#define XIL_CACHE_H
+
+#include "xil_types.h"
+
+static inline void Xil_DCacheEnable () {}
+static inline void Xil_DCacheDisable () {}
+static inline void Xil_DCacheFlushRange (UINTPTR adr, u32 len) { (void)adr; (void)len; }
+static inline void Xil_DCacheInvalidateRange (UINTPTR adr, u32 len) { (void)adr; (void)len; }
+
+#endif
@@ -0,0 +1,28 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.05
+// Design Name:
+// Module Name: xil_io.h
+// Project Name: CNN_FPGA
+// Target Devices: Linux host
+// Tool Versions: g++ (gnu++17)
+// Description: Host stand-in for Xil_In32/Xil_Out32. Accesses inside the
+//              dma_LeNet5_top window go to the simulated core register file,
+//              every other address is plain host memory.
+// Dependencies:
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef XIL_IO_H
+#define XIL_IO_H
+
+#include "xil_types.h"
+
+u32  Xil_In32 (UINTPTR addr);
+void Xil_Out32 (UINTPTR addr, u32 value);
+
+#endif
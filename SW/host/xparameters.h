@@ -0,0 +1,46 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.05
+// Design Name:
+// Module Name: xparameters.h
+// Project Name: CNN_FPGA
+// Target Devices: Linux host
+// Tool Versions: g++ (gnu++17)
+// Description: Host stand-in for the generated BSP parameters
+// Dependencies:
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef XPARAMETERS_H
+#define XPARAMETERS_H
+
+// AXI4-Lite slave windows of dma_LeNet5_top, served by the simulated cores.
+// build with -DLENET5_SIM_CORE_NUM=n (1 ~ 4) for n instances.
+#ifndef LENET5_SIM_CORE_NUM
+#define LENET5_SIM_CORE_NUM  1
+#endif
+
+#define XPAR_DMA_LENET5_TOP_0_BASEADDR   0x43C00000
+#define XPAR_DMA_LENET5_TOP_0_HIGHADDR   0x43C0FFFF
+#if LENET5_SIM_CORE_NUM > 1
+#define XPAR_DMA_LENET5_TOP_1_BASEADDR   0x43C10000
+#define XPAR_DMA_LENET5_TOP_1_HIGHADDR   0x43C1FFFF
+#endif
+#if LENET5_SIM_CORE_NUM > 2
+#define XPAR_DMA_LENET5_TOP_2_BASEADDR   0x43C20000
+#define XPAR_DMA_LENET5_TOP_2_HIGHADDR   0x43C2FFFF
+#endif
+#if LENET5_SIM_CORE_NUM > 3
+#define XPAR_DMA_LENET5_TOP_3_BASEADDR   0x43C30000
+#define XPAR_DMA_LENET5_TOP_3_HIGHADDR   0x43C3FFFF
+#endif
+
+// DDR window the firmware addresses with fixed USER_* pointers
+#define XPAR_PS7_DDR_0_S_AXI_BASEADDR    0x10000000
+#define XPAR_PS7_DDR_0_S_AXI_HIGHADDR    0x10FFFFFF
+
+#endif
@@ -0,0 +1,34 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Company: Personal
+// Engineer: dkyou0101
+//
+// Create Date: 2025.06.05
+// Design Name:
+// Module Name: xtime_l.h
+// Project Name: CNN_FPGA
+// Target Devices: Linux host
+// Tool Versions: g++ (gnu++17)
+// Description: Host stand-in for the global timer, 1 count = 1 ns
+// Dependencies:
+// Revision: 0.01 - File Created
+// Additional Comments:
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef XTIME_L_H
+#define XTIME_L_H
+
+#include <time.h>
+#include "xil_types.h"
+
+typedef u64 XTime;
+
+#define COUNTS_PER_SECOND  1000000000ULL
+
+static inline void XTime_GetTime (XTime* xtime) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    *xtime = (XTime)ts.tv_sec * COUNTS_PER_SECOND + ts.tv_nsec;
+}
+
+#endif